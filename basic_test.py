@@ -49,15 +49,82 @@ TEST_CONFIGURATIONS = [
         "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HASH_RESIZER",
         "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HASH_RESIZER"
     },
-    {
-        "name": "WithResizer_SharedMutex_MyHashTable",
-        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HASH_RESIZER;USE_SHARED_LATCH",
-        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HASH_RESIZER;USE_SHARED_LATCH"
-    },
     {
         "name": "NoResizer_SegHashTable", 
         "mt_features": "PRE_ALLOCATE;USE_SEG_HASH_TABLE",
         "mt_ht_features": "PRE_ALLOCATE;USE_SEG_HASH_TABLE;USE_HHVM"
+    },
+    {
+        "name": "NoResizer_MyHashTable_S3FIFO",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_S3FIFO",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_S3FIFO"
+    },
+    {
+        # 无锁命中路径与复用节点的 Insert 在 TSan 下运行
+        "name": "NoResizer_MyHashTable_S3FIFO_TSan",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_S3FIFO",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_S3FIFO",
+        "cmake_args": ["-DENABLE_TSAN=ON"]
+    },
+    {
+        "name": "NoResizer_MyHashTable_SIEVE",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_SIEVE",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_SIEVE"
+    },
+    {
+        # SIEVE 的无锁命中路径与复用节点的 Insert 在 TSan 下运行
+        "name": "NoResizer_MyHashTable_SIEVE_TSan",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_SIEVE",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_SIEVE",
+        "cmake_args": ["-DENABLE_TSAN=ON"]
+    },
+    {
+        "name": "NoResizer_MyHashTable_SampledLRU",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_SAMPLED_LRU",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_SAMPLED_LRU"
+    },
+    {
+        "name": "NoResizer_MyHashTable_SampledLRU_TSan",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_SAMPLED_LRU",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_SAMPLED_LRU",
+        "cmake_args": ["-DENABLE_TSAN=ON"]
+    },
+    {
+        "name": "NoResizer_MyHashTable_LFU",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_LFU",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_LFU"
+    },
+    {
+        "name": "NoResizer_MyHashTable_Midpoint",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_MIDPOINT_INSERTION",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_MIDPOINT_INSERTION"
+    },
+    {
+        "name": "NoResizer_MyHashTable_HotKey",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HOT_KEY_CACHE",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HOT_KEY_CACHE"
+    },
+    {
+        # 热点副本的 seqlock 读路径在 TSan 下运行
+        "name": "NoResizer_MyHashTable_HotKey_TSan",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HOT_KEY_CACHE",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HOT_KEY_CACHE",
+        "cmake_args": ["-DENABLE_TSAN=ON"]
+    },
+    {
+        "name": "NoResizer_MyHashTable_Flash",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_FLASH_TIER;USE_IO_URING",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_FLASH_TIER;USE_IO_URING"
+    },
+    {
+        "name": "NoResizer_MyHashTable_ColdTier",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_COLD_TIER",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_COLD_TIER"
+    },
+    {
+        "name": "NoResizer_MyHashTable_BgEvict",
+        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_BACKGROUND_EVICTION",
+        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_BACKGROUND_EVICTION"
     }
 ]
 
@@ -315,6 +382,7 @@ def main():
             f"-DK_NUM_SEG_BITS_FROM_CMAKE={k_bits}", 
             f"-DMYLRU_TESTS_MT_FEATURES={mt_features}",
             f"-DMYLRU_TESTS_MT_HT_FEATURES={mt_ht_features}",
+            *config_info.get("cmake_args", []),
             "-S", PROJECT_ROOT_DIR,
             "-B", build_path
         ]
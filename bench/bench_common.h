@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "lru_cache.h"
+#include "lru_cache_ht.h"
+
+namespace myLru {
+namespace bench {
+
+// 编译进来的分片策略
+inline auto PolicyName() -> const char* {
+#if defined(USE_S3FIFO)
+  return "s3fifo";
+#elif defined(USE_SAMPLED_LRU)
+  return "sampled_lru";
+#elif defined(USE_LFU)
+  return "lfu";
+#elif defined(USE_SIEVE)
+  return "sieve";
+#elif defined(USE_MIDPOINT_INSERTION)
+  return "lru_midpoint";
+#else
+  return "lru";
+#endif
+}
+
+// 编译进来的分片哈希表
+inline auto IndexName() -> const char* {
+#if defined(USE_MY_HASH_TABLE)
+  return "my_hash_table";
+#elif defined(USE_SEG_HASH_TABLE)
+  return "seg_hash_table";
+#else
+  return "libcuckoo";
+#endif
+}
+
+inline auto ValueFor(KeyType key) -> ValueType {
+  ValueType value{};
+  std::memcpy(value.data(), &key, sizeof(KeyType));
+  return value;
+}
+
+// variant 按 capacity 构造出的总容量：分片缓存每片 capacity / segNum
+// （至少 1），小于 segNum 的差额被舍去。名字不认识时返回 0
+inline auto CacheCapacity(const std::string& variant, size_t capacity)
+    -> size_t {
+  if (variant == "seg" || variant == "seg_ht") {
+    return std::max<size_t>(1, capacity / segNum) * segNum;
+  }
+  if (variant == "lru") {
+    return std::max<size_t>(1, capacity);
+  }
+  return 0;
+}
+
+/**
+ * @brief 按名字构造一个总容量约为 capacity 的缓存并交给 fn，fn 是泛型
+ * lambda，每种缓存各实例化一次，计时循环里没有虚函数调用。
+ *   seg    SegLRUCache，分片策略由编译宏决定
+ *   seg_ht SegLRUCacheHT
+ *   lru    单个分片（策略同 seg），一把锁
+ * 名字不认识时返回 false。实际容量见 CacheCapacity。
+ */
+template <typename Fn>
+auto WithCache(const std::string& variant, size_t capacity, Fn&& fn) -> bool {
+  size_t per_seg = std::max<size_t>(1, capacity / segNum);
+  if (variant == "seg") {
+    auto cache = std::make_unique<SegLRUCache<KeyType, ValueType>>(per_seg);
+    fn(*cache);
+  } else if (variant == "seg_ht") {
+    auto cache = std::make_unique<SegLRUCacheHT<KeyType, ValueType>>(per_seg);
+    fn(*cache);
+  } else if (variant == "lru") {
+    using ShardType = typename SegLRUCache<KeyType, ValueType>::ShardType;
+    auto cache = std::make_unique<ShardType>(std::max<size_t>(1, capacity));
+    fn(*cache);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 一行结果，字段按加入顺序输出。CSV 在第一行写表头，JSON 输出
+ * 一个对象数组；数值原样输出，其余字段按字符串转义。
+ */
+class ResultRow {
+ public:
+  auto Add(const std::string& name, const std::string& value) -> ResultRow& {
+    fields_.push_back({name, value, false});
+    return *this;
+  }
+  template <typename T>
+  auto Add(const std::string& name, T value) -> ResultRow& {
+    std::ostringstream out;
+    out << value;
+    fields_.push_back({name, out.str(), true});
+    return *this;
+  }
+
+ private:
+  friend class ResultWriter;
+  struct Field {
+    std::string name_;
+    std::string value_;
+    bool numeric_;
+  };
+  std::vector<Field> fields_;
+};
+
+class ResultWriter {
+ public:
+  // csv_path 为空时 CSV 写到 stdout，json_path 为空时不写 JSON
+  ResultWriter(const std::string& csv_path, const std::string& json_path) {
+    if (!csv_path.empty()) {
+      csv_file_.open(csv_path);
+    }
+    if (!json_path.empty()) {
+      json_.open(json_path);
+      json_ << "[";
+    }
+  }
+  ~ResultWriter() {
+    if (json_.is_open()) {
+      json_ << (rows_ > 0 ? "\n]\n" : "]\n");
+    }
+  }
+  ResultWriter(const ResultWriter&) = delete;
+  ResultWriter& operator=(const ResultWriter&) = delete;
+
+  auto Ok() const -> bool { return csv_file_.good() && json_.good(); }
+
+  auto Write(const ResultRow& row) -> void {
+    std::ostream& csv = csv_file_.is_open() ? csv_file_ : std::cout;
+    if (rows_ == 0) {
+      for (size_t i = 0; i < row.fields_.size(); ++i) {
+        csv << (i == 0 ? "" : ",") << row.fields_[i].name_;
+      }
+      csv << "\n";
+    }
+    for (size_t i = 0; i < row.fields_.size(); ++i) {
+      csv << (i == 0 ? "" : ",") << row.fields_[i].value_;
+    }
+    csv << std::endl;
+    if (json_.is_open()) {
+      json_ << (rows_ == 0 ? "\n  {" : ",\n  {");
+      for (size_t i = 0; i < row.fields_.size(); ++i) {
+        const auto& field = row.fields_[i];
+        json_ << (i == 0 ? "" : ", ") << "\"" << field.name_ << "\": ";
+        if (field.numeric_) {
+          json_ << field.value_;
+        } else {
+          json_ << "\"" << escape(field.value_) << "\"";
+        }
+      }
+      json_ << "}";
+      json_.flush();
+    }
+    rows_++;
+  }
+
+ private:
+  std::ofstream csv_file_;
+  std::ofstream json_;
+  size_t rows_ = 0;
+
+  static auto escape(const std::string& text) -> std::string {
+    std::string out;
+    for (char c : text) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out;
+  }
+};
+
+/**
+ * @brief 所有线程就绪后同时开始：线程调用 Wait 报到并自旋等待，
+ * 主线程 Release 之前先等所有线程报到，这样线程创建不计入测量时间。
+ */
+class StartBarrier {
+ public:
+  explicit StartBarrier(size_t parties) : parties_(parties) {}
+
+  auto Wait() -> void {
+    ready_.fetch_add(1, std::memory_order_acq_rel);
+    while (!go_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  auto Release() -> void {
+    while (ready_.load(std::memory_order_acquire) < parties_) {
+      std::this_thread::yield();
+    }
+    go_.store(true, std::memory_order_release);
+  }
+
+ private:
+  size_t parties_;
+  std::atomic<size_t> ready_{0};
+  std::atomic<bool> go_{false};
+};
+
+// "1,2,4,8" 这样的列表
+inline auto ParseList(const std::string& text) -> std::vector<size_t> {
+  std::vector<size_t> values;
+  std::stringstream in(text);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (!item.empty()) {
+      values.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+  }
+  return values;
+}
+
+}  // namespace bench
+}  // namespace myLru
@@ -0,0 +1,279 @@
+// HashTableWrapper 的微基准，不经过 LRU 链表，只测索引本身。
+// 后端由编译宏决定（USE_MY_HASH_TABLE / USE_SEG_HASH_TABLE / USE_LIBCUCKOO），
+// CMake 为每个后端各生成一个 mylru_hash_bench_* 目标，输出可以直接对比。
+//
+// 表的大小按缓存层级取：参数 0..3 分别对应工作集约为 L1/2、L2/2、LLC/2
+// 和 4 倍 LLC（缓存大小取自 sysconf，拿不到时用常见值）。
+
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "hashtable_wrapper.h"
+
+using namespace myLru;
+
+namespace {
+
+// 和分片里一样存节点指针
+using Table = HashTableWrapper<KeyType, void*, HashFuncImpl>;
+
+// 每个元素的大致内存：节点（key、value、hash、next）加 malloc 开销和桶指针
+constexpr size_t kBytesPerEntry = 64;
+
+auto backend_name() -> const char* {
+#if defined(USE_MY_HASH_TABLE)
+  return "my_hash_table";
+#elif defined(USE_SEG_HASH_TABLE)
+  return "seg_hash_table";
+#else
+  return "libcuckoo";
+#endif
+}
+
+auto cache_bytes(int name, size_t fallback) -> size_t {
+  long bytes = sysconf(name);
+  return bytes > 0 ? static_cast<size_t>(bytes) : fallback;
+}
+
+// 0: L1，1: L2，2: LLC，3: DRAM
+auto tier_entries(int64_t tier) -> size_t {
+  static const size_t l1 = cache_bytes(_SC_LEVEL1_DCACHE_SIZE, 32 << 10);
+  static const size_t l2 = cache_bytes(_SC_LEVEL2_CACHE_SIZE, 1 << 20);
+  static const size_t llc = cache_bytes(_SC_LEVEL3_CACHE_SIZE, 32 << 20);
+  size_t bytes = tier == 0 ? l1 / 2 : tier == 1 ? l2 / 2 : tier == 2 ? llc / 2
+                                                                      : llc * 4;
+  return std::max<size_t>(64, bytes / kBytesPerEntry);
+}
+
+auto tier_label(int64_t tier, size_t entries) -> std::string {
+  static const char* names[] = {"L1", "L2", "LLC", "DRAM"};
+  return std::string(backend_name()) + " " + names[tier] +
+         " n=" + std::to_string(entries);
+}
+
+auto value_of(KeyType key) -> void* {
+  return reinterpret_cast<void*>(static_cast<uintptr_t>(key) + 1);
+}
+
+// [base, base + n) 打乱顺序，插入和查找都按随机顺序进行
+auto shuffled_keys(KeyType base, size_t n, uint64_t seed)
+    -> std::vector<KeyType> {
+  std::vector<KeyType> keys(n);
+  std::iota(keys.begin(), keys.end(), base);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(seed));
+  return keys;
+}
+
+auto make_table(size_t entries) -> std::unique_ptr<Table> {
+  auto table = std::make_unique<Table>();
+  table->Reserve(entries);
+  for (KeyType key : shuffled_keys(0, entries, COMMON_BASE_SEED)) {
+    table->Insert(key, value_of(key));
+  }
+  return table;
+}
+
+void BM_GetHit(benchmark::State& state) {
+  size_t n = tier_entries(state.range(0));
+  auto table = make_table(n);
+  auto keys = shuffled_keys(0, n, COMMON_BASE_SEED + 1);
+  void* value = nullptr;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table->Get(keys[i], value));
+    if (++i == n) {
+      i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(tier_label(state.range(0), n));
+}
+
+void BM_GetMiss(benchmark::State& state) {
+  size_t n = tier_entries(state.range(0));
+  auto table = make_table(n);
+  auto keys = shuffled_keys(n, n, COMMON_BASE_SEED + 1);
+  void* value = nullptr;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(table->Get(keys[i], value));
+    if (++i == n) {
+      i = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(tier_label(state.range(0), n));
+}
+
+/**
+ * @brief 固定 64K 个桶，预先填到 load factor = range(0)/100，每轮计时插入
+ * 1% 的新 key，再不计时删掉，让负载保持不变。libcuckoo 的桶有 4 个槽，
+ * 同样的桶数下实际占用率只有其他后端的 1/4。
+ */
+void BM_InsertAtLoadFactor(benchmark::State& state) {
+  constexpr size_t kBuckets = 1 << 16;
+  constexpr size_t kBatch = kBuckets / 100;
+  size_t prefill = kBuckets * state.range(0) / 100;
+  Table table;
+  table.SetSize(kBuckets);
+  for (KeyType key : shuffled_keys(0, prefill, COMMON_BASE_SEED)) {
+    table.Insert(key, value_of(key));
+  }
+  auto fresh = shuffled_keys(prefill, kBatch, COMMON_BASE_SEED + 1);
+  for (auto _ : state) {
+    for (KeyType key : fresh) {
+      table.Insert(key, value_of(key));
+    }
+    state.PauseTiming();
+    for (KeyType key : fresh) {
+      table.Remove(key);
+    }
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+  state.SetLabel(std::string(backend_name()) +
+                 " lf=" + std::to_string(state.range(0) / 100.0));
+}
+
+// 每轮计时删除 1024 个 key，再不计时插回去
+void BM_Remove(benchmark::State& state) {
+  constexpr size_t kBatch = 1024;
+  size_t n = std::max(tier_entries(state.range(0)), kBatch);
+  auto table = make_table(n);
+  auto keys = shuffled_keys(0, n, COMMON_BASE_SEED + 1);
+  size_t offset = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kBatch; ++i) {
+      table->Remove(keys[offset + i]);
+    }
+    state.PauseTiming();
+    for (size_t i = 0; i < kBatch; ++i) {
+      table->Insert(keys[offset + i], value_of(keys[offset + i]));
+    }
+    offset = offset + 2 * kBatch <= n ? offset + kBatch : 0;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * kBatch);
+  state.SetLabel(tier_label(state.range(0), n));
+}
+
+// 多线程基准共享的表，由线程 0 在计时循环前建好、循环后释放。
+// google benchmark 在循环开始和结束时同步所有线程。
+std::unique_ptr<Table> shared_table;
+
+/**
+ * @brief 线程 0 从 1024 个桶开始插入新 key，到 range(0) 个后再全部删掉，
+ * 如此反复，表不停地扩容和缩容；其余线程同时查找一组常驻 key。
+ * 读线程的吞吐反映迁移期间查找的代价，写线程的吞吐反映迁移本身的代价。
+ */
+void BM_ResizeUnderLoad(benchmark::State& state) {
+  constexpr size_t kResident = 4096;
+  size_t grow_to = state.range(0);
+  if (state.thread_index() == 0) {
+    shared_table = std::make_unique<Table>();
+    // 挂上 resizer 才是增量迁移；没有 resizer 时扩容在触发它的 Insert 里完成
+    shared_table->SetResizer(&HashTableResizer::Instance());
+    shared_table->SetSize(1024);
+    for (KeyType key = 0; key < static_cast<KeyType>(kResident); ++key) {
+      shared_table->Insert(key, value_of(key));
+    }
+  }
+  auto resident =
+      shuffled_keys(0, kResident, COMMON_BASE_SEED + state.thread_index());
+  auto growing = shuffled_keys(kResident, grow_to, COMMON_BASE_SEED);
+  void* value = nullptr;
+  size_t i = 0;
+  bool removing = false;
+  for (auto _ : state) {
+    if (state.thread_index() == 0) {
+      if (removing) {
+        shared_table->Remove(growing[i]);
+      } else {
+        shared_table->Insert(growing[i], value_of(growing[i]));
+      }
+      if (++i == grow_to) {
+        i = 0;
+        removing = !removing;
+      }
+    } else {
+      benchmark::DoNotOptimize(shared_table->Get(resident[i], value));
+      if (++i == kResident) {
+        i = 0;
+      }
+    }
+  }
+  // 各线程的计数器会累加，读写分开统计
+  state.counters[state.thread_index() == 0 ? "writes" : "reads"] =
+      benchmark::Counter(state.iterations(), benchmark::Counter::kIsRate);
+  state.SetLabel(backend_name());
+  if (state.thread_index() == 0) {
+    shared_table.reset();
+  }
+}
+
+/**
+ * @brief 所有线程在同一张表上做 90% 命中查找、10% 删除后重新插入，
+ * 表的大小按 range(0) 的缓存层级取。每个线程只改自己那一段 key，
+ * 删除和插入总是成对成功，表的大小保持不变。
+ */
+void BM_Contention(benchmark::State& state) {
+  size_t n = tier_entries(state.range(0));
+  if (state.thread_index() == 0) {
+    shared_table = make_table(n);
+  }
+  std::mt19937_64 rng(COMMON_BASE_SEED + state.thread_index());
+  std::uniform_int_distribution<KeyType> any(0, n - 1);
+  std::vector<KeyType> ops(1 << 16);
+  for (auto& key : ops) {
+    key = any(rng);
+  }
+  // 线程 t 只删改 key % threads == t 的 key
+  KeyType threads = state.threads();
+  KeyType tid = state.thread_index();
+  void* value = nullptr;
+  size_t i = 0;
+  for (auto _ : state) {
+    KeyType key = ops[i];
+    if (i % 10 != 0) {
+      benchmark::DoNotOptimize(shared_table->Get(key, value));
+    } else {
+      key = key - key % threads + tid;
+      if (key >= static_cast<KeyType>(n)) {
+        key = tid;
+      }
+      shared_table->Remove(key);
+      shared_table->Insert(key, value_of(key));
+    }
+    i = (i + 1) & (ops.size() - 1);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(tier_label(state.range(0), n));
+  if (state.thread_index() == 0) {
+    shared_table.reset();
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_GetHit)->DenseRange(0, 3);
+BENCHMARK(BM_GetMiss)->DenseRange(0, 3);
+BENCHMARK(BM_InsertAtLoadFactor)->Arg(25)->Arg(50)->Arg(100)->Arg(150)->Arg(190);
+BENCHMARK(BM_Remove)->DenseRange(0, 3);
+BENCHMARK(BM_ResizeUnderLoad)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20)
+    ->ThreadRange(2, 8)
+    ->UseRealTime();
+BENCHMARK(BM_Contention)->DenseRange(1, 3)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
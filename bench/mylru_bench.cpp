@@ -0,0 +1,397 @@
+// YCSB 风格的负载驱动：按线程数扫描，结果输出为 CSV / JSON。
+//
+//   mylru_bench --cache=seg --capacity=1000000 --keys=10000000
+//               --threads=1,2,4,8 --dist=zipf --theta=0.99
+//               --read=0.95 --insert=0.05 --duration=5 --json=out.json
+//
+// 每个线程的操作序列在计时之前生成好，计时循环里只有缓存操作；
+// 所有线程就绪后同时开始，运行 duration 秒后停止。
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+
+using namespace myLru;
+using namespace myLru::bench;
+
+namespace {
+
+struct Options {
+  std::string cache_ = "seg";
+  size_t capacity_ = 1 << 20;
+  size_t keys_ = 1 << 22;
+  std::vector<size_t> threads_ = {1, 2, 4, 8};
+  std::string dist_ = "zipf";
+  double theta_ = 0.99;
+  // hotspot：hot_fraction_ 的 key 承担 hot_ops_ 的操作
+  double hot_fraction_ = 0.2;
+  double hot_ops_ = 0.8;
+  double read_ = 0.95;
+  double insert_ = 0.05;
+  double remove_ = 0;
+  // 读未命中时插入，模拟旁路缓存
+  bool read_through_ = true;
+  bool prefill_ = true;
+  double duration_ = 5;
+  size_t trace_ops_ = 1 << 20;
+  uint64_t seed_ = COMMON_BASE_SEED;
+  std::string csv_;
+  std::string json_;
+};
+
+enum class OpType : uint8_t { kRead, kInsert, kRemove };
+
+struct Op {
+  KeyType key_;
+  OpType type_;
+};
+
+/**
+ * @brief Gray 等人的 Zipf 生成器（YCSB 使用的同一算法），构造时 O(n)
+ * 计算 zeta，之后每次采样 O(1)。返回 [0, n) 的排名，0 最热。
+ */
+class ZipfGenerator {
+ public:
+  ZipfGenerator(uint64_t n, double theta) : n_(n), theta_(theta) {
+    zeta_n_ = zeta(n, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    double zeta2 = zeta(2, theta);
+    eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zeta_n_);
+    half_pow_theta_ = 1.0 + std::pow(0.5, theta);
+  }
+
+  template <typename Rng>
+  auto Next(Rng& rng) -> uint64_t {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    double uz = u * zeta_n_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < half_pow_theta_) {
+      return 1;
+    }
+    uint64_t rank = static_cast<uint64_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+    return rank < n_ ? rank : n_ - 1;
+  }
+
+ private:
+  uint64_t n_;
+  double theta_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+  double half_pow_theta_;
+
+  static auto zeta(uint64_t n, double theta) -> double {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+};
+
+auto usage() -> void {
+  std::cerr
+      << "usage: mylru_bench [--name=value ...]\n"
+         "  --cache=seg|seg_ht|lru    cache variant (default seg)\n"
+         "  --capacity=N              total entries (default 1048576)\n"
+         "  --keys=N                  key space (default 4194304)\n"
+         "  --threads=1,2,4,8         thread counts to sweep\n"
+         "  --dist=uniform|zipf|latest|hotspot\n"
+         "  --theta=0.99              zipf / latest skew\n"
+         "  --hot-fraction=0.2 --hot-ops=0.8   hotspot shape\n"
+         "  --read=0.95 --insert=0.05 --remove=0   op mix\n"
+         "  --workload=a|b|c|d        YCSB presets (sets mix and dist)\n"
+         "  --read-through=1          insert on read miss\n"
+         "  --prefill=1               fill the cache before timing\n"
+         "  --duration=5              seconds per sweep point\n"
+         "  --trace-ops=1048576       pre-generated ops per thread\n"
+         "  --seed=N\n"
+         "  --csv=path                CSV output (default stdout)\n"
+         "  --json=path               JSON output\n";
+}
+
+auto parse(int argc, char** argv, Options& opts) -> bool {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    if (name == "cache") {
+      opts.cache_ = value;
+    } else if (name == "capacity") {
+      opts.capacity_ = std::stoull(value);
+    } else if (name == "keys") {
+      opts.keys_ = std::stoull(value);
+    } else if (name == "threads") {
+      opts.threads_ = ParseList(value);
+    } else if (name == "dist") {
+      opts.dist_ = value;
+    } else if (name == "theta") {
+      opts.theta_ = std::stod(value);
+    } else if (name == "hot-fraction") {
+      opts.hot_fraction_ = std::stod(value);
+    } else if (name == "hot-ops") {
+      opts.hot_ops_ = std::stod(value);
+    } else if (name == "read") {
+      opts.read_ = std::stod(value);
+    } else if (name == "insert") {
+      opts.insert_ = std::stod(value);
+    } else if (name == "remove") {
+      opts.remove_ = std::stod(value);
+    } else if (name == "workload") {
+      // YCSB A/B/C/D；更新在缓存里就是 Insert
+      if (value == "a") {
+        opts.read_ = 0.5, opts.insert_ = 0.5, opts.dist_ = "zipf";
+      } else if (value == "b") {
+        opts.read_ = 0.95, opts.insert_ = 0.05, opts.dist_ = "zipf";
+      } else if (value == "c") {
+        opts.read_ = 1.0, opts.insert_ = 0, opts.dist_ = "zipf";
+      } else if (value == "d") {
+        opts.read_ = 0.95, opts.insert_ = 0.05, opts.dist_ = "latest";
+      } else {
+        return false;
+      }
+      opts.remove_ = 0;
+    } else if (name == "read-through") {
+      opts.read_through_ = value != "0";
+    } else if (name == "prefill") {
+      opts.prefill_ = value != "0";
+    } else if (name == "duration") {
+      opts.duration_ = std::stod(value);
+    } else if (name == "trace-ops") {
+      opts.trace_ops_ = std::stoull(value);
+    } else if (name == "seed") {
+      opts.seed_ = std::stoull(value);
+    } else if (name == "csv") {
+      opts.csv_ = value;
+    } else if (name == "json") {
+      opts.json_ = value;
+    } else {
+      return false;
+    }
+  }
+  double mix = opts.read_ + opts.insert_ + opts.remove_;
+  // Zipf 生成器要求 theta 在 (0, 1) 或 (1, +inf)
+  if (mix <= 0 || opts.keys_ == 0 || opts.threads_.empty() ||
+      opts.trace_ops_ == 0 || opts.theta_ <= 0 || opts.theta_ == 1) {
+    return false;
+  }
+  if (opts.dist_ != "uniform" && opts.dist_ != "zipf" &&
+      opts.dist_ != "latest" && opts.dist_ != "hotspot") {
+    return false;
+  }
+  opts.read_ /= mix;
+  opts.insert_ /= mix;
+  opts.remove_ /= mix;
+  return true;
+}
+
+/**
+ * @brief 生成线程 tid 的操作序列。latest 分布下插入产生新 key
+ * （keys_ 之后按线程交错编号），读按 Zipf 偏向最近插入的 key。
+ */
+auto generate(const Options& opts, ZipfGenerator* zipf, size_t tid,
+              size_t num_threads) -> std::vector<Op> {
+  std::mt19937_64 rng(opts.seed_ + tid);
+  std::uniform_real_distribution<double> coin(0, 1);
+  std::uniform_int_distribution<KeyType> uniform(0, opts.keys_ - 1);
+  KeyType hot_keys = std::max<KeyType>(1, opts.keys_ * opts.hot_fraction_);
+  std::uniform_int_distribution<KeyType> hot(0, hot_keys - 1);
+  std::uniform_int_distribution<KeyType> cold(
+      std::min<KeyType>(hot_keys, opts.keys_ - 1), opts.keys_ - 1);
+  KeyType newest = opts.keys_ - 1;
+  KeyType next_new = opts.keys_ + tid;
+
+  std::vector<Op> ops(opts.trace_ops_);
+  for (auto& op : ops) {
+    double pick = coin(rng);
+    op.type_ = pick < opts.read_                  ? OpType::kRead
+               : pick < opts.read_ + opts.insert_ ? OpType::kInsert
+                                                  : OpType::kRemove;
+    if (opts.dist_ == "latest" && op.type_ == OpType::kInsert) {
+      op.key_ = next_new;
+      newest = next_new;
+      next_new += num_threads;
+      continue;
+    }
+    if (opts.dist_ == "uniform") {
+      op.key_ = uniform(rng);
+    } else if (opts.dist_ == "zipf") {
+      op.key_ = zipf->Next(rng);
+    } else if (opts.dist_ == "latest") {
+      op.key_ = std::max<KeyType>(0, newest - zipf->Next(rng));
+    } else {
+      op.key_ = coin(rng) < opts.hot_ops_ ? hot(rng) : cold(rng);
+    }
+  }
+  return ops;
+}
+
+struct PointResult {
+  uint64_t ops_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t reads_ = 0;
+  double seconds_ = 0;
+};
+
+template <typename Cache>
+auto run_point(Cache& cache, const Options& opts,
+               const std::vector<std::vector<Op>>& traces, size_t num_threads)
+    -> PointResult {
+  if (opts.prefill_) {
+    KeyType fill = std::min(opts.capacity_, opts.keys_);
+    for (KeyType key = 0; key < fill; ++key) {
+      cache.Insert(key, ValueFor(key));
+    }
+  }
+  struct alignas(64) Counters {
+    uint64_t ops_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t reads_ = 0;
+  };
+  std::vector<Counters> counters(num_threads);
+  std::atomic<bool> stop(false);
+  StartBarrier barrier(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      const std::vector<Op>& ops = traces[t];
+      Counters local;
+      ValueType value;
+      barrier.Wait();
+      size_t i = 0;
+      // 每 256 次操作检查一次停止标志
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int n = 0; n < 256; ++n) {
+          const Op& op = ops[i];
+          if (++i == ops.size()) {
+            i = 0;
+          }
+          switch (op.type_) {
+            case OpType::kRead:
+              local.reads_++;
+              if (cache.Find(op.key_, value)) {
+                local.hits_++;
+              } else if (opts.read_through_) {
+                cache.Insert(op.key_, ValueFor(op.key_));
+              }
+              break;
+            case OpType::kInsert:
+              cache.Insert(op.key_, ValueFor(op.key_));
+              break;
+            case OpType::kRemove:
+              cache.Remove(op.key_);
+              break;
+          }
+        }
+        local.ops_ += 256;
+      }
+      counters[t] = local;
+    });
+  }
+  barrier.Release();
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(opts.duration_));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  PointResult result;
+  result.seconds_ = std::chrono::duration<double>(end - start).count();
+  for (const auto& c : counters) {
+    result.ops_ += c.ops_;
+    result.hits_ += c.hits_;
+    result.reads_ += c.reads_;
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  if (!parse(argc, argv, opts)) {
+    usage();
+    return 2;
+  }
+  size_t max_threads = 0;
+  for (size_t n : opts.threads_) {
+    max_threads = std::max(max_threads, n);
+  }
+
+  std::cerr << "generating " << opts.trace_ops_ << " ops x " << max_threads
+            << " threads (" << opts.dist_ << ")" << std::endl;
+  std::unique_ptr<ZipfGenerator> zipf;
+  if (opts.dist_ == "zipf" || opts.dist_ == "latest") {
+    zipf = std::make_unique<ZipfGenerator>(opts.keys_, opts.theta_);
+  }
+  std::vector<std::vector<Op>> traces(max_threads);
+  {
+    std::vector<std::thread> generators;
+    for (size_t t = 0; t < max_threads; ++t) {
+      generators.emplace_back([&, t] {
+        traces[t] = generate(opts, zipf.get(), t, max_threads);
+      });
+    }
+    for (auto& thread : generators) {
+      thread.join();
+    }
+  }
+
+  ResultWriter writer(opts.csv_, opts.json_);
+  if (!writer.Ok()) {
+    std::cerr << "cannot open output file" << std::endl;
+    return 1;
+  }
+  for (size_t num_threads : opts.threads_) {
+    if (num_threads == 0) {
+      continue;
+    }
+    PointResult result;
+    bool known = WithCache(opts.cache_, opts.capacity_, [&](auto& cache) {
+      result = run_point(cache, opts, traces, num_threads);
+    });
+    if (!known) {
+      std::cerr << "unknown cache variant: " << opts.cache_ << std::endl;
+      usage();
+      return 2;
+    }
+    ResultRow row;
+    row.Add("cache", opts.cache_)
+        .Add("policy", std::string(PolicyName()))
+        .Add("index", std::string(IndexName()))
+        .Add("segments", segNum)
+        .Add("capacity", opts.capacity_)
+        .Add("keys", opts.keys_)
+        .Add("dist", opts.dist_)
+        .Add("theta", opts.theta_)
+        .Add("read", opts.read_)
+        .Add("insert", opts.insert_)
+        .Add("remove", opts.remove_)
+        .Add("threads", num_threads)
+        .Add("seconds", result.seconds_)
+        .Add("ops", result.ops_)
+        .Add("ops_per_sec", result.ops_ / result.seconds_)
+        .Add("hit_ratio", result.reads_ == 0 ? 0.0
+                                             : static_cast<double>(
+                                                   result.hits_) /
+                                                   result.reads_);
+    writer.Write(row);
+  }
+  return 0;
+}
@@ -0,0 +1,512 @@
+// 缓存 trace 回放：按容量扫描，输出命中率和吞吐（CSV / JSON）。
+//
+//   mylru_replay --trace=twitter.csv --format=twitter --cache=seg
+//                --capacities=10000,100000,1000000 --threads=1,4
+//
+// 每个容量先在单个分片（--cache=lru）上单线程按原顺序回放一遍，得到精确的
+// 命中率；--threads 给出的每个线程数再按 key 把 trace 分给各线程，在 --cache
+// 上并发回放一遍，测吞吐。同一个 key 总落在同一个线程，它的访问顺序不变。
+// 输出的 capacity 是缓存实际的 Capacity()。
+//
+// trace 通过 mmap 读入，支持的格式：
+//   text     每行一个 key
+//   bin      连续的 int64 key（本机字节序）
+//   csv      --key-column 列是 key，可选 --op-column 列是操作
+//   twitter  Twitter cache trace：timestamp,key,key_size,value_size,client,op,ttl
+//   msr      MSR Cambridge：timestamp,host,disk,type,offset,size,latency，
+//            offset 作为 key
+//   access   SegLRUCache::StartAccessTrace 记录的文件，按时间排序后回放，
+//            key 是记录里的 key hash
+// 不是整数的 key 用 FNV-1a 映射成 int64。没有操作列时每条都是读。
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "access_trace.h"
+#include "bench_common.h"
+
+using namespace myLru;
+using namespace myLru::bench;
+
+namespace {
+
+enum class OpType : uint8_t { kRead, kWrite, kRemove };
+
+struct Options {
+  std::string trace_;
+  std::string format_ = "text";
+  int key_column_ = 0;
+  int op_column_ = -1;
+  // 跳过第一行表头（已发布的 Twitter / MSR trace 都没有表头）
+  bool header_ = false;
+  std::string cache_ = "seg";
+  std::vector<size_t> capacities_;
+  // 没给 --capacities 时按 trace 里不同 key 数的比例取容量
+  std::vector<double> fractions_ = {0.001, 0.01, 0.05, 0.1, 0.2, 0.5};
+  std::vector<size_t> threads_;
+  // 前 warmup_ 比例的请求只预热，不计入命中率（只影响单线程回放）
+  double warmup_ = 0;
+  bool read_through_ = true;
+  std::string csv_;
+  std::string json_;
+};
+
+struct Trace {
+  std::vector<KeyType> keys_;
+  // 为空表示全部是读
+  std::vector<OpType> ops_;
+};
+
+auto usage() -> void {
+  std::cerr
+      << "usage: mylru_replay --trace=path [--name=value ...]\n"
+         "  --format=text|bin|csv|twitter|msr|access\n"
+         "                                      trace format (default text)\n"
+         "  --key-column=N --op-column=N        csv columns, 0-based\n"
+         "  --header=1                          skip the first line\n"
+         "  --cache=seg|seg_ht|lru              cache variant (default seg)\n"
+         "  --capacities=N,N,...                cache sizes in entries\n"
+         "  --fractions=0.01,0.1,...            sizes as a fraction of the\n"
+         "                                      distinct keys (default)\n"
+         "  --threads=1,2,4                     also replay partitioned\n"
+         "  --warmup=0.1                        leading fraction not counted\n"
+         "  --read-through=1                    insert on read miss\n"
+         "  --csv=path --json=path              outputs (CSV default stdout)\n";
+}
+
+auto parse(int argc, char** argv, Options& opts) -> bool {
+  bool read_through_set = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+      return false;
+    }
+    std::string name = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    if (name == "trace") {
+      opts.trace_ = value;
+    } else if (name == "format") {
+      opts.format_ = value;
+    } else if (name == "key-column") {
+      opts.key_column_ = std::stoi(value);
+    } else if (name == "op-column") {
+      opts.op_column_ = std::stoi(value);
+    } else if (name == "header") {
+      opts.header_ = value != "0";
+    } else if (name == "cache") {
+      opts.cache_ = value;
+    } else if (name == "capacities") {
+      opts.capacities_ = ParseList(value);
+    } else if (name == "fractions") {
+      opts.fractions_.clear();
+      std::stringstream in(value);
+      std::string item;
+      while (std::getline(in, item, ',')) {
+        opts.fractions_.push_back(std::stod(item));
+      }
+    } else if (name == "threads") {
+      opts.threads_ = ParseList(value);
+    } else if (name == "warmup") {
+      opts.warmup_ = std::stod(value);
+    } else if (name == "read-through") {
+      opts.read_through_ = value != "0";
+      read_through_set = true;
+    } else if (name == "csv") {
+      opts.csv_ = value;
+    } else if (name == "json") {
+      opts.json_ = value;
+    } else {
+      return false;
+    }
+  }
+  if (opts.format_ == "twitter") {
+    opts.key_column_ = 1, opts.op_column_ = 5;
+  } else if (opts.format_ == "msr") {
+    opts.key_column_ = 4, opts.op_column_ = 3;
+  } else if (opts.format_ == "access") {
+    // 记录里已经有未命中之后的 Insert
+    opts.read_through_ = read_through_set && opts.read_through_;
+  } else if (opts.format_ != "text" && opts.format_ != "bin" &&
+             opts.format_ != "csv") {
+    return false;
+  }
+  return !opts.trace_.empty() && opts.key_column_ >= 0 && opts.warmup_ >= 0 &&
+         opts.warmup_ < 1;
+}
+
+// 只读映射整个文件，析构时解除
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data_ = static_cast<const char*>(addr);
+        size_ = st.st_size;
+        madvise(addr, size_, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  auto Data() const -> const char* { return data_; }
+  auto Size() const -> size_t { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// 整数原样返回，其余用 FNV-1a 映射；空字段返回 false
+auto parse_key(const char* begin, const char* end, KeyType& key) -> bool {
+  while (begin < end && (*begin == ' ' || *begin == '"')) {
+    begin++;
+  }
+  while (end > begin &&
+         (end[-1] == ' ' || end[-1] == '"' || end[-1] == '\r')) {
+    end--;
+  }
+  if (begin == end) {
+    return false;
+  }
+  const char* p = begin + (*begin == '-' ? 1 : 0);
+  bool numeric = p < end && end - p <= 18;
+  uint64_t value = 0;
+  for (; numeric && p < end; ++p) {
+    numeric = *p >= '0' && *p <= '9';
+    value = value * 10 + (*p - '0');
+  }
+  if (numeric) {
+    key = *begin == '-' ? -static_cast<KeyType>(value)
+                        : static_cast<KeyType>(value);
+    return true;
+  }
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (p = begin; p < end; ++p) {
+    hash = (hash ^ static_cast<unsigned char>(*p)) * 0x100000001b3ULL;
+  }
+  key = static_cast<KeyType>(hash);
+  return true;
+}
+
+// get/gets/read 是读，delete 是删除，其余（set、add、Write...）按写处理
+auto parse_op(const char* begin, const char* end) -> OpType {
+  std::string op(begin, end);
+  for (auto& c : op) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  if (op.rfind("get", 0) == 0 || op.rfind("read", 0) == 0) {
+    return OpType::kRead;
+  }
+  if (op.rfind("delete", 0) == 0) {
+    return OpType::kRemove;
+  }
+  return OpType::kWrite;
+}
+
+auto load_trace(const Options& opts, Trace& trace) -> bool {
+  MappedFile file(opts.trace_);
+  if (file.Data() == nullptr) {
+    return false;
+  }
+  const char* data = file.Data();
+  size_t size = file.Size();
+  if (opts.format_ == "bin") {
+    trace.keys_.resize(size / sizeof(KeyType));
+    std::memcpy(trace.keys_.data(), data,
+                trace.keys_.size() * sizeof(KeyType));
+    return true;
+  }
+  if (opts.format_ == "access") {
+    AccessTraceHeader header;
+    if (size < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic_, AccessTracer::kMagic,
+                    sizeof(header.magic_)) != 0 ||
+        header.record_size_ != sizeof(AccessRecord)) {
+      return false;
+    }
+    std::vector<AccessRecord> records(
+        (size - sizeof(header)) / sizeof(AccessRecord));
+    std::memcpy(records.data(), data + sizeof(header),
+                records.size() * sizeof(AccessRecord));
+    // 文件里只有同一线程的记录有序
+    std::stable_sort(records.begin(), records.end(),
+                     [](const AccessRecord& a, const AccessRecord& b) {
+                       return a.TimeUs() < b.TimeUs();
+                     });
+    for (const auto& record : records) {
+      trace.keys_.push_back(static_cast<KeyType>(record.key_hash_));
+      trace.ops_.push_back(record.Op() == AccessOp::kFind     ? OpType::kRead
+                           : record.Op() == AccessOp::kInsert ? OpType::kWrite
+                                                              : OpType::kRemove);
+    }
+    return true;
+  }
+  bool csv = opts.format_ != "text";
+  const char* line = data;
+  const char* end = data + size;
+  bool skip = opts.header_;
+  while (line < end) {
+    const char* eol =
+        static_cast<const char*>(std::memchr(line, '\n', end - line));
+    if (eol == nullptr) {
+      eol = end;
+    }
+    if (skip) {
+      skip = false;
+      line = eol + 1;
+      continue;
+    }
+    KeyType key;
+    OpType op = OpType::kRead;
+    bool ok;
+    if (!csv) {
+      ok = parse_key(line, eol, key);
+    } else {
+      // 找到 key 列和操作列
+      ok = false;
+      int last = std::max(opts.key_column_, opts.op_column_);
+      const char* field = line;
+      for (int column = 0; column <= last; ++column) {
+        const char* comma = static_cast<const char*>(
+            std::memchr(field, ',', eol - field));
+        const char* field_end = comma == nullptr ? eol : comma;
+        if (column == opts.key_column_) {
+          ok = parse_key(field, field_end, key);
+        }
+        if (column == opts.op_column_) {
+          op = parse_op(field, field_end);
+        }
+        if (comma == nullptr) {
+          break;
+        }
+        field = comma + 1;
+      }
+    }
+    if (ok) {
+      trace.keys_.push_back(key);
+      if (opts.op_column_ >= 0) {
+        trace.ops_.push_back(op);
+      }
+    }
+    line = eol + 1;
+  }
+  return true;
+}
+
+struct ReplayResult {
+  uint64_t requests_ = 0;
+  uint64_t reads_ = 0;
+  uint64_t hits_ = 0;
+  double seconds_ = 0;
+};
+
+// 回放 [begin, end) 中的请求，下标小于 count_from 的不计入统计
+template <typename Cache>
+auto replay(Cache& cache, const Options& opts, const Trace& trace,
+            const std::vector<uint32_t>* index, size_t begin, size_t end,
+            size_t count_from, ReplayResult& result) -> void {
+  ValueType value;
+  for (size_t i = begin; i < end; ++i) {
+    size_t at = index == nullptr ? i : (*index)[i];
+    KeyType key = trace.keys_[at];
+    OpType op = trace.ops_.empty() ? OpType::kRead : trace.ops_[at];
+    bool counted = i >= count_from;
+    switch (op) {
+      case OpType::kRead:
+        if (cache.Find(key, value)) {
+          result.hits_ += counted;
+        } else if (opts.read_through_) {
+          cache.Insert(key, ValueFor(key));
+        }
+        result.reads_ += counted;
+        break;
+      case OpType::kWrite:
+        cache.Insert(key, ValueFor(key));
+        break;
+      case OpType::kRemove:
+        cache.Remove(key);
+        break;
+    }
+    result.requests_ += counted;
+  }
+}
+
+template <typename Cache>
+auto replay_exact(Cache& cache, const Options& opts, const Trace& trace)
+    -> ReplayResult {
+  ReplayResult result;
+  size_t warmup = trace.keys_.size() * opts.warmup_;
+  auto start = std::chrono::steady_clock::now();
+  replay(cache, opts, trace, nullptr, 0, trace.keys_.size(), warmup, result);
+  result.seconds_ = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  return result;
+}
+
+// parts[t] 是分给线程 t 的请求下标，保持原顺序
+template <typename Cache>
+auto replay_parallel(Cache& cache, const Options& opts, const Trace& trace,
+                     const std::vector<std::vector<uint32_t>>& parts)
+    -> ReplayResult {
+  std::vector<ReplayResult> results(parts.size());
+  StartBarrier barrier(parts.size());
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < parts.size(); ++t) {
+    threads.emplace_back([&, t] {
+      barrier.Wait();
+      replay(cache, opts, trace, &parts[t], 0, parts[t].size(), 0, results[t]);
+    });
+  }
+  barrier.Release();
+  auto start = std::chrono::steady_clock::now();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  ReplayResult total;
+  total.seconds_ = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  for (const auto& r : results) {
+    total.requests_ += r.requests_;
+    total.reads_ += r.reads_;
+    total.hits_ += r.hits_;
+  }
+  return total;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  if (!parse(argc, argv, opts)) {
+    usage();
+    return 2;
+  }
+  Trace trace;
+  auto load_start = std::chrono::steady_clock::now();
+  if (!load_trace(opts, trace) || trace.keys_.empty()) {
+    std::cerr << "cannot read trace: " << opts.trace_ << std::endl;
+    return 1;
+  }
+  if (trace.keys_.size() > UINT32_MAX) {
+    std::cerr << "trace too long (more than 2^32 requests)" << std::endl;
+    return 1;
+  }
+  size_t distinct =
+      std::unordered_set<KeyType>(trace.keys_.begin(), trace.keys_.end())
+          .size();
+  std::cerr << "loaded " << trace.keys_.size() << " requests, " << distinct
+            << " distinct keys in "
+            << std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - load_start)
+                   .count()
+            << " s" << std::endl;
+
+  std::vector<size_t> capacities = opts.capacities_;
+  if (capacities.empty()) {
+    for (double fraction : opts.fractions_) {
+      capacities.push_back(std::max<size_t>(1, distinct * fraction));
+    }
+  }
+
+  // 按 key 分区，线程 t 拿到 hash % n == t 的请求
+  std::vector<std::vector<std::vector<uint32_t>>> partitions;
+  for (size_t n : opts.threads_) {
+    std::vector<std::vector<uint32_t>> parts(std::max<size_t>(1, n));
+    HashFuncImpl hash;
+    for (size_t i = 0; i < trace.keys_.size(); ++i) {
+      parts[hash(trace.keys_[i]) % parts.size()].push_back(i);
+    }
+    partitions.push_back(std::move(parts));
+  }
+
+  ResultWriter writer(opts.csv_, opts.json_);
+  if (!writer.Ok()) {
+    std::cerr << "cannot open output file" << std::endl;
+    return 1;
+  }
+  // capacity 是缓存实际的 Capacity()，不是命令行给出的大小
+  auto emit = [&](const std::string& cache, size_t capacity, const char* mode,
+                  size_t threads, const ReplayResult& result) {
+    ResultRow row;
+    row.Add("trace", opts.trace_)
+        .Add("format", opts.format_)
+        .Add("cache", cache)
+        .Add("policy", std::string(PolicyName()))
+        .Add("index", std::string(IndexName()))
+        .Add("capacity", capacity)
+        .Add("distinct_keys", distinct)
+        .Add("mode", std::string(mode))
+        .Add("threads", threads)
+        .Add("requests", result.requests_)
+        .Add("hit_ratio",
+             result.reads_ == 0
+                 ? 0.0
+                 : static_cast<double>(result.hits_) / result.reads_)
+        .Add("seconds", result.seconds_)
+        .Add("ops_per_sec", result.requests_ / result.seconds_);
+    writer.Write(row);
+  };
+
+  if (CacheCapacity(opts.cache_, 1) == 0) {
+    std::cerr << "unknown cache variant: " << opts.cache_ << std::endl;
+    usage();
+    return 2;
+  }
+  // 分片缓存的容量按 segNum 向下取整，取整后相同的大小只跑一次
+  std::set<size_t> seen;
+  for (size_t requested : capacities) {
+    size_t capacity = CacheCapacity(opts.cache_, requested);
+    if (!seen.insert(capacity).second) {
+      std::cerr << "skipping capacity " << requested << ": same " << opts.cache_
+                << " cache (" << capacity << " entries) as an earlier size"
+                << std::endl;
+      continue;
+    }
+    // 精确命中率用单个分片、一把锁按原顺序回放，容量和 opts.cache_ 相同，
+    // 不受 key 在分片之间分布不均的影响
+    ReplayResult result;
+    WithCache("lru", capacity, [&](auto& cache) {
+      result = replay_exact(cache, opts, trace);
+      emit("lru", cache.Capacity(), "exact", 1, result);
+    });
+    for (const auto& parts : partitions) {
+      WithCache(opts.cache_, capacity, [&](auto& cache) {
+        result = replay_parallel(cache, opts, trace, parts);
+        emit(opts.cache_, cache.Capacity(), "partitioned", parts.size(),
+             result);
+      });
+    }
+  }
+  return 0;
+}
@@ -45,11 +45,6 @@ TEST_CONFIGURATIONS = [
         "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HASH_RESIZER",
         "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HASH_RESIZER"
     },
-    {
-        "name": "WithResizer_SharedMutex_MyHashTable",
-        "mt_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HASH_RESIZER;USE_SHARED_LATCH",
-        "mt_ht_features": "PRE_ALLOCATE;USE_MY_HASH_TABLE;USE_HHVM;USE_HASH_RESIZER;USE_SHARED_LATCH"
-    },
     {
         "name": "NoResizer_SegHashTable",
         "mt_features": "PRE_ALLOCATE;USE_SEG_HASH_TABLE",
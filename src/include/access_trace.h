@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace myLru {
+
+enum class AccessOp : uint8_t { kFind, kInsert, kRemove };
+
+/**
+ * @brief 一条访问记录，16 字节。meta_ 的低 40 位是开始记录以来的微秒数
+ * （约 12 天后回绕），之后依次是 16 位分片号、2 位操作和 1 位结果：
+ * Find 命中、Insert 插入了新 key、Remove 删除了 key 时为 1。
+ */
+struct AccessRecord {
+  uint64_t key_hash_;
+  uint64_t meta_;
+
+  static auto Make(uint64_t time_us, AccessOp op, uint64_t key_hash,
+                   uint32_t shard, bool hit) -> AccessRecord {
+    return {key_hash, (time_us & kTimeMask) |
+                          (static_cast<uint64_t>(shard & 0xffff) << 40) |
+                          (static_cast<uint64_t>(op) << 56) |
+                          (static_cast<uint64_t>(hit) << 58)};
+  }
+  auto TimeUs() const -> uint64_t { return meta_ & kTimeMask; }
+  auto Shard() const -> uint32_t { return (meta_ >> 40) & 0xffff; }
+  auto Op() const -> AccessOp {
+    return static_cast<AccessOp>((meta_ >> 56) & 3);
+  }
+  auto Hit() const -> bool { return (meta_ >> 58) & 1; }
+
+  static constexpr uint64_t kTimeMask = (uint64_t(1) << 40) - 1;
+};
+
+// 文件头，后面是连续的 AccessRecord。各线程的记录分批写入，文件内只保证
+// 同一线程的记录按时间排列，需要全局顺序时按 TimeUs 排序
+struct AccessTraceHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t record_size_;
+  uint32_t sample_rate_;
+  uint32_t num_shards_;
+  // 开始记录时的 Unix 时间（纳秒）
+  uint64_t start_unix_ns_;
+};
+
+/**
+ * @brief 访问记录器。每个线程第一次记录时注册一个自己的单生产者单消费者
+ * 环形队列，Record 只写本线程的队列，不加锁；队列满时丢弃并计数。
+ * 后台线程每隔 flush_interval 把所有队列里的记录追加到文件。线程退出时
+ * 它的队列被标记为退役，drain 取走最后的记录后释放。
+ *
+ * 按 key hash 抽样：hash 的第 16..47 位小于 2^32 / sample_rate 的 key 被
+ * 记录，同一个 key 要么每次都记、要么从不记，抽到的 key 集合在不同进程
+ * 和不同次运行之间也一致。没有在记录时 Record 只读一个原子变量。
+ */
+class AccessTracer {
+ public:
+  AccessTracer();
+  AccessTracer(const AccessTracer&) = delete;
+  AccessTracer& operator=(const AccessTracer&) = delete;
+  ~AccessTracer();
+
+  /**
+   * @brief 创建或截断 path 并开始记录，已在记录时先停止上一次。
+   * 文件打不开或 sample_rate 为 0 时返回 false。
+   */
+  auto Start(const std::string& path, uint32_t sample_rate,
+             uint32_t num_shards,
+             std::chrono::milliseconds flush_interval =
+                 std::chrono::milliseconds(100)) -> bool;
+  // 停止记录，写出队列里剩下的记录并关闭文件
+  auto Stop() -> void;
+  auto IsTracing() const -> bool {
+    return tracing_.load(std::memory_order_relaxed);
+  }
+
+  auto Record(AccessOp op, uint64_t key_hash, uint32_t shard, bool hit)
+      -> void {
+    if (!tracing_.load(std::memory_order_acquire) ||
+        ((key_hash >> 16) & 0xffffffff) >=
+            threshold_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    record(op, key_hash, shard, hit);
+  }
+
+  // 本次记录以来写入文件的条数和因队列满丢弃的条数
+  auto Written() const -> size_t {
+    return written_.load(std::memory_order_relaxed);
+  }
+  auto Dropped() const -> size_t;
+  // 当前登记的线程队列数，包括已退役但还没被 drain 释放的
+  auto Rings() const -> size_t;
+
+  // 每个线程的队列条数，128KB
+  static constexpr size_t kRingCapacity = 8192;
+  static constexpr char kMagic[8] = {'M', 'Y', 'L', 'R', 'U', 'T', 'R', 'C'};
+  static constexpr uint32_t kVersion = 1;
+
+ private:
+  class Ring;
+  struct ThreadRings;
+
+  std::atomic<bool> tracing_{false};
+  std::atomic<uint64_t> threshold_{0};
+  // 区分不同的记录器，线程缓存的队列指针只在 id 相同时有效
+  const uint64_t id_;
+  // 开始记录时 steady_clock 的纳秒数
+  std::atomic<int64_t> start_ns_{0};
+
+  mutable std::mutex rings_latch_;
+  // 线程退出后由线程一侧的 ThreadRings 和这里共同持有，谁后放手谁释放
+  std::vector<std::shared_ptr<Ring>> rings_;
+  // 已释放的队列丢弃的条数
+  size_t retired_dropped_ = 0;
+
+  std::FILE* file_ = nullptr;
+  std::atomic<size_t> written_{0};
+  std::thread flusher_;
+  std::mutex flusher_latch_;
+  std::condition_variable flusher_cv_;
+  bool flusher_stop_ = false;
+
+  auto record(AccessOp op, uint64_t key_hash, uint32_t shard, bool hit)
+      -> void;
+  auto ring_for_this_thread() -> Ring*;
+  static auto thread_rings() -> ThreadRings&;
+  // 把所有队列写入文件，file_ 为空时直接丢弃
+  auto drain() -> void;
+};
+
+// 读出整个 trace 文件，格式不对时返回 false
+auto ReadAccessTrace(const std::string& path, AccessTraceHeader& header,
+                     std::vector<AccessRecord>& records) -> bool;
+
+}  // namespace myLru
@@ -0,0 +1,345 @@
+#pragma once
+
+#if __cplusplus < 202002L
+#error "async_lru_cache.h needs C++20 coroutines (see mylru_tests_async)."
+#endif
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "lru_cache.h"
+namespace myLru {
+
+/**
+ * @brief 惰性启动的协程任务，co_await 时才开始执行，只能被 co_await 一次。
+ *
+ * 任务同步完成（没有挂起过）时等待者直接继续执行，不经过对称转移：
+ * 没有尾调用优化时（-O0、sanitizer）对称转移每次都会压栈，
+ * 循环里连续 co_await 同步完成的任务会把栈耗尽。
+ */
+template <typename T>
+class Task {
+ public:
+  struct promise_type {
+    std::optional<T> value_;
+    std::exception_ptr error_;
+    std::coroutine_handle<> continuation_;
+    // 任务结束和等待者挂起谁后到，谁负责恢复等待者
+    std::atomic<bool> rendezvous_{false};
+
+    auto get_return_object() -> Task {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+
+    struct FinalAwaiter {
+      auto await_ready() noexcept -> bool { return false; }
+      auto await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+          -> std::coroutine_handle<> {
+        promise_type& promise = handle.promise();
+        if (promise.rendezvous_.exchange(true, std::memory_order_acq_rel)) {
+          return promise.continuation_;
+        }
+        return std::noop_coroutine();
+      }
+      auto await_resume() noexcept -> void {}
+    };
+    auto final_suspend() noexcept -> FinalAwaiter { return {}; }
+    auto return_value(T value) -> void { value_.emplace(std::move(value)); }
+    auto unhandled_exception() -> void { error_ = std::current_exception(); }
+  };
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  auto operator co_await() && {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle_;
+      auto await_ready() noexcept -> bool { return false; }
+      auto await_suspend(std::coroutine_handle<> continuation) -> bool {
+        handle_.promise().continuation_ = continuation;
+        handle_.resume();
+        // 返回 false 表示任务已经同步完成，不挂起
+        return !handle_.promise().rendezvous_.exchange(
+            true, std::memory_order_acq_rel);
+      }
+      auto await_resume() -> T {
+        if (handle_.promise().error_) {
+          std::rethrow_exception(handle_.promise().error_);
+        }
+        return std::move(*handle_.promise().value_);
+      }
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @brief 协程互斥锁。没有竞争时 Lock 只是一次 CAS，不挂起；有竞争时把协程
+ * 放进等待队列，Unlock 直接把锁交给队首并返回它的句柄，由调用者决定在哪个
+ * 执行器上恢复。等待队列本身用自旋锁保护，临界区只有几条指令，
+ * 任何情况下都不会让 OS 线程睡眠。
+ */
+class AsyncMutex {
+ public:
+  auto TryLock() -> bool {
+    bool expected = false;
+    return locked_.compare_exchange_strong(expected, true,
+                                           std::memory_order_acquire);
+  }
+
+  auto Lock() {
+    struct LockAwaiter {
+      AsyncMutex* mutex_;
+      auto await_ready() -> bool { return mutex_->TryLock(); }
+      auto await_suspend(std::coroutine_handle<> handle) -> bool {
+        // 入队之后协程可能马上在别的线程恢复，之后不能再访问 this
+        AsyncMutex* mutex = mutex_;
+        mutex->lock_queue();
+        // 持有队列锁时再试一次，Unlock 看到空队列释放锁和这里入队是互斥的
+        if (mutex->TryLock()) {
+          mutex->unlock_queue();
+          return false;
+        }
+        mutex->waiters_.push_back(handle);
+        mutex->unlock_queue();
+        return true;
+      }
+      auto await_resume() -> void {}
+    };
+    return LockAwaiter{this};
+  }
+
+  // 有等待者时锁直接移交给它，返回需要恢复的句柄，否则返回空句柄
+  auto Unlock() -> std::coroutine_handle<> {
+    lock_queue();
+    if (waiters_.empty()) {
+      locked_.store(false, std::memory_order_release);
+      unlock_queue();
+      return {};
+    }
+    std::coroutine_handle<> next = waiters_.front();
+    waiters_.pop_front();
+    unlock_queue();
+    return next;
+  }
+
+ private:
+  std::atomic<bool> locked_{false};
+  std::atomic_flag queue_latch_ = ATOMIC_FLAG_INIT;
+  std::deque<std::coroutine_handle<>> waiters_;
+
+  auto lock_queue() -> void {
+    while (queue_latch_.test_and_set(std::memory_order_acquire)) {
+    }
+  }
+  auto unlock_queue() -> void { queue_latch_.clear(std::memory_order_release); }
+};
+
+#define ASYNCSEGLRUCACHE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define ASYNCSEGLRUCACHE AsyncSegLRUCache<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief SegLRUCache 的协程接口。每个分片前面有一把 AsyncMutex，
+ * 拿不到时挂起协程而不是阻塞线程；拿到之后分片自己的 latch_ 不会有竞争
+ * （前提是所有访问都经过这个类）。
+ *
+ * 被挂起的协程由 scheduler 恢复，它决定在哪个执行器上运行；
+ * 不传时在释放锁的线程上恢复。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class AsyncSegLRUCache {
+ public:
+  using Scheduler = std::function<void(std::coroutine_handle<>)>;
+
+  explicit AsyncSegLRUCache(size_t capacity_per_seg,
+                            Scheduler scheduler = nullptr)
+      : cache_(capacity_per_seg), scheduler_(std::move(scheduler)) {}
+  AsyncSegLRUCache(const AsyncSegLRUCache&) = delete;
+  AsyncSegLRUCache& operator=(const AsyncSegLRUCache&) = delete;
+
+  // 参数按值传递，惰性任务开始执行时调用方的临时对象可能已经析构
+  auto FindAsync(Key key) -> Task<std::optional<Value>> {
+    size_t idx = ShardOf(key);
+    co_await latch_[idx].Lock();
+    Value value;
+    bool found = cache_.Find(key, value);
+    unlock(idx);
+    if (!found) {
+      co_return std::nullopt;
+    }
+    co_return value;
+  }
+
+  auto InsertAsync(Key key, Value value) -> Task<bool> {
+    size_t idx = ShardOf(key);
+    co_await latch_[idx].Lock();
+    bool inserted = cache_.Insert(key, value);
+    unlock(idx);
+    co_return inserted;
+  }
+
+  auto RemoveAsync(Key key) -> Task<bool> {
+    size_t idx = ShardOf(key);
+    co_await latch_[idx].Lock();
+    bool removed = cache_.Remove(key);
+    unlock(idx);
+    co_return removed;
+  }
+
+  /**
+   * @brief 命中时直接返回，否则 co_await loader(key)（返回 Task<Value>）
+   * 并把结果插入缓存。同一个 key 同时只有一次加载，其余调用挂起等待
+   * 它的结果；加载抛出的异常会传给所有等待者。
+   */
+  template <typename Loader>
+  auto GetOrLoadAsync(Key key, Loader loader) -> Task<Value> {
+    size_t idx = ShardOf(key);
+    co_await latch_[idx].Lock();
+    Value value;
+    if (cache_.Find(key, value)) {
+      unlock(idx);
+      co_return value;
+    }
+    auto it = inflight_[idx].find(key);
+    if (it != inflight_[idx].end()) {
+      co_return co_await JoinAwaiter{this, idx, it->second, {}};
+    }
+    InflightLoad load;
+    inflight_[idx].emplace(key, &load);
+    unlock(idx);
+
+    std::exception_ptr error;
+    try {
+      value = co_await loader(key);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    co_await latch_[idx].Lock();
+    if (!error) {
+      cache_.Insert(key, value);
+    }
+    inflight_[idx].erase(key);
+    std::vector<Waiter*> waiters = std::move(load.waiters_);
+    unlock(idx);
+    for (Waiter* waiter : waiters) {
+      if (error) {
+        waiter->error_ = error;
+      } else {
+        waiter->value_ = value;
+      }
+      schedule(waiter->handle_);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    co_return value;
+  }
+
+  // 同步访问底层缓存，会阻塞线程，也不经过分片的 AsyncMutex
+  auto Cache() -> SegLRUCache<Key, Value, Hash, KeyEqual>& { return cache_; }
+
+ private:
+  struct Waiter {
+    std::coroutine_handle<> handle_;
+    std::optional<Value> value_;
+    std::exception_ptr error_;
+  };
+
+  // 由发起加载的协程持有，挂在 inflight_ 上直到加载结束
+  struct InflightLoad {
+    std::vector<Waiter*> waiters_;
+  };
+
+  // 在持有分片锁时登记到正在进行的加载上，挂起之后才释放分片锁
+  struct JoinAwaiter {
+    AsyncSegLRUCache* cache_;
+    size_t idx_;
+    InflightLoad* load_;
+    Waiter waiter_;
+
+    auto await_ready() noexcept -> bool { return false; }
+    auto await_suspend(std::coroutine_handle<> handle) -> void {
+      AsyncSegLRUCache* cache = cache_;
+      size_t idx = idx_;
+      waiter_.handle_ = handle;
+      load_->waiters_.push_back(&waiter_);
+      // 释放分片锁后加载可能立刻完成并恢复本协程，之后不能再访问 this
+      cache->unlock(idx);
+    }
+    auto await_resume() -> Value {
+      if (waiter_.error_) {
+        std::rethrow_exception(waiter_.error_);
+      }
+      return std::move(*waiter_.value_);
+    }
+  };
+
+  SegLRUCache<Key, Value, Hash, KeyEqual> cache_;
+  AsyncMutex latch_[segNum];
+  // 每个分片正在加载的 key，受对应的 latch_ 保护
+  std::unordered_map<Key, InflightLoad*, Hash, KeyEqual> inflight_[segNum];
+  Scheduler scheduler_;
+
+  // 必须和 SegLRUCache 选的分片一致，否则 AsyncMutex 保护不了分片的 latch_
+  static auto ShardOf(const Key& key) -> size_t {
+    return SegLRUCache<Key, Value, Hash, KeyEqual>::ShardOf(key);
+  }
+
+  auto unlock(size_t idx) -> void {
+    std::coroutine_handle<> next = latch_[idx].Unlock();
+    if (next) {
+      schedule(next);
+    }
+  }
+
+  auto schedule(std::coroutine_handle<> handle) -> void {
+    if (scheduler_) {
+      scheduler_(handle);
+      return;
+    }
+    // 在当前线程恢复。被恢复的协程再释放锁时只入队，由最外层循环依次恢复，
+    // 否则连续的锁交接会一层层嵌套在同一个调用栈上
+    struct Trampoline {
+      bool running_ = false;
+      std::deque<std::coroutine_handle<>> ready_;
+    };
+    static thread_local Trampoline trampoline;
+    trampoline.ready_.push_back(handle);
+    if (trampoline.running_) {
+      return;
+    }
+    trampoline.running_ = true;
+    while (!trampoline.ready_.empty()) {
+      std::coroutine_handle<> next = trampoline.ready_.front();
+      trampoline.ready_.pop_front();
+      next.resume();
+    }
+    trampoline.running_ = false;
+  }
+};
+
+}  // namespace myLru
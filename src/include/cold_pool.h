@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lz_codec.h"
+
+namespace myLru {
+
+/**
+ * @brief LRUCache 的冷池：被淘汰的条目按 LRU 顺序紧凑地保存在一块环形 arena 中。
+ *
+ * 冷池中的条目命中后立即取出放回 hot 链表，因此写入顺序就是 LRU 顺序，
+ * arena 只在头部追加、从尾部丢弃最旧的记录。每条记录是 8 字节头部
+ * （长度和标记、hash 的低 32 位）、key 和 value，按 4 字节对齐；取出和删除
+ * 只清掉记录的 live 标记，空间在尾部经过时回收。
+ *
+ * 索引是线性探测的开放寻址表，每个槽位 8 字节：hash 的低 32 位和记录在
+ * arena 中的位置，删除用 backward shift，不留墓碑。hash 由调用方传入，
+ * 从尾部丢弃和 Reset 重新放入时使用记录里保存的 hash，不再重新计算。
+ *
+ * sizeof(Value) 小于 kCompressMinBytes 时 LZ 格式的 token、偏移开销比能省下的
+ * 还多，直接保存原始字节；更大的 value 压缩后不变小时同样保存原始字节。
+ */
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+class ColdPool {
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_trivially_copyable<Value>::value,
+                "ColdPool stores keys and values as raw bytes");
+
+ public:
+  static constexpr size_t kCompressMinBytes = 64;
+  static constexpr bool kCompress = sizeof(Value) >= kCompressMinBytes;
+
+  ColdPool() = default;
+  ColdPool(const ColdPool&) = delete;
+  ColdPool& operator=(const ColdPool&) = delete;
+
+  /**
+   * @brief 按 budget_bytes 重新划分 arena 和索引。已有条目从旧到新重新放入，
+   * 放不下的最旧条目交给 on_drop(key, value)。
+   */
+  template <typename OnDrop>
+  auto Reset(size_t budget_bytes, OnDrop&& on_drop) -> void {
+    struct Entry {
+      Key key_;
+      uint32_t hash32_;
+      Value value_;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(live_);
+    for_each_record([&](const Key& key, uint32_t hash32, const Value& value) {
+      entries.push_back({key, hash32, value});
+    });
+    layout(budget_bytes);
+    // 索引只用到 hash 的低 32 位
+    for (const auto& entry : entries) {
+      Push(entry.key_, entry.hash32_, entry.value_, on_drop);
+    }
+  }
+
+  // 放入最新的条目，key 必须不在冷池中；空间不足时从最旧的一端丢弃
+  template <typename OnDrop>
+  auto Push(const Key& key, size_t hash, const Value& value, OnDrop&& on_drop)
+      -> void {
+    const void* data = &value;
+    size_t data_len = sizeof(Value);
+    uint32_t flags = kLive;
+    if (kCompress) {
+      LZCodec::Compress(&value, sizeof(Value), scratch_);
+      if (scratch_.size() < sizeof(Value)) {
+        data = scratch_.data();
+        data_len = scratch_.size();
+        flags |= kCompressed;
+      }
+    }
+    size_t size = kHeaderBytes + sizeof(Key) + data_len;
+    size_t step = align(size);
+    if (max_live_ == 0 || step > arena_size_) {
+      on_drop(key, value);
+      return;
+    }
+    while (live_ >= max_live_) {
+      drop_oldest(on_drop);
+    }
+    size_t pad;
+    while (true) {
+      if (head_ == tail_) {
+        head_ = tail_ = 0;
+      }
+      size_t pos = head_ % arena_size_;
+      pad = pos + step > arena_size_ ? arena_size_ - pos : 0;
+      if (head_ - tail_ + pad + step <= arena_size_) {
+        break;
+      }
+      drop_oldest(on_drop);
+    }
+    if (pad > 0) {
+      // 放不下的尾部写成一条已删除的记录，从 arena 开头继续
+      store_header(head_ % arena_size_, static_cast<uint32_t>(pad << 2));
+      head_ += pad;
+    }
+    size_t pos = head_ % arena_size_;
+    store_header(pos, static_cast<uint32_t>(size << 2) | flags);
+    store_hash(pos, static_cast<uint32_t>(hash));
+    std::memcpy(&arena_[pos + kHeaderBytes], &key, sizeof(Key));
+    std::memcpy(&arena_[pos + kHeaderBytes + sizeof(Key)], data, data_len);
+    index_insert(static_cast<uint32_t>(hash), pos);
+    head_ += step;
+    live_++;
+  }
+
+  // 找到 key 时解码到 value 并从冷池中删除
+  auto Take(const Key& key, size_t hash, Value& value) -> bool {
+    size_t slot;
+    if (!index_find(key, static_cast<uint32_t>(hash), slot)) {
+      return false;
+    }
+    size_t pos = slot_pos(index_[slot]);
+    bool decoded = decode(pos, value);
+    erase_at(slot, pos);
+    return decoded;
+  }
+
+  auto Erase(const Key& key, size_t hash) -> bool {
+    size_t slot;
+    if (!index_find(key, static_cast<uint32_t>(hash), slot)) {
+      return false;
+    }
+    erase_at(slot, slot_pos(index_[slot]));
+    return true;
+  }
+
+  // 从旧到新访问每个条目
+  template <typename Visit>
+  auto ForEach(Visit&& visit) const -> void {
+    for_each_record([&](const Key& key, uint32_t, const Value& value) {
+      visit(key, value);
+    });
+  }
+
+  auto Clear() -> void {
+    head_ = tail_ = 0;
+    live_ = 0;
+    std::fill(index_.begin(), index_.end(), 0);
+  }
+
+  auto Size() const -> size_t { return live_; }
+  // arena 中已用的字节（含已删除但未回收的记录），加上按最大负载折算的索引
+  auto Bytes() const -> size_t {
+    return (head_ - tail_) + live_ * kSlotBytes * kLoadDen / kLoadNum;
+  }
+
+ private:
+  // 长度和标记各占 4 字节的低 30 位和低 2 位，之后 4 字节是 hash 的低 32 位。
+  // 对齐产生的填充记录可能只有 4 字节，只写长度
+  static constexpr size_t kHeaderBytes = 2 * sizeof(uint32_t);
+  static constexpr size_t kAlign = 4;
+  static constexpr size_t kSlotBytes = sizeof(uint64_t);
+  // 索引最大负载 3/4
+  static constexpr size_t kLoadNum = 3;
+  static constexpr size_t kLoadDen = 4;
+  static constexpr uint32_t kLive = 1;
+  static constexpr uint32_t kCompressed = 2;
+
+  // 环形 arena，head_/tail_ 是单调增加的逻辑位置，取模后是物理位置
+  std::unique_ptr<uint8_t[]> arena_;
+  size_t arena_size_ = 0;
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+  // 槽位高 32 位是 hash 的低 32 位，低 32 位是 arena 位置 / kAlign + 1，0 为空
+  std::vector<uint64_t> index_;
+  size_t live_ = 0;
+  size_t max_live_ = 0;
+  std::string scratch_;
+
+  static auto align(size_t size) -> size_t {
+    return (size + kAlign - 1) & ~(kAlign - 1);
+  }
+  static auto slot_pos(uint64_t slot) -> size_t {
+    return (static_cast<uint32_t>(slot) - 1) * kAlign;
+  }
+  // 把 32 位 hash 均匀映射到 [0, index_.size())，索引大小不必是 2 的幂
+  auto home(uint32_t hash32) const -> size_t {
+    return static_cast<size_t>((static_cast<uint64_t>(hash32) *
+                                index_.size()) >> 32);
+  }
+  auto next(size_t slot) const -> size_t {
+    return slot + 1 == index_.size() ? 0 : slot + 1;
+  }
+
+  auto load_header(size_t pos) const -> uint32_t {
+    uint32_t header;
+    std::memcpy(&header, &arena_[pos], sizeof(header));
+    return header;
+  }
+  auto store_header(size_t pos, uint32_t header) -> void {
+    std::memcpy(&arena_[pos], &header, sizeof(header));
+  }
+  auto load_hash(size_t pos) const -> uint32_t {
+    uint32_t hash32;
+    std::memcpy(&hash32, &arena_[pos + sizeof(uint32_t)], sizeof(hash32));
+    return hash32;
+  }
+  auto store_hash(size_t pos, uint32_t hash32) -> void {
+    std::memcpy(&arena_[pos + sizeof(uint32_t)], &hash32, sizeof(hash32));
+  }
+
+  // 从旧到新访问每个条目和保存的 hash
+  template <typename Visit>
+  auto for_each_record(Visit&& visit) const -> void {
+    for (uint64_t cur = tail_; cur != head_;) {
+      size_t pos = cur % arena_size_;
+      uint32_t header = load_header(pos);
+      Value value;
+      if ((header & kLive) && decode(pos, value)) {
+        Key key;
+        std::memcpy(&key, &arena_[pos + kHeaderBytes], sizeof(Key));
+        visit(key, load_hash(pos), value);
+      }
+      cur += align(header >> 2);
+    }
+  }
+
+  /**
+   * @brief 每个条目的开销按未压缩记录估算（可压缩的类型按 2:1），
+   * 预算按这个比例分给 arena 和索引，两者同时用满。
+   */
+  auto layout(size_t budget_bytes) -> void {
+    size_t record =
+        align(kHeaderBytes + sizeof(Key) + (kCompress ? sizeof(Value) / 2
+                                                      : sizeof(Value)));
+    size_t per_entry = record * kLoadNum + kSlotBytes * kLoadDen;
+    max_live_ = budget_bytes * kLoadNum / per_entry;
+    size_t slots =
+        max_live_ == 0 ? 0 : (max_live_ * kLoadDen + kLoadNum - 1) / kLoadNum;
+    size_t index_bytes = slots * kSlotBytes;
+    arena_size_ = budget_bytes > index_bytes
+                      ? (budget_bytes - index_bytes) & ~(kAlign - 1)
+                      : 0;
+    // 不初始化，没有写到的页不会被分配
+    arena_.reset(arena_size_ > 0 ? new uint8_t[arena_size_] : nullptr);
+    index_.assign(slots, 0);
+    head_ = tail_ = 0;
+    live_ = 0;
+  }
+
+  auto decode(size_t pos, Value& value) const -> bool {
+    uint32_t header = load_header(pos);
+    const uint8_t* data = &arena_[pos + kHeaderBytes + sizeof(Key)];
+    if (!(header & kCompressed)) {
+      std::memcpy(&value, data, sizeof(Value));
+      return true;
+    }
+    size_t data_len = (header >> 2) - kHeaderBytes - sizeof(Key);
+    return LZCodec::Decompress(data, data_len, &value, sizeof(Value));
+  }
+
+  template <typename OnDrop>
+  auto drop_oldest(OnDrop&& on_drop) -> void {
+    size_t pos = tail_ % arena_size_;
+    uint32_t header = load_header(pos);
+    if (header & kLive) {
+      Key key;
+      std::memcpy(&key, &arena_[pos + kHeaderBytes], sizeof(Key));
+      Value value;
+      bool decoded = decode(pos, value);
+      size_t slot;
+      if (index_find(key, load_hash(pos), slot)) {
+        index_erase(slot);
+      }
+      live_--;
+      if (decoded) {
+        on_drop(key, value);
+      }
+    }
+    tail_ += align(header >> 2);
+  }
+
+  auto erase_at(size_t slot, size_t pos) -> void {
+    store_header(pos, load_header(pos) & ~kLive);
+    index_erase(slot);
+    live_--;
+    // 删除的正好是最旧的记录时直接回收，连同后面已删除的记录
+    while (tail_ != head_ && !(load_header(tail_ % arena_size_) & kLive)) {
+      tail_ += align(load_header(tail_ % arena_size_) >> 2);
+    }
+  }
+
+  auto index_find(const Key& key, uint32_t hash32, size_t& slot) const
+      -> bool {
+    if (live_ == 0) {
+      return false;
+    }
+    for (size_t i = home(hash32);; i = next(i)) {
+      uint64_t entry = index_[i];
+      if (entry == 0) {
+        return false;
+      }
+      if (static_cast<uint32_t>(entry >> 32) == hash32) {
+        Key stored;
+        std::memcpy(&stored, &arena_[slot_pos(entry) + kHeaderBytes],
+                    sizeof(Key));
+        if (KeyEqual()(stored, key)) {
+          slot = i;
+          return true;
+        }
+      }
+    }
+  }
+
+  auto index_insert(uint32_t hash32, size_t pos) -> void {
+    size_t i = home(hash32);
+    while (index_[i] != 0) {
+      i = next(i);
+    }
+    index_[i] = (static_cast<uint64_t>(hash32) << 32) | (pos / kAlign + 1);
+  }
+
+  // backward shift：把后面本该更靠前的槽位前移，填上空出的位置
+  auto index_erase(size_t slot) -> void {
+    size_t hole = slot;
+    for (size_t i = next(slot);; i = next(i)) {
+      uint64_t entry = index_[i];
+      if (entry == 0) {
+        break;
+      }
+      size_t want = home(static_cast<uint32_t>(entry >> 32));
+      // want 不在 (hole, i] 的环形区间内时，这个槽位可以移到 hole
+      bool movable = hole <= i ? (want <= hole || want > i)
+                               : (want <= hole && want > i);
+      if (movable) {
+        index_[hole] = entry;
+        hole = i;
+      }
+    }
+    index_[hole] = 0;
+  }
+};
+
+}  // namespace myLru
@@ -20,12 +20,6 @@ static const double size_ratio = 0.3;
 
 static const unsigned int COMMON_BASE_SEED = 8282347;
 
-struct ShardHashFunc {
-  size_t operator()(int64_t key) const noexcept {
-    return std::hash<int64_t>()(key);
-  }
-};
-
 struct HashFuncImpl {
   size_t operator()(int64_t key) const noexcept {
     uint64_t k = static_cast<uint64_t>(key);
@@ -46,6 +40,17 @@ struct HashFuncImpl {
   }
 };
 
+/**
+ * @brief 每次操作只算一次 HashFuncImpl：高 kNumSegBits 位选分片，分片内的
+ * 哈希表用低位选桶。两段位互不相关，同一分片里的 key 仍然均匀分布在所有桶上。
+ */
+inline auto ShardOfHash(size_t hash) -> uint32_t {
+  if (kNumSegBits == 0) {
+    return 0;
+  }
+  return static_cast<uint32_t>(hash >> (sizeof(size_t) * 8 - kNumSegBits));
+}
+
 using KeyType = int64_t;
 using ValueType = std::array<char, 16>;
 using HashType = HashFuncImpl;
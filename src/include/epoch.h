@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace myLru {
+
+/**
+ * @brief 基于 epoch 的内存回收（EBR）。
+ *
+ * 读者在访问共享结构前用 Guard 把当前全局 epoch 发布到自己的槽位，离开时
+ * 清空槽位。写者把摘下来的对象连同当时的 epoch 放进 RetireList，当所有
+ * 活跃读者的 epoch 都大于这个值时，再也没有读者能看到它，才真正释放。
+ * 读者只写自己的槽位，不加锁也不和写者竞争同一个 cache line。
+ */
+class EpochDomain {
+ public:
+  static constexpr size_t kMaxThreads = 1024;
+  static constexpr uint64_t kIdle = UINT64_MAX;
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch_{kIdle};
+    std::atomic<bool> taken_{false};
+  };
+
+  struct Local {
+    Slot* slot_ = nullptr;
+    size_t depth_ = 0;
+    ~Local() {
+      if (slot_ != nullptr) {
+        slot_->taken_.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+ public:
+  class Guard {
+   public:
+    explicit Guard(EpochDomain& domain) : local_(domain.local()) {
+      if (local_->depth_++ == 0) {
+        local_->slot_->epoch_.store(
+            domain.epoch_.load(std::memory_order_seq_cst),
+            std::memory_order_seq_cst);
+        // 槽位的写入必须先于之后对共享结构的读取被写者看到
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+    }
+    ~Guard() {
+      if (--local_->depth_ == 0) {
+        local_->slot_->epoch_.store(kIdle, std::memory_order_release);
+      }
+    }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    Local* local_;
+  };
+
+  static auto Instance() -> EpochDomain& {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  // 当前 epoch，摘除对象之后读取
+  auto Current() -> uint64_t {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+
+  // 推进全局 epoch 并返回活跃读者中最小的 epoch，没有活跃读者时返回新 epoch
+  auto Advance() -> uint64_t {
+    uint64_t min_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    size_t used = used_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < used; ++i) {
+      uint64_t e = slots_[i].epoch_.load(std::memory_order_seq_cst);
+      if (e < min_epoch) {
+        min_epoch = e;
+      }
+    }
+    return min_epoch;
+  }
+
+ private:
+  EpochDomain() = default;
+
+  // 线程第一次进入时占用一个空闲槽位，线程退出时归还
+  auto local() -> Local* {
+    static thread_local Local local;
+    if (local.slot_ == nullptr) {
+      for (size_t i = 0; i < kMaxThreads; ++i) {
+        bool expected = false;
+        if (slots_[i].taken_.compare_exchange_strong(
+                expected, true, std::memory_order_acq_rel)) {
+          local.slot_ = &slots_[i];
+          size_t used = used_.load(std::memory_order_relaxed);
+          while (used < i + 1 &&
+                 !used_.compare_exchange_weak(used, i + 1,
+                                              std::memory_order_release)) {
+          }
+          break;
+        }
+      }
+      if (local.slot_ == nullptr) {
+        throw std::runtime_error("EpochDomain: too many threads.");
+      }
+    }
+    return &local;
+  }
+
+  std::atomic<uint64_t> epoch_{1};
+  // 曾经被占用过的槽位数，Advance 只扫描这么多
+  std::atomic<size_t> used_{0};
+  Slot slots_[kMaxThreads];
+};
+
+/**
+ * @brief 等待回收的对象，由调用方加锁保护。每攒够 kReclaimBatch 个就推进
+ * 一次 epoch，释放所有已经没有读者能看到的对象。
+ */
+class RetireList {
+ public:
+  using Deleter = void (*)(void*);
+
+  RetireList() = default;
+  RetireList(const RetireList&) = delete;
+  RetireList& operator=(const RetireList&) = delete;
+  // 析构时不能再有读者
+  ~RetireList() {
+    for (auto& entry : retired_) {
+      entry.deleter_(entry.ptr_);
+    }
+  }
+
+  auto Retire(void* ptr, Deleter deleter) -> void {
+    retired_.push_back({EpochDomain::Instance().Current(), ptr, deleter});
+    if (retired_.size() >= kReclaimBatch) {
+      Reclaim();
+    }
+  }
+
+  auto Reclaim() -> void {
+    uint64_t min_epoch = EpochDomain::Instance().Advance();
+    size_t kept = 0;
+    for (auto& entry : retired_) {
+      if (entry.epoch_ < min_epoch) {
+        entry.deleter_(entry.ptr_);
+      } else {
+        retired_[kept++] = entry;
+      }
+    }
+    retired_.resize(kept);
+  }
+
+  auto Size() const -> size_t { return retired_.size(); }
+
+ private:
+  static constexpr size_t kReclaimBatch = 128;
+
+  struct Entry {
+    uint64_t epoch_;
+    void* ptr_;
+    Deleter deleter_;
+  };
+  std::vector<Entry> retired_;
+};
+
+}  // namespace myLru
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+namespace myLru {
+
+#define FLASHTIER_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define FLASHTIER FlashTier<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief 放在本地 SSD 上的第二级缓存，接收 DRAM 分片淘汰的条目。
+ *
+ * 文件按 kRegionSize 切成若干 region，当作环形日志使用：条目先追加到内存中的
+ * 活跃 region，写满后封存并交给后台线程整块写入（定义 USE_IO_URING 时一批
+ * region 通过一次 io_uring_enter 提交，否则逐个 pwrite）。日志绕回一圈后，
+ * 最老的 region 连同它在索引中的条目一起作废。
+ *
+ * 内存中只保留 key 指纹（Hash()(key)）到日志偏移的索引，按指纹分成
+ * kIndexStripes 段各自加锁。Find 在调用线程上用 pread 取回一条记录；
+ * FindBatch 把一批 key 中需要读盘的记录合并成一次 io_uring_enter 提交
+ * （没有 USE_IO_URING 或内核不支持时逐条 pread）。取回后比较 key，
+ * 指纹冲突或 region 在读取期间被覆盖都按未命中处理。
+ * Key 和 Value 必须可以按字节复制。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class FlashTier {
+ public:
+  FlashTier();
+  FlashTier(const FlashTier&) = delete;
+  FlashTier& operator=(const FlashTier&) = delete;
+  ~FlashTier();
+
+  /**
+   * @brief 创建或截断 path，使用其中 capacity_bytes 字节（向下取整到
+   * region 大小）。容量不足 kMinRegions 个 region 或文件打不开时返回 false。
+   */
+  auto Open(const std::string& path, size_t capacity_bytes) -> bool;
+  auto Close() -> void;
+  auto IsOpen() const -> bool { return fd_ >= 0; }
+
+  /**
+   * @brief 追加一条被淘汰的条目。只复制到内存 buffer，不等待 I/O；
+   * 后台线程来不及写盘时丢弃这一条并返回 false。
+   */
+  auto Admit(const Key& key, const Value& value) -> bool {
+    return Admit(key, Hash()(key), value);
+  }
+  // 以下带 hash 的版本传入调用方已经算好的 Hash()(key)，直接作为指纹
+  auto Admit(const Key& key, size_t hash, const Value& value) -> bool;
+  // offset 不为空时写入命中记录的日志偏移，供 Indexed 之后确认
+  auto Find(const Key& key, Value& value, uint64_t* offset = nullptr) -> bool {
+    return Find(key, Hash()(key), value, offset);
+  }
+  auto Find(const Key& key, size_t hash, Value& value,
+            uint64_t* offset = nullptr) -> bool;
+  /**
+   * @brief 一次查找 count 个 key，hashes[i] 为 Hash()(keys[i])。found[i]
+   * 表示 keys[i] 是否命中，命中时写入 values[i] 和 offsets[i]。返回命中数。
+   * 读盘的记录每 kReadBatch 条通过一次 io_uring_enter 提交并等待完成。
+   */
+  auto FindBatch(const Key* keys, const size_t* hashes, size_t count,
+                 Value* values, uint64_t* offsets, bool* found) -> size_t;
+  // 索引中 key 的指纹是否仍指向 offset，期间被 Remove、重新 Admit
+  // 或随 region 回收都返回 false
+  auto Indexed(const Key& key, uint64_t offset) -> bool {
+    return Indexed(key, Hash()(key), offset);
+  }
+  auto Indexed(const Key& key, size_t hash, uint64_t offset) -> bool;
+  // 只删除索引项，日志里的旧记录随 region 回收
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
+  auto Clear() -> void;
+  // 索引中的条目数，包含已经作废但还没有被清理的
+  auto Size() -> size_t;
+  auto Dropped() const -> size_t { return dropped_.load(); }
+
+ private:
+  static constexpr size_t kRegionSize = 256 * 1024;
+  static constexpr size_t kMinRegions = 8;
+  // 等待写盘的 region 上限，超过后新条目直接丢弃
+  static constexpr size_t kMaxPending = 4;
+  static constexpr size_t kIndexStripes = 64;
+  // FindBatch 每次提交的读请求上限，也是读 ring 的大小
+  static constexpr size_t kReadBatch = 64;
+
+  struct Record {
+    Key key_;
+    Value value_;
+  };
+  static constexpr size_t kRecordsPerRegion = kRegionSize / sizeof(Record);
+
+  struct Region {
+    uint64_t id_ = 0;
+    std::vector<Record> records_;
+  };
+
+  struct alignas(64) IndexStripe {
+    std::mutex latch_;
+    // 指纹 -> 日志偏移，偏移 = region 编号 * kRecordsPerRegion + 槽位
+    std::unordered_map<size_t, uint64_t> map_;
+  };
+
+#ifdef USE_IO_URING
+  struct IoRing;
+  // ring_ 只由后台写线程使用；read_ring_ 由 FindBatch 的调用线程在
+  // read_latch_ 下轮流使用
+  std::unique_ptr<IoRing> ring_;
+  std::unique_ptr<IoRing> read_ring_;
+  std::mutex read_latch_;
+#endif
+
+  int fd_ = -1;
+  size_t num_regions_ = 0;
+
+  // 保护活跃 region、待写队列和空闲 buffer
+  std::mutex latch_;
+  std::unique_ptr<Region> active_;
+  std::deque<std::unique_ptr<Region>> pending_;
+  std::vector<std::unique_ptr<Region>> free_;
+  // 每个物理 region 中记录的指纹，回收 region 时据此清理索引
+  std::vector<std::vector<size_t>> region_fingerprints_;
+  // 活跃 region 的编号，以及编号小于它的 region 都已经写盘
+  std::atomic<uint64_t> active_region_{0};
+  std::atomic<uint64_t> flushed_region_{0};
+  std::atomic<size_t> dropped_{0};
+
+  IndexStripe index_[kIndexStripes];
+
+  std::thread flusher_;
+  std::condition_variable flusher_cv_;
+  bool flusher_stop_ = false;
+
+  auto stripe(size_t fingerprint) -> IndexStripe& {
+    return index_[(fingerprint >> 8) & (kIndexStripes - 1)];
+  }
+  // region 被覆盖之前其中的条目都可以读
+  auto readable(uint64_t region) const -> bool {
+    return region + num_regions_ > active_region_.load();
+  }
+  auto seal_active() -> bool;
+  auto reclaim(uint64_t region) -> void;
+  auto flush_loop() -> void;
+  auto write_regions(const std::vector<Region*>& regions) -> bool;
+  // 查索引，指纹存在时写入日志偏移
+  auto lookup(size_t fingerprint, uint64_t& offset) -> bool;
+  // 记录所在的 region 还没写盘时从内存 buffer 复制
+  auto copy_buffered(uint64_t offset, Record& record) -> bool;
+  auto read_record(uint64_t offset, Record& record) -> bool;
+  // 读取 count 条记录，ok[i] 表示 records[i] 有效
+  auto read_records(const uint64_t* offsets, Record* records, bool* ok,
+                    size_t count) -> void;
+};
+
+}  // namespace myLru
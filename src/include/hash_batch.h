@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "config.h"
+
+namespace myLru {
+
+enum class HashKernel : uint8_t {
+  kScalar,
+  kAvx2,    // 4 路，64 位乘法用 3 次 32 位乘法拼出
+  kAvx512,  // 8 路，需要 AVX-512DQ 的 64 位乘法
+};
+
+/**
+ * @brief 批量计算 HashFuncImpl，结果与逐个调用逐位相同。
+ * 第一次调用时按 CPU 选出最宽的可用实现，之后不再检测。
+ */
+auto HashBatch(const int64_t* keys, size_t count, size_t* hashes) -> void;
+
+// 用指定的实现计算，CPU 不支持时退回标量实现。测试和基准用
+auto HashBatch(HashKernel kernel, const int64_t* keys, size_t count,
+               size_t* hashes) -> void;
+
+auto HashBatchKernel() -> HashKernel;
+auto HashKernelSupported(HashKernel kernel) -> bool;
+auto HashKernelName(HashKernel kernel) -> const char*;
+
+// 模板代码里的批量 hash：HashFuncImpl 配 int64_t 时走向量实现，否则逐个计算
+template <typename Key, typename Hash>
+inline auto HashKeys(const Key* keys, size_t count, size_t* hashes) -> void {
+  if constexpr (std::is_same_v<Hash, HashFuncImpl> &&
+                std::is_same_v<Key, int64_t>) {
+    HashBatch(keys, count, hashes);
+  } else {
+    Hash hash;
+    for (size_t i = 0; i < count; ++i) {
+      hashes[i] = hash(keys[i]);
+    }
+  }
+}
+
+}  // namespace myLru
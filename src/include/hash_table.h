@@ -1,402 +1,616 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "config.h"
+#include "epoch.h"
+#include "hash_batch.h"
+#include "hash_table_resizer.h"
+#include "shard_stats.h"
 
 namespace myLru {
 
-template <typename K, typename V, typename HF = HashFuncImpl,
-          typename KEF = std::equal_to<K>>
-class HashTableResizer;
-
+/**
+ * @brief 链式哈希表，负载因子超过 max_load_factor_ 时桶数翻倍，低于
+ * min_load_factor_ 时收缩，但不会小于 Reserve/SetSize 指定的桶数。
+ * 收缩后的负载因子低于 2 * min，扩容后高于 max / 2，要求 min <= max / 4，
+ * 两个阈值之间留有余量，删几个插几个不会来回扩缩。
+ *
+ * 桶是原子指针串起来的单链表，Get 不加锁：进入 epoch 之后从 current_list_
+ * 读桶数组，沿链表查找。写操作持有 latch_，摘下来的节点和换下来的桶数组
+ * 放进 retired_，等所有可能看到它们的读者离开之后才释放（见 epoch.h）。
+ *
+ * 设置了 resizer 时扩缩容是增量的：按新旧数组中较小的那个（base）把桶
+ * 切成 kChunkBuckets 个一段的区间，HashTableResizer 的线程并行认领区间，把
+ * 其中的元素复制到新表后再从旧表摘掉；访问迁移中表的 Insert/Remove 也顺带
+ * 迁移一个区间。桶数都是 2 的幂，hash & (base - 1) 相同的旧桶和新桶属于
+ * 同一个区间，所以不同区间的迁移互不干扰。迁移期间
+ * 写操作持有表锁之外还要持有所在区间的 chunk_latch_；迁移线程只持有
+ * 区间锁。旧数组的 next_ 指向新数组，元素先复制到新数组再从旧数组摘下，
+ * Get 依次查找两张表，不会漏掉迁移中的元素。
+ *
+ * 分片改容量时调用 Reserve，一次迁移到目标桶数，而不是连续翻倍多次，
+ * 也不会在分片 latch_ 下做完整的 rehash。Clear 和 SetSize 要换掉桶数组，
+ * 先完成正在进行的迁移，并等迁移线程手里的区间搬完。
+ */
 template <typename Key, typename Value, typename HashFunc = HashFuncImpl,
           typename KeyEqualFunc = std::equal_to<Key>>
-class MyHashTable {
+class MyHashTable : public ResizeJob {
 public:
-  using HashTableResizerType =
-      HashTableResizer<Key, Value, HashFunc, KeyEqualFunc>;
+  using HashTableResizerType = HashTableResizer;
 
   explicit MyHashTable(size_t initial_buckets = 16) : elems_(0) {
-    if (initial_buckets == 0) {
-      initial_buckets = 1;
-    }
+    min_length_ = round_up(initial_buckets);
+    current_list_.store(new BucketArray(min_length_),
+                        std::memory_order_relaxed);
+    update_thresholds();
+  }
 
-    length_ = 1;
-    while (length_ < initial_buckets) {
-      length_ <<= 1;
-    }
-    list_.resize(length_);
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    current_list_.store(&list_);
-#endif
-#endif
+  ~MyHashTable() override {
+    cancel_resize();
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    delete list->next_.load(std::memory_order_relaxed);
+    delete list;
   }
 
   auto Get(const Key &key, Value &value_out) -> bool {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::shared_lock<std::shared_mutex> lock(read_latch_);
-    Value *found_value_ptr = FindValuePtr(key);
-#else
-    std::lock_guard<std::mutex> lock(latch_);
-    Value *found_value_ptr = FindValuePtr(key);
-#endif
-#else
-    std::lock_guard<std::mutex> lock(latch_);
-    Value *found_value_ptr = FindValuePtr(key);
-#endif
-    if (found_value_ptr != nullptr) {
-      value_out = *found_value_ptr;
+    return Get(key, hash_function_(key), value_out);
+  }
+
+  // 以下带 hash 的版本由调用方传入已经算好的 hash_function_(key)，
+  // 低位选桶，不再重新计算
+  auto Get(const Key &key, size_t hash, Value &value_out) -> bool {
+    EpochDomain::Guard guard(epoch_);
+    Node *node = find_node(key, hash);
+    if (node != nullptr) {
+      value_out = node->value_;
       return true;
     }
     return false;
   }
 
   auto Insert(const Key &key, Value value_to_insert) -> bool {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::unique_lock<std::shared_mutex> lock(read_latch_);
-    size_t bucket_idx = GetBucketIndex(key);
-    auto current_list = current_list_.load();
-    std::vector<std::pair<Key, Value>> &chain = (*current_list)[bucket_idx];
-#else
-    std::unique_lock<std::mutex> lock(latch_);
-    size_t bucket_idx = GetBucketIndex(key);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
-#endif
-#else
-    std::unique_lock<std::mutex> lock(latch_);
-    size_t bucket_idx = GetBucketIndex(key);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
-#endif
-    for (auto &pair_entry : chain) {
-      if (key_equal_(pair_entry.first, key)) {
-        // pair_entry.second = value_to_insert;
-        // return true;
+    return Insert(key, hash_function_(key), value_to_insert);
+  }
+
+  auto Insert(const Key &key, size_t hash, Value value_to_insert) -> bool {
+    std::lock_guard<std::mutex> lock(latch_);
+    help_migrate();
+    {
+      std::unique_lock<std::mutex> chunk_lock = lock_chunk(hash);
+      if (find_node(key, hash) != nullptr) {
         // Not allow to update the value
         return false;
       }
+      // 迁移期间新元素直接放进新表
+      BucketArray *list = current_list_.load(std::memory_order_relaxed);
+      BucketArray *next = list->next_.load(std::memory_order_relaxed);
+      std::atomic<Node *> &head = (next != nullptr ? next : list)->bucket(hash);
+      head.store(new Node(key, value_to_insert, hash,
+                          head.load(std::memory_order_relaxed)),
+                 std::memory_order_release);
     }
-    if (resizing_.load()) {
-      // If resizing, check in the temp list
-      size_t temp_bucket_idx = GetBucketIndexInternal(key, temp_list_size);
-      std::vector<std::pair<Key, Value>> &temp_chain =
-          temp_list_[temp_bucket_idx];
-      for (auto &pair_entry : temp_chain) {
-        if (key_equal_(pair_entry.first, key)) {
-          return false;
-        }
-      }
-      // If not found, insert into the temp list.
-      temp_chain.emplace_back(key, value_to_insert);
-      elems_++;
-      return true;
-    } else {
-      chain.emplace_back(key, value_to_insert);
-      elems_++;
-    }
-    // lock.unlock();
+    elems_++;
     // When the number of elements is more than 2 times the length,
     // we need to resize the hash table.
-    if (elems_ > 2 * length_) {
-#ifdef USE_HASH_RESIZER
-      // Check if resizing is already in progress!!
-      if (resizer_ != nullptr && resizing_.load() == false) {
-        resizing_.store(true);
-        if (temp_list_.empty()) {
-          initialize_temp_list();
-        }
-        resizer_->EnqueueResize(this);
-      } else {
-        lock.unlock();
-        Resize();
-      }
-#else
-      // lock.unlock();
-      Resize();
-#endif
+    if (elems_ > grow_at_ && !migrating()) {
+      start_resize(current_list_.load(std::memory_order_relaxed)->length_
+                   << 1);
     }
     return true;
   }
 
   auto Remove(const Key &key) -> bool {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::unique_lock<std::shared_mutex> lock(read_latch_);
-    auto current_list = current_list_.load();
-    size_t bucket_idx = GetBucketIndex(key);
-    std::vector<std::pair<Key, Value>> &chain = (*current_list)[bucket_idx];
-#else
+    return Remove(key, hash_function_(key));
+  }
+
+  auto Remove(const Key &key, size_t hash) -> bool {
     std::lock_guard<std::mutex> lock(latch_);
-    size_t bucket_idx = GetBucketIndex(key);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
-#endif
-#else
+    help_migrate();
+    bool removed = remove_locked(key, hash);
+    maybe_shrink();
+    return removed;
+  }
+
+  // 一次加锁删除一批 key，返回实际删除的个数。hash 在加锁前批量算好
+  auto RemoveBatch(const std::vector<Key> &keys) -> size_t {
+    static thread_local std::vector<size_t> hashes;
+    hashes.resize(keys.size());
+    HashKeys<Key, HashFunc>(keys.data(), keys.size(), hashes.data());
+    return RemoveBatch(keys, hashes);
+  }
+
+  // hashes[i] 为调用方已经算好的 hash_function_(keys[i])
+  auto RemoveBatch(const std::vector<Key> &keys,
+                   const std::vector<size_t> &hashes) -> size_t {
     std::lock_guard<std::mutex> lock(latch_);
-    size_t bucket_idx = GetBucketIndex(key);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
-#endif
-    if (resizing_.load()) {
-      // std::lock_guard<std::mutex> lock(latch_);
-      size_t temp_bucket_idx = GetBucketIndexInternal(key, temp_list_size);
-      std::vector<std::pair<Key, Value>> &temp_chain =
-          temp_list_[temp_bucket_idx];
-      for (auto &entry : temp_chain) {
-        if (key_equal_(entry.first, key)) {
-          temp_chain.erase(
-              std::remove(temp_chain.begin(), temp_chain.end(), entry),
-              temp_chain.end());
-          elems_--;
-          return true;
-        }
-      }
-    }
-    for (auto &entry : chain) {
-      if (key_equal_(entry.first, key)) {
-        chain.erase(std::remove(chain.begin(), chain.end(), entry),
-                    chain.end());
-        elems_--;
-        return true;
+    help_migrate();
+    size_t removed = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (remove_locked(keys[i], hashes[i])) {
+        removed++;
       }
     }
-    return false;
+    maybe_shrink();
+    return removed;
   }
 
+  // 立即把桶数翻倍；已经在迁移时由当前线程迁移所有未认领的区间
   auto Resize() -> void {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::shared_lock<std::shared_mutex> lock(read_latch_);
-    size_t new_length_ = length_ << 1;
-    std::vector<std::vector<std::pair<Key, Value>>> new_list(new_length_);
-    old_list_ptr_.store(&list_);
-    for (auto &chain : list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
-      }
+    std::lock_guard<std::mutex> lock(latch_);
+    if (!migrating()) {
+      begin_resize(current_list_.load(std::memory_order_relaxed)->length_
+                   << 1);
     }
+    drain_resize();
+  }
 
-    // Insert the elements from the temp list to new list
-    if (temp_list_.empty() || resizer_ == nullptr) {
-      length_ = new_length_;
-      list_ = std::move(new_list);
-      current_list_.store(&list_);
-      resizing_.store(false);
-      return;
-    }
-    for (auto &chain : temp_list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
-      }
-    }
-    // Clear the temp list after the resizing set to false
-    temp_list_.clear();
-    length_ = new_length_;
-    list_ = std::move(new_list);
-    current_list_.store(&list_);
-    resizing_.store(false);
-#else
+  // 按新的桶数立即重建，已有元素复制到新数组；这也是之后收缩的下限
+  auto SetSize(size_t size) -> void {
+    cancel_resize();
     std::lock_guard<std::mutex> lock(latch_);
-    size_t new_length_ = length_ << 1;
-    std::vector<std::vector<std::pair<Key, Value>>> new_list(new_length_);
-    for (auto &chain : list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
+    // 这里直接重建，不需要再按之前的 Reserve 调整
+    reserve_pending_ = false;
+    drain_resize();
+    min_length_ = round_up(size);
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    if (min_length_ != list->length_) {
+      BucketArray *fresh = new BucketArray(min_length_);
+      for (size_t i = 0; i < list->length_; ++i) {
+        copy_chain(list->buckets_[i].load(std::memory_order_relaxed), fresh);
       }
+      current_list_.store(fresh, std::memory_order_release);
+      retire(list, &delete_array);
     }
+    update_thresholds();
+  }
 
-    // Insert the elements from the temp list to new list
-    if (temp_list_.empty() || resizer_ == nullptr) {
-      length_ = new_length_;
-      list_ = std::move(new_list);
-      resizing_.store(false);
+  /**
+   * @brief 按预计的元素数一次调整到合适的桶数（负载因子为 max / 2），
+   * 之后不会低于这个桶数。有 resizer 时迁移在后台进行，否则当场完成。
+   * 不等待正在进行的迁移：它结束时再按这里的设置调整一次。
+   */
+  auto Reserve(size_t expected) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    min_length_ = round_up(static_cast<size_t>(
+        std::ceil(static_cast<double>(expected) * 2 / max_load_factor_)));
+    if (migrating()) {
+      reserve_pending_ = true;
       return;
     }
-    for (auto &chain : temp_list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
-      }
-    }
-    // Clear the temp list after the resizing set to false
-    temp_list_.clear();
-    length_ = new_length_;
-    list_ = std::move(new_list);
-    resizing_.store(false);
-#endif
-#else
-    size_t new_length_ = length_ << 1;
-    std::vector<std::vector<std::pair<Key, Value>>> new_list(new_length_);
-    for (auto &chain : list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
-      }
-    }
+    apply_reserve();
+  }
 
-    // Insert the elements from the temp list to new list
-    if (temp_list_.empty() || resizer_ == nullptr) {
-      length_ = new_length_;
-      list_ = std::move(new_list);
-      resizing_.store(false);
-      return;
+  // min_load_factor 为 0 时不收缩；要求 min <= max / 4
+  auto SetLoadFactors(double min_load_factor, double max_load_factor)
+      -> bool {
+    if (max_load_factor <= 0 || min_load_factor < 0 ||
+        min_load_factor * 4 > max_load_factor) {
+      return false;
     }
-    for (auto &chain : temp_list_) {
-      for (auto &entry : chain) {
-        size_t new_bucket_idx =
-            GetBucketIndexInternal(entry.first, new_length_);
-        new_list[new_bucket_idx].emplace_back(entry.first, entry.second);
-      }
-    }
-    // Clear the temp list after the resizing set to false
-    temp_list_.clear();
-    length_ = new_length_;
-    list_ = std::move(new_list);
-    resizing_.store(false);
-#endif
+    std::lock_guard<std::mutex> lock(latch_);
+    min_load_factor_ = min_load_factor;
+    max_load_factor_ = max_load_factor;
+    update_thresholds();
+    return true;
   }
 
-  auto SetSize(size_t size) -> void {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::unique_lock<std::shared_mutex> lock(read_latch_);
-#else
+  auto BucketCount() -> size_t {
     std::lock_guard<std::mutex> lock(latch_);
-#endif
-#else 
+    return current_list_.load(std::memory_order_relaxed)->length_;
+  }
+
+  // 已经开始过的扩缩容次数
+  auto ResizeCount() -> size_t {
     std::lock_guard<std::mutex> lock(latch_);
-#endif
-    if (size == 0) {
-      size = 1;
-    }
-    length_ = 1;
-    while (length_ < size) {
-      length_ <<= 1;
-    }
-    list_.resize(length_);
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    current_list_.store(&list_);
-#endif
-#endif
+    return resize_count_;
   }
 
   auto Size() const -> size_t { return elems_; }
 
+  // 不加写锁遍历当前桶数组；迁移期间只统计旧数组，结果是近似值
+  auto GetChainStats() -> ChainStats {
+    EpochDomain::Guard guard(epoch_);
+    ChainStats stats;
+    BucketArray *list = current_list_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < list->length_; ++i) {
+      size_t length = 0;
+      for (Node *node = list->buckets_[i].load(std::memory_order_acquire);
+           node != nullptr; node = node->next_.load(std::memory_order_acquire)) {
+        length++;
+      }
+      stats.Record(length);
+    }
+    return stats;
+  }
+
   auto Clear() -> void {
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    std::unique_lock<std::shared_mutex> lock(read_latch_);
-#else
-    std::lock_guard<std::mutex> lock(latch_);
-#endif
-#else 
+    cancel_resize();
     std::lock_guard<std::mutex> lock(latch_);
-#endif
-    for (auto &chain : list_) {
-      chain.clear();
-    }
+    reserve_pending_ = false;
+    drain_resize();
+    // 清空后回到 Reserve/SetSize 指定的桶数
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    current_list_.store(new BucketArray(min_length_),
+                        std::memory_order_release);
+    retire(list, &delete_array);
     elems_ = 0;
-    list_.assign(length_, std::vector<std::pair<Key, Value>>());
-#ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    current_list_.store(&list_);
-#endif
-#endif
+    update_thresholds();
   }
 
   auto SetResizer(HashTableResizerType *resizer) -> void { resizer_ = resizer; }
 
+  auto MigrateChunk() -> bool override {
+    bool last = false;
+    if (!migrate_next(last)) {
+      return false;
+    }
+    if (last) {
+      std::lock_guard<std::mutex> lock(latch_);
+      // 拿到写锁之前 drain_resize 可能已经替这一轮切换了数组
+      if (all_migrated()) {
+        finish_resize();
+      }
+    }
+    return true;
+  }
+
+  auto Exhausted() const -> bool override {
+    uint64_t claim = claim_.load(std::memory_order_acquire);
+    return (claim & kClaimMask) >= (claim >> 32);
+  }
+
+  // 还没释放的节点和桶数组个数，测试用
+  auto Retired() -> size_t {
+    std::lock_guard<std::mutex> lock(retire_latch_);
+    return retired_.Size();
+  }
+
 private:
-  // The actual hash table
-  std::vector<std::vector<std::pair<Key, Value>>> list_;
+  // 发布之后只有 next_ 会被修改。hash_ 缓存 hash_function_(key_)：迁移时
+  // 直接用它选新桶，查找时先比较 hash_ 再比较 key
+  struct Node {
+    Node(const Key &key, const Value &value, size_t hash, Node *next)
+        : key_(key), value_(value), hash_(hash), next_(next) {}
+    Key key_;
+    Value value_;
+    size_t hash_;
+    std::atomic<Node *> next_;
+  };
 
-  std::atomic<std::vector<std::vector<std::pair<Key, Value>>> *> current_list_;
+  struct BucketArray {
+    explicit BucketArray(size_t length)
+        : length_(length), buckets_(new std::atomic<Node *>[length]) {
+      for (size_t i = 0; i < length_; ++i) {
+        buckets_[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    // 只释放仍挂在桶上的节点，迁移完的旧数组上已经没有节点
+    ~BucketArray() {
+      for (size_t i = 0; i < length_; ++i) {
+        delete_chain(buckets_[i].load(std::memory_order_relaxed));
+      }
+    }
+    auto bucket(size_t hash) -> std::atomic<Node *> & {
+      return buckets_[hash & (length_ - 1)];
+    }
 
-  std::atomic<std::vector<std::vector<std::pair<Key, Value>>> *> old_list_ptr_;
-  // Mutex for list_
-  // std::mutex read_latch_;
-  std::shared_mutex read_latch_;
-  // The number of buckets in the hash table
-  size_t length_;
+    size_t length_;
+    std::unique_ptr<std::atomic<Node *>[]> buckets_;
+    // 迁移的目标数组，迁移开始后不再改变
+    std::atomic<BucketArray *> next_{nullptr};
+  };
+
+  // 每个迁移区间包含的旧桶数
+  static constexpr size_t kChunkBuckets = 256;
+  // 区间锁按区间号取模共享
+  static constexpr size_t kChunkLatches = 64;
+  static constexpr uint64_t kClaimMask = 0xffffffffULL;
+  // 每隔这么多次写操作尝试回收一次
+  static constexpr size_t kReclaimInterval = 1024;
+  static constexpr double kDefaultMinLoadFactor = 0.25;
+  static constexpr double kDefaultMaxLoadFactor = 2.0;
+
+  // The actual hash table; 迁移期间是旧数组
+  std::atomic<BucketArray *> current_list_;
+  // Mutex for writers
+  std::mutex latch_;
+  std::mutex chunk_latch_[kChunkLatches];
   // The number of elements in the hash table
   size_t elems_;
-  // Temporary list for resizing
-  std::vector<std::vector<std::pair<Key, Value>>> temp_list_;
-  // Mutex for temp_list_
-  std::mutex latch_;
+  size_t writes_ = 0;
+  double min_load_factor_ = kDefaultMinLoadFactor;
+  double max_load_factor_ = kDefaultMaxLoadFactor;
+  // 由负载因子和当前桶数算出的阈值，元素数越过时开始扩缩容
+  size_t grow_at_ = 0;
+  size_t shrink_at_ = 0;
+  // 收缩不低于这个桶数
+  size_t min_length_;
+  // 迁移期间调用过 Reserve，迁移结束后按 min_length_ 再调整
+  bool reserve_pending_ = false;
+  size_t resize_count_ = 0;
   // Hash function
   HashFunc hash_function_;
   // Key equality function
   KeyEqualFunc key_equal_;
   // Pointer to the resizer
   HashTableResizerType *resizer_ = nullptr;
-  // Flag to indicate if resizing is in progress
-  std::atomic<bool> resizing_ = false;
-  // The size of the temporary list
-  static const size_t temp_list_size = 8;
+  // 高 32 位是本轮的区间数，低 32 位是下一个待认领的区间。放在同一个原子量里，
+  // 认领时读到的区间数和下标一定属于同一轮迁移
+  std::atomic<uint64_t> claim_{0};
+  std::atomic<size_t> done_chunks_{0};
+  EpochDomain &epoch_ = EpochDomain::Instance();
+  // 迁移线程和写者都会往里放，用 retire_latch_ 保护
+  std::mutex retire_latch_;
+  RetireList retired_;
+
+  static auto round_up(size_t size) -> size_t {
+    size_t length = 1;
+    while (length < size) {
+      length <<= 1;
+    }
+    return length;
+  }
+
+  static auto delete_chain(Node *node) -> void {
+    while (node != nullptr) {
+      Node *next = node->next_.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+
+  static auto delete_node(void *node) -> void {
+    delete static_cast<Node *>(node);
+  }
+
+  static auto delete_chain_ptr(void *node) -> void {
+    delete_chain(static_cast<Node *>(node));
+  }
+
+  static auto delete_array(void *list) -> void {
+    delete static_cast<BucketArray *>(list);
+  }
+
+  // 读者和写者共用。迁移中旧数组的元素总是先复制到新数组再摘掉，
+  // 所以依次查旧数组和新数组不会漏掉
+  auto find_node(const Key &key, size_t hash) -> Node * {
+    for (BucketArray *list = current_list_.load(std::memory_order_acquire);
+         list != nullptr; list = list->next_.load(std::memory_order_acquire)) {
+      for (Node *node = list->bucket(hash).load(std::memory_order_acquire);
+           node != nullptr; node = node->next_.load(std::memory_order_acquire)) {
+        if (node->hash_ == hash && key_equal_(node->key_, key)) {
+          return node;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // 不调用 hash_function_，新桶由缓存的 hash_ 决定
+  auto copy_chain(Node *node, BucketArray *to) -> void {
+    for (; node != nullptr; node = node->next_.load(std::memory_order_relaxed)) {
+      std::atomic<Node *> &head = to->bucket(node->hash_);
+      head.store(new Node(node->key_, node->value_, node->hash_,
+                          head.load(std::memory_order_relaxed)),
+                 std::memory_order_release);
+    }
+  }
+
+  // 调用方持有写锁
+  auto migrating() -> bool {
+    return current_list_.load(std::memory_order_relaxed)
+               ->next_.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  auto retire(void *ptr, RetireList::Deleter deleter) -> void {
+    std::lock_guard<std::mutex> lock(retire_latch_);
+    retired_.Retire(ptr, deleter);
+  }
+
+  // 写操作偶尔回收一次，保证没有新的删除时旧对象也能被释放
+  auto maybe_reclaim() -> void {
+    if (++writes_ % kReclaimInterval != 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(retire_latch_);
+    if (retired_.Size() > 0) {
+      retired_.Reclaim();
+    }
+  }
 
-  auto GetBucketIndex(const Key &key) const -> size_t {
-    if (length_ == 0) {
-      throw std::runtime_error("Hash table is not initialized.");
+  // 迁移期间锁住 hash 所在的区间，否则返回不持有锁的 unique_lock
+  auto lock_chunk(size_t hash) -> std::unique_lock<std::mutex> {
+    if (!migrating()) {
+      return {};
     }
-    return hash_function_(key) & (length_ - 1);
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    size_t base = std::min(list->length_,
+                           list->next_.load(std::memory_order_relaxed)->length_);
+    size_t chunk = (hash & (base - 1)) / kChunkBuckets;
+    return std::unique_lock<std::mutex>(chunk_latch_[chunk % kChunkLatches]);
+  }
+
+  // 调用方持有写锁
+  auto update_thresholds() -> void {
+    size_t length = current_list_.load(std::memory_order_relaxed)->length_;
+    grow_at_ = static_cast<size_t>(length * max_load_factor_);
+    shrink_at_ = static_cast<size_t>(length * min_load_factor_);
   }
 
-  auto GetBucketIndexInternal(const Key &key, size_t current_length) const
-      -> size_t {
-    return hash_function_(key) & (current_length - 1);
+  // 调用方持有写锁。收缩到负载因子回到 [min, 2 * min) 的桶数
+  auto maybe_shrink() -> void {
+    size_t length = current_list_.load(std::memory_order_relaxed)->length_;
+    if (elems_ >= shrink_at_ || length <= min_length_ || migrating()) {
+      return;
+    }
+    size_t target = length;
+    while (target / 2 >= min_length_ &&
+           static_cast<double>(elems_) < target * min_load_factor_) {
+      target /= 2;
+    }
+    if (target != length) {
+      start_resize(target);
+    }
   }
 
-  auto FindValuePtr(const Key &key) -> Value * {
+  // 调用方持有写锁且当前没有迁移。有 resizer 时交给它，否则当场迁移完
+  auto start_resize(size_t length) -> void {
+    begin_resize(length);
 #ifdef USE_HASH_RESIZER
-#ifdef USE_SHARED_LATCH
-    auto *current_list = current_list_.load();
-    size_t bucket_idx = GetBucketIndexInternal(key, length_);
-    std::vector<std::pair<Key, Value>> &chain = (*current_list)[bucket_idx];
-#else
-    size_t bucket_idx = GetBucketIndexInternal(key, length_);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
-#endif
-#else
-    size_t bucket_idx = GetBucketIndexInternal(key, length_);
-    std::vector<std::pair<Key, Value>> &chain = list_[bucket_idx];
+    if (resizer_ != nullptr) {
+      resizer_->Submit(this);
+      return;
+    }
 #endif
-    for (auto &pair_entry : chain) {
-      if (key_equal_(pair_entry.first, key)) {
-        return &(pair_entry.second);
+    drain_resize();
+  }
+
+  // 调用方持有写锁且当前没有迁移。按 min_length_ 和已有元素数调整桶数
+  auto apply_reserve() -> void {
+    // 已有的元素比预计的多时，桶数还要能装下它们
+    size_t target = min_length_;
+    while (static_cast<double>(elems_) > target * max_load_factor_) {
+      target <<= 1;
+    }
+    if (target != current_list_.load(std::memory_order_relaxed)->length_) {
+      start_resize(target);
+    } else {
+      update_thresholds();
+    }
+  }
+
+  // 调用方已持有写锁
+  auto remove_locked(const Key &key, size_t hash) -> bool {
+    std::unique_lock<std::mutex> chunk_lock = lock_chunk(hash);
+    for (BucketArray *list = current_list_.load(std::memory_order_relaxed);
+         list != nullptr; list = list->next_.load(std::memory_order_relaxed)) {
+      std::atomic<Node *> *link = &list->bucket(hash);
+      for (Node *node = link->load(std::memory_order_relaxed); node != nullptr;
+           node = link->load(std::memory_order_relaxed)) {
+        if (node->hash_ == hash && key_equal_(node->key_, key)) {
+          // 正停在这个节点上的读者仍能沿 next_ 走完链表
+          link->store(node->next_.load(std::memory_order_relaxed),
+                      std::memory_order_release);
+          retire(node, &delete_node);
+          elems_--;
+          return true;
+        }
+        link = &node->next_;
       }
     }
-    if (resizing_) {
-      size_t temp_bucket_idx = GetBucketIndexInternal(key, temp_list_size);
-      std::vector<std::pair<Key, Value>> &temp_chain =
-          temp_list_[temp_bucket_idx];
-      for (auto &pair_entry : temp_chain) {
-        if (key_equal_(pair_entry.first, key)) {
-          return &(pair_entry.second);
+    return false;
+  }
+
+  // 调用方持有写锁且当前没有迁移
+  auto begin_resize(size_t length) -> void {
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    size_t base = std::min(list->length_, length);
+    size_t chunks = (base + kChunkBuckets - 1) / kChunkBuckets;
+    done_chunks_.store(0, std::memory_order_relaxed);
+    resize_count_++;
+    list->next_.store(new BucketArray(length), std::memory_order_release);
+    // release 发布上面的状态，认领到区间的线程由此看到新数组
+    claim_.store(static_cast<uint64_t>(chunks) << 32,
+                 std::memory_order_release);
+  }
+
+  // 认领并迁移一个区间，没有可认领的区间时返回 false。
+  // last 为 true 表示刚迁移完最后一个区间，调用方需要在写锁下 finish_resize
+  auto migrate_next(bool &last) -> bool {
+    uint64_t claim = claim_.fetch_add(1, std::memory_order_acq_rel);
+    size_t chunk = claim & kClaimMask;
+    size_t chunks = claim >> 32;
+    if (chunk >= chunks) {
+      return false;
+    }
+    BucketArray *list = current_list_.load(std::memory_order_acquire);
+    BucketArray *next = list->next_.load(std::memory_order_acquire);
+    size_t base = std::min(list->length_, next->length_);
+    {
+      std::lock_guard<std::mutex> chunk_lock(
+          chunk_latch_[chunk % kChunkLatches]);
+      size_t begin = chunk * kChunkBuckets;
+      size_t end = std::min(base, begin + kChunkBuckets);
+      // 收缩时 i, i + base, i + 2 * base ... 这些旧桶都落到新桶 i
+      for (size_t offset = 0; offset < list->length_; offset += base) {
+        for (size_t i = begin + offset; i < end + offset; ++i) {
+          Node *head = list->buckets_[i].load(std::memory_order_relaxed);
+          if (head == nullptr) {
+            continue;
+          }
+          // 先发布副本再摘掉旧链，读者总能在其中一张表上找到
+          copy_chain(head, next);
+          list->buckets_[i].store(nullptr, std::memory_order_release);
+          retire(head, &delete_chain_ptr);
         }
       }
     }
-    return nullptr;
+    last = done_chunks_.fetch_add(1, std::memory_order_acq_rel) + 1 == chunks;
+    return true;
+  }
+
+  // 调用方持有写锁。本轮迁移的所有区间都已经迁移完（不只是被认领）
+  auto all_migrated() -> bool {
+    return migrating() && done_chunks_.load(std::memory_order_acquire) ==
+                              (claim_.load(std::memory_order_acquire) >> 32);
+  }
+
+  // 调用方持有写锁，所有区间都已迁移完
+  auto finish_resize() -> void {
+    BucketArray *list = current_list_.load(std::memory_order_relaxed);
+    current_list_.store(list->next_.load(std::memory_order_relaxed),
+                        std::memory_order_release);
+    // 旧数组的 next_ 保持不变，还停在旧数组上的读者会继续查新数组
+    retire(list, &delete_array);
+    update_thresholds();
+    if (reserve_pending_) {
+      reserve_pending_ = false;
+      apply_reserve();
+    }
+  }
+
+  // 前台写操作顺带迁移一个区间，调用方持有写锁
+  auto help_migrate() -> void {
+    bool last = false;
+    if (migrating() && migrate_next(last) && last) {
+      finish_resize();
+    }
+    maybe_reclaim();
   }
 
-  inline auto initialize_temp_list() -> void {
-    temp_list_.resize(temp_list_size);
+  // 调用方持有写锁。迁移所有还没人认领的区间，再等其他线程迁移完手上的
+  // 区间，返回时没有迁移在进行。迁移区间不需要写锁，持锁等待不会死锁；
+  // 那些线程之后拿到写锁时由 all_migrated 得知这一轮已经结束
+  auto drain_resize() -> void {
+    bool last = false;
+    while (migrating()) {
+      while (migrate_next(last)) {
+      }
+      while (!all_migrated()) {
+        std::this_thread::yield();
+      }
+      // 切换数组时可能按 reserve_pending_ 开始下一轮
+      finish_resize();
+    }
+  }
+
+  // 让 resizer 不再调度这张表，调用时不能持有表锁：
+  // 迁移完最后一个区间的线程需要拿写锁
+  auto cancel_resize() -> void {
+    if (resizer_ != nullptr) {
+      resizer_->Cancel(this);
+    }
   }
 };
 } // namespace myLru
@@ -1,47 +1,46 @@
 #pragma once
 
-#include <atomic>
+#include <algorithm>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdio>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
-#include "hash_table.h"
-
 namespace myLru {
 
-#define DEFAULT_NUM_THREADS 8
+#define DEFAULT_NUM_THREADS 4
 
-template <typename Key, typename Value, typename HashFunc,
-          typename KeyEqualFunc>
-class HashTableResizer {
+/**
+ * @brief 一次可以拆成若干区间的迁移任务，由 MyHashTable 实现。
+ *
+ * MigrateChunk 认领并迁移一个还没人认领的区间，多个线程可以同时调用；
+ * 已经没有可认领的区间时返回 false（别的线程可能还在迁移最后几个区间）。
+ */
+class ResizeJob {
  public:
-  using HashTableType = MyHashTable<Key, Value, HashFunc, KeyEqualFunc>;
-
-  HashTableResizer() : stop_requested_(false) {
-#ifdef USE_HASH_RESIZER
-    printf("HashTableResizer is enabled with %d threads.\n",
-           DEFAULT_NUM_THREADS);
-#endif
-#ifdef USE_SHARED_LATCH
-    printf("Using shared mutex for read operations.\n");
-#endif
-    for (int i = 0; i < DEFAULT_NUM_THREADS; ++i) {
-      threads_.emplace_back(&HashTableResizer::ResizeThread, this);
-    }
-  }
+  virtual ~ResizeJob() = default;
+  virtual auto MigrateChunk() -> bool = 0;
+  // 在 HashTableResizer 的锁下调用，判断任务是否还有未认领的区间
+  virtual auto Exhausted() const -> bool = 0;
+};
 
-  HashTableResizer(int size) : stop_requested_(false) {
-#ifdef USE_HASH_RESIZER
-    printf("HashTableResizer is enabled with %d threads.\n", size);
-#endif
-#ifdef USE_SHARED_LATCH
-    printf("Using shared mutex for read operations.\n");
-#endif
-    for (int i = 0; i < size; ++i) {
-      threads_.emplace_back(&HashTableResizer::ResizeThread, this);
-    }
+/**
+ * @brief 进程内共享的扩容线程池。
+ *
+ * 线程在第一次 Submit 时才启动，默认 min(DEFAULT_NUM_THREADS, 核数) 个，
+ * 启动前可以用 SetNumThreads 修改。定义 USE_HASH_RESIZER 时所有表共用
+ * Instance()。空闲线程轮流从正在迁移的表上窃取区间，一张表的 rehash
+ * 因此由多个线程并行完成；访问迁移中表的前台写操作也会顺带迁移一个区间
+ * （见 MyHashTable）。
+ */
+class HashTableResizer {
+ public:
+  static auto Instance() -> HashTableResizer& {
+    static HashTableResizer resizer;
+    return resizer;
   }
 
   ~HashTableResizer() {
@@ -59,58 +58,101 @@ class HashTableResizer {
   HashTableResizer(const HashTableResizer&) = delete;
   HashTableResizer& operator=(const HashTableResizer&) = delete;
 
-  void EnqueueResize(HashTableType* table) {
-    if (table == nullptr) return;
+  // 线程池启动之后不能再修改，返回 false
+  auto SetNumThreads(size_t num_threads) -> bool {
     std::unique_lock<std::mutex> lock(latch_);
-    resize_queue_.push(table);
-    cv_.notify_one();
+    if (!threads_.empty() || num_threads == 0) {
+      return false;
+    }
+    num_threads_ = num_threads;
+    return true;
+  }
+
+  auto NumThreads() -> size_t {
+    std::unique_lock<std::mutex> lock(latch_);
+    return num_threads_;
+  }
+
+  // 登记一个刚开始迁移的任务，已经在队列里时什么都不做
+  void Submit(ResizeJob* job) {
+    if (job == nullptr) return;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      if (threads_.empty()) {
+        start_threads();
+      }
+      if (std::find(jobs_.begin(), jobs_.end(), job) == jobs_.end()) {
+        jobs_.push_back(job);
+      }
+    }
+    cv_.notify_all();
   }
 
-  void DelayGC(std::vector<std::vector<std::pair<Key, Value>>> & gc_list) {
-    // 启动一个线程，延迟若干时间后释放gc_list
-    std::thread([gc_list = std::move(gc_list)]() mutable {
-      std::this_thread::sleep_for(std::chrono::seconds(1));  // 延迟1秒
-      gc_list.clear();  // 清空gc_list
-    }).detach();
+  // 摘掉任务并等待正在迁移它的线程离开，返回后线程池不会再访问 job
+  void Cancel(ResizeJob* job) {
+    std::unique_lock<std::mutex> lock(latch_);
+    jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), job), jobs_.end());
+    idle_cv_.wait(lock, [this, job] { return busy_.count(job) == 0; });
   }
 
  private:
+  HashTableResizer() {
+    size_t cores = std::thread::hardware_concurrency();
+    num_threads_ = std::max<size_t>(
+        1, std::min<size_t>(DEFAULT_NUM_THREADS, cores == 0 ? 1 : cores));
+  }
+
+  // 调用方持有 latch_
+  void start_threads() {
+#ifdef USE_HASH_RESIZER
+    printf("HashTableResizer is enabled with %zu threads.\n", num_threads_);
+#endif
+    for (size_t i = 0; i < num_threads_; ++i) {
+      threads_.emplace_back(&HashTableResizer::ResizeThread, this);
+    }
+  }
+
   void ResizeThread() {
     while (true) {
-      HashTableType* re_table = nullptr;
+      ResizeJob* job = nullptr;
       {
         std::unique_lock<std::mutex> lock(latch_);
-        cv_.wait(lock,
-                 [this] { return !resize_queue_.empty() || stop_requested_; });
-
-        if (stop_requested_ && resize_queue_.empty()) {
+        cv_.wait(lock, [this] { return !jobs_.empty() || stop_requested_; });
+        if (stop_requested_ && jobs_.empty()) {
           break;
         }
+        // 轮流选择任务，多张表同时迁移时线程会分散到各张表上
+        job = jobs_[next_job_++ % jobs_.size()];
+        busy_[job]++;
+      }
 
-        if (!resize_queue_.empty()) {
-          re_table = resize_queue_.front();
-          resize_queue_.pop();
-        }
+      while (job->MigrateChunk()) {
       }
 
-      if (re_table != nullptr) {
-        try {
-          re_table->Resize();
-        } catch (const std::exception& e) {
-          std::cerr << "Exception in resizing: " << e.what() << std::endl;
-        }
+      std::unique_lock<std::mutex> lock(latch_);
+      // 表可能已经开始下一轮扩容并重新 Submit，只摘掉确实没有区间的任务
+      if (job->Exhausted()) {
+        jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), job), jobs_.end());
+      }
+      if (--busy_[job] == 0) {
+        busy_.erase(job);
+        idle_cv_.notify_all();
       }
     }
   }
 
   std::mutex latch_;
-  // Store raw pointers to MyHashTable instances that need resizing
-  std::queue<HashTableType*> resize_queue_;
+  // 还有未认领区间的任务
+  std::vector<ResizeJob*> jobs_;
+  // 每个任务上正在迁移的线程数，Cancel 等它归零
+  std::unordered_map<ResizeJob*, size_t> busy_;
+  size_t next_job_ = 0;
+  size_t num_threads_;
   // Condition variable to notify threads
   std::condition_variable cv_;
+  std::condition_variable idle_cv_;
   // Flag to signal the thread to stop
-  std::atomic<bool> stop_requested_;
-  // std::optional<std::thread> resize_thread_;
+  bool stop_requested_ = false;
   std::vector<std::thread> threads_;
 };
 
@@ -15,6 +15,10 @@
 
 #include <functional>
 #include <string>
+#include <vector>
+
+#include "hash_table_resizer.h"
+#include "shard_stats.h"
 
 namespace myLru {
 
@@ -22,7 +26,7 @@ template <typename Key, typename Value, typename Hash = std::hash<Key>,
           typename KeyEqual = std::equal_to<Key>>
 class HashTableWrapper {
 public:
-  using HashTableResizerType = HashTableResizer<Key, Value, Hash, KeyEqual>;
+  using HashTableResizerType = HashTableResizer;
   HashTableWrapper() {
 #ifdef USE_LIBCUCKOO
     // table_.set_num_buckets(16);
@@ -88,6 +92,63 @@ public:
 #endif
   }
 
+  // 以下带 hash 的版本传入调用方已经算好的 Hash()(key)，MyHashTable 和
+  // SegHashTable 直接用它选桶；libcuckoo 自己计算 hash，忽略这个参数
+  auto Insert(const Key &key, size_t hash, const Value &value) -> bool {
+#ifdef USE_LIBCUCKOO
+    (void)hash;
+    return table_.insert(key, value);
+#else
+    return my_table_.Insert(key, hash, value);
+#endif
+  }
+
+  auto Get(const Key &key, size_t hash, Value &value_out) -> bool {
+#ifdef USE_LIBCUCKOO
+    (void)hash;
+    return table_.find(key, value_out);
+#else
+    return my_table_.Get(key, hash, value_out);
+#endif
+  }
+
+  auto Remove(const Key &key, size_t hash) -> bool {
+#ifdef USE_LIBCUCKOO
+    (void)hash;
+    return table_.erase(key);
+#else
+    return my_table_.Remove(key, hash);
+#endif
+  }
+
+  // 删除一批 key，返回实际删除的个数。MyHashTable 只加一次锁
+  auto RemoveBatch(const std::vector<Key> &keys) -> size_t {
+#ifdef USE_LIBCUCKOO
+    size_t removed = 0;
+    for (const Key &key : keys) {
+      if (table_.erase(key)) {
+        removed++;
+      }
+    }
+    return removed;
+#elif defined(USE_MY_HASH_TABLE)
+    return my_table_.RemoveBatch(keys);
+#elif defined(USE_SEG_HASH_TABLE)
+    return my_table_.RemoveBatch(keys);
+#endif
+  }
+
+  // hashes[i] 为调用方已经算好的 Hash()(keys[i])，libcuckoo 忽略
+  auto RemoveBatch(const std::vector<Key> &keys,
+                   const std::vector<size_t> &hashes) -> size_t {
+#ifdef USE_LIBCUCKOO
+    (void)hashes;
+    return RemoveBatch(keys);
+#else
+    return my_table_.RemoveBatch(keys, hashes);
+#endif
+  }
+
   auto Size() const -> size_t { // Marked const as it doesn't modify the table
 #ifdef USE_LIBCUCKOO
     return table_.size();
@@ -126,6 +187,38 @@ public:
 #endif
   }
 
+  // 按预计的元素数调整一次桶数，表里已有元素时也可以调用
+  auto Reserve(size_t expected) -> void {
+#ifdef USE_LIBCUCKOO
+    table_.reserve(expected);
+#elif defined(USE_MY_HASH_TABLE)
+    my_table_.Reserve(expected);
+#elif defined(USE_SEG_HASH_TABLE)
+    // SegHashTable 不支持在有元素时改桶数
+    (void)expected;
+#endif
+  }
+
+  auto GetChainStats() -> ChainStats {
+#ifdef USE_LIBCUCKOO
+    return ChainStats();
+#else
+    return my_table_.GetChainStats();
+#endif
+  }
+
+  // 只有 MyHashTable 支持，其余实现返回 false
+  auto SetLoadFactors(double min_load_factor, double max_load_factor)
+      -> bool {
+#ifdef USE_MY_HASH_TABLE
+    return my_table_.SetLoadFactors(min_load_factor, max_load_factor);
+#else
+    (void)min_load_factor;
+    (void)max_load_factor;
+    return false;
+#endif
+  }
+
 private:
 #ifdef USE_LIBCUCKOO
   libcuckoo::cuckoohash_map<Key, Value, Hash, KeyEqual> table_;
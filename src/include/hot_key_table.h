@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "config.h"
+#include "seqlock_field.h"
+namespace myLru {
+
+#define HOTKEYTABLE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define HOTKEYTABLE HotKeyTable<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief 热点 key 的只读副本，查分片之前先查这里。
+ *
+ * 检测：每个线程每 kSampleRate 次 Record 抽样一次，用 Space-Saving 统计
+ * 重流量 key，每 kWindowSamples 个样本发布一次热点集合，然后计数减半老化。
+ * 副本：kSlots 个直接映射的槽位，每个槽位用 version_ 做 seqlock，
+ * 读路径只有两次 acquire load，不写任何共享内存。槽位的其余字段都是
+ * relaxed atomic，读者与写者并发访问不构成数据竞争。
+ * 新发布的热点槽位是空的，由下一次在分片中命中的 Find 填充；
+ * Insert/Remove 在修改分片之后、分片因容量淘汰 key 时在 latch_ 下调用
+ * Invalidate，使副本和正在进行的填充失效。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class HotKeyTable {
+ public:
+  // Find 未命中且不需要填充时 fill_version 的值，有效的版本号都是偶数
+  static constexpr uint32_t kNoFill = 1;
+
+  HotKeyTable() = default;
+  HotKeyTable(const HotKeyTable&) = delete;
+  HotKeyTable& operator=(const HotKeyTable&) = delete;
+
+  /**
+   * @brief 查找热点副本。未命中时如果槽位已分配给 key 但还没有值，
+   * fill_version 返回当前版本号，拿到分片中的值后用它调用 Fill。
+   */
+  auto Find(const Key& key, size_t hash, Value& value,
+            uint32_t& fill_version) -> bool;
+
+  // 版本号在这期间变化过（被 Invalidate 或重新发布）时放弃填充
+  auto Fill(const Key& key, size_t hash, const Value& value,
+            uint32_t fill_version) -> void;
+
+  auto Invalidate(const Key& key, size_t hash) -> void;
+
+  // 抽样记录一次访问，返回这次访问是否被抽中
+  auto Record(const Key& key) -> bool;
+
+  auto Contains(const Key& key) -> bool;
+
+  auto Clear() -> void;
+
+ private:
+  static constexpr size_t kSlots = 64;
+  static constexpr uint32_t kSampleRate = 32;
+  static constexpr size_t kCounters = 32;
+  static constexpr size_t kWindowSamples = 1024;
+  // 一个窗口内样本占比不低于 1/kHotShareDivisor 的 key 视为热点
+  static constexpr size_t kHotShareDivisor = 64;
+
+  struct alignas(64) HotSlot {
+    std::atomic<uint32_t> version_{0};
+    // 槽位是否分配给了某个热点 key，以及 value_ 是否已经填充
+    std::atomic<bool> used_{false};
+    std::atomic<bool> valid_{false};
+    SeqlockField<Key> key_;
+    SeqlockField<Value> value_;
+  };
+
+  struct Counter {
+    Key key_;
+    size_t count_;
+    // Space-Saving 替换时继承的计数，是 count_ 的高估上界
+    size_t error_;
+  };
+
+  HotSlot slots_[kSlots];
+
+  std::mutex sketch_latch_;
+  std::vector<Counter> counters_;
+  size_t samples_ = 0;
+
+  auto slot_of(size_t hash) -> HotSlot& { return slots_[hash & (kSlots - 1)]; }
+  auto lock_slot(HotSlot& slot) -> uint32_t;
+  auto unlock_slot(HotSlot& slot, uint32_t version) -> void;
+  auto publish() -> void;
+};
+
+}  // namespace myLru
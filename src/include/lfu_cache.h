@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "hash_table_resizer.h"
+#include "hashtable_wrapper.h"
+#include "hot_key_table.h"
+#include "removal_queue.h"
+#include "seqlock_field.h"
+#include "shard_stats.h"
+namespace myLru {
+
+#define LFUCACHE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define LFUCACHE LFUCache<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief O(1) LFU：按频率从小到大排列的桶链表，每个桶内是一条 LRU 链表。
+ *
+ * 命中时节点从 freq 桶移动到 freq + 1 桶的头部，淘汰最小频率桶的尾部节点，
+ * 频率相同时按 LRU 淘汰。每 decay_interval_ 次操作把所有频率减半，
+ * 让过去的热点逐渐老化。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class LFUCache {
+ public:
+  struct FreqBucket;
+  struct LRUNode {
+    LRUNode() : next_(nullptr), prev_(nullptr), bucket_(nullptr) {}
+
+    LRUNode* next_;
+    LRUNode* prev_;
+    FreqBucket* bucket_;
+    // 写节点时 version_ 为奇数，USE_HHVM 下无锁的 Find 通过前后两次读取
+    // 判断是否读到了正在被复用的节点
+    std::atomic<uint32_t> version_{0};
+    // 无锁的 Find 与复用节点的 Insert 并发访问，见 SeqlockField
+    SeqlockField<Key> key_;
+    // 插入时的 Hash()(key_)，淘汰时直接使用
+    size_t hash_ = 0;
+    SeqlockField<Value> value_;
+  };
+
+  struct FreqBucket {
+    FreqBucket() : freq_(0), next_(nullptr), prev_(nullptr) {
+      head_.next_ = &tail_;
+      tail_.prev_ = &head_;
+    }
+
+    size_t freq_;
+    FreqBucket* next_;
+    FreqBucket* prev_;
+    LRUNode head_;
+    LRUNode tail_;
+
+    auto Empty() const -> bool { return head_.next_ == &tail_; }
+  };
+
+  using ResizerType = HashTableResizer;
+  using RemovalQueueType = RemovalQueue<Key, Value>;
+#ifdef USE_HOT_KEY_CACHE
+  using HotKeyTableType = HotKeyTable<Key, Value, Hash, KeyEqual>;
+#endif
+
+  LFUCache();
+  LFUCache(size_t size);
+  LFUCache(const LFUCache&) = delete;
+  LFUCache& operator=(const LFUCache&) = delete;
+  ~LFUCache();
+
+  auto Find(const Key& key, Value& value) -> bool {
+    return Find(key, Hash()(key), value);
+  }
+  // hash 为调用方算好的 Hash()(key)
+  auto Find(const Key& key, size_t hash, Value& value) -> bool;
+
+  auto Insert(const Key& key, Value value) -> bool {
+    return Insert(key, Hash()(key), value);
+  }
+  auto Insert(const Key& key, size_t hash, Value value) -> bool;
+
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
+
+  auto Size() -> size_t;
+  auto Clear() -> void;
+  auto Resize(size_t size) -> void;
+  auto IsEmpty() -> bool { return cur_size_ == 0; }
+  auto Capacity() -> size_t { return max_size_; }
+  auto IsFull() -> bool { return cur_size_ == max_size_; }
+
+  /**
+   * @brief 设置频率减半的周期（Find 命中 + Insert 的次数），0 表示不衰减。
+   * 默认是容量的 kDecayFactor 倍。
+   */
+  auto SetDecayInterval(size_t ops) -> void;
+
+  auto SetResizer(ResizerType* resizer) -> void {
+    hash_table_.SetResizer(resizer);
+  }
+
+  auto GetStats() -> ShardStats;
+  auto GetChainStats() -> ChainStats { return hash_table_.GetChainStats(); }
+  // 导出顺序：从最小频率桶开始，每个桶内从尾到头。重新插入后频率都从 1 开始
+  auto ExportEntries(std::vector<std::pair<Key, Value>>& entries) -> void;
+  /**
+   * @brief 打开后被淘汰的 key 会记入与分片容量相同的 ghost 队列，
+   * 用于统计 ghost_hits_。默认关闭。
+   */
+  auto SetGhostTracking(bool enable) -> void;
+  // 设置后被淘汰和 Remove 的条目在 latch_ 下写入 queue，nullptr 表示关闭
+  auto SetRemovalQueue(RemovalQueueType* queue) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    removal_queue_ = queue;
+  }
+#ifdef USE_HOT_KEY_CACHE
+  // 设置后因容量被淘汰的 key 在 latch_ 下让 hot_keys 中的副本失效
+  auto SetHotKeyTable(HotKeyTableType* hot_keys) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    hot_keys_ = hot_keys;
+  }
+#endif
+
+ private:
+  static constexpr size_t kDecayFactor = 8;
+
+  HashTableWrapper<Key, LRUNode*, Hash, KeyEqual> hash_table_;
+  // 频率桶链表的哨兵
+  FreqBucket bucket_head_;
+  FreqBucket bucket_tail_;
+  std::mutex latch_;
+  size_t max_size_;
+  size_t cur_size_;
+
+  GhostQueue ghost_;
+  bool ghost_tracking_ = false;
+  size_t evictions_ = 0;
+  size_t ghost_hits_ = 0;
+  RemovalQueueType* removal_queue_ = nullptr;
+#ifdef USE_HOT_KEY_CACHE
+  HotKeyTableType* hot_keys_ = nullptr;
+#endif
+  size_t decay_interval_ = 0;
+  bool custom_decay_interval_ = false;
+  size_t ops_since_decay_ = 0;
+
+  std::deque<LRUNode> nodes_;
+  std::vector<LRUNode*> free_list_;
+  std::deque<FreqBucket> buckets_;
+  std::vector<FreqBucket*> free_buckets_;
+
+  auto evict() -> void;
+
+  // 放回 free_list_，同时让读到旧节点的无锁 Find 失效
+  auto release_node(LRUNode* node) -> void;
+
+  auto increment(LRUNode* node) -> void;
+
+  auto decay() -> void;
+
+  auto tick() -> void;
+
+  auto push_node(FreqBucket* bucket, LRUNode* node) -> void;
+
+  auto remove_node(LRUNode* node) -> void;
+
+  auto allocate_bucket(size_t freq, FreqBucket* prev) -> FreqBucket*;
+
+  auto release_bucket(FreqBucket* bucket) -> void;
+
+  auto grow_pool(size_t size) -> void;
+};
+
+}  // namespace myLru
@@ -1,13 +1,64 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "access_trace.h"
+#include "cold_pool.h"
 #include "config.h"
+#include "flash_tier.h"
+#include "hash_batch.h"
 #include "hash_table_resizer.h"
 #include "hashtable_wrapper.h"
+#include "hot_key_table.h"
+#include "mrc_estimator.h"
+#include "removal_queue.h"
+#include "shard_stats.h"
+#include "s3fifo_cache.h"
+#include "sampled_lru_cache.h"
+#include "seqlock_field.h"
+#include "lfu_cache.h"
 namespace myLru {
 
+#if defined(USE_BUFFER) &&                                 \
+    (defined(USE_S3FIFO) || defined(USE_SIEVE) || \
+     defined(USE_SAMPLED_LRU) || defined(USE_LFU))
+#error "USE_BUFFER only works with LRUCache shards in LRU mode."
+#endif
+#if (defined(USE_S3FIFO) + defined(USE_SAMPLED_LRU) + defined(USE_LFU)) > 1
+#error "Choose only one shard policy."
+#endif
+#if defined(USE_MIDPOINT_INSERTION) && \
+    (defined(USE_SIEVE) || defined(USE_BUFFER))
+#error "USE_MIDPOINT_INSERTION conflicts with USE_SIEVE and USE_BUFFER."
+#endif
+#if defined(USE_HOT_KEY_CACHE) && defined(USE_BUFFER)
+#error "USE_HOT_KEY_CACHE does not work with buffered inserts."
+#endif
+#if defined(USE_FLASH_TIER) &&                                         \
+    (defined(USE_S3FIFO) || defined(USE_SAMPLED_LRU) || defined(USE_LFU) || \
+     defined(USE_BUFFER))
+#error "USE_FLASH_TIER only hooks LRUCache::evict()."
+#endif
+#if defined(USE_COLD_TIER) &&                                          \
+    (defined(USE_S3FIFO) || defined(USE_SAMPLED_LRU) || defined(USE_LFU) || \
+     defined(USE_BUFFER) || defined(USE_FLASH_TIER))
+#error "USE_COLD_TIER only works with LRUCache shards and no flash tier."
+#endif
+#if defined(USE_BACKGROUND_EVICTION) &&                                \
+    (defined(USE_S3FIFO) || defined(USE_SAMPLED_LRU) || defined(USE_LFU) || \
+     defined(USE_BUFFER))
+#error "USE_BACKGROUND_EVICTION only works with LRUCache shards."
+#endif
+
 #define LRUCACHE_TEMPLATE_ARGUMENTS \
   template <typename Key, typename Value, typename Hash, typename KeyEqual>
 
@@ -23,17 +74,42 @@ class LRUCache {
   inline static LRUNode* const OutOfListMarker = reinterpret_cast<LRUNode*>(-1);
   struct LRUNode {
     LRUNode() : next_(nullptr), prev_(nullptr) {}
-    LRUNode(const Key& key, const Value& value) : key_(key), value_(value) {}
+    LRUNode(const Key& key, size_t hash, const Value& value) : hash_(hash) {
+      key_.Store(key);
+      value_.Store(value);
+    }
 
     LRUNode* next_;
     LRUNode* prev_;
-    Key key_;
-    Value value_;
+    // SIEVE 的无锁 Find 与复用节点的 Insert 并发访问，见 SeqlockField
+    SeqlockField<Key> key_;
+    // 插入时的 Hash()(key_)，淘汰时直接使用，不再重新计算
+    size_t hash_ = 0;
+    SeqlockField<Value> value_;
+#ifdef USE_SIEVE
+    // 写节点时 version_ 为奇数，无锁的 Find 通过前后两次读取判断是否读到了
+    // 正在被复用的节点
+    std::atomic<uint32_t> version_{0};
+    // SIEVE 访问标记，命中时置位，hand 扫过时清除
+    std::atomic<bool> visited_{false};
+#endif
+#ifdef USE_MIDPOINT_INSERTION
+    // 是否位于 old 子链表，以及插入时间（相对 epoch_ 的毫秒数）
+    bool old_ = false;
+    uint32_t old_time_ = 0;
+#endif
 
     auto inList() -> bool { return prev_ != LRUCache::OutOfListMarker; }
   };
 
-  using ResizerType = HashTableResizer<Key, LRUNode*, Hash, KeyEqual>;
+  using ResizerType = HashTableResizer;
+  using RemovalQueueType = RemovalQueue<Key, Value>;
+#ifdef USE_HOT_KEY_CACHE
+  using HotKeyTableType = HotKeyTable<Key, Value, Hash, KeyEqual>;
+#endif
+#ifdef USE_FLASH_TIER
+  using FlashTierType = FlashTier<Key, Value, Hash, KeyEqual>;
+#endif
 
   LRUCache();
   LRUCache(size_t size);
@@ -41,14 +117,23 @@ class LRUCache {
   LRUCache& operator=(const LRUCache&) = delete;
   ~LRUCache();
 
-  auto Find(const Key& key, Value& value) -> bool;
+  auto Find(const Key& key, Value& value) -> bool {
+    return Find(key, Hash()(key), value);
+  }
+  // 带 hash 的版本由 SegLRUCache 传入已经算好的 Hash()(key)，分片里的
+  // 哈希表、ghost 队列都直接使用它，不再重新计算
+  auto Find(const Key& key, size_t hash, Value& value) -> bool;
 
-  auto Insert(const Key& key, Value value) -> bool;
+  auto Insert(const Key& key, Value value) -> bool {
+    return Insert(key, Hash()(key), value);
+  }
+  auto Insert(const Key& key, size_t hash, Value value) -> bool;
 
 #ifdef USE_BUFFER
   auto InsertBuffer(LRUNode* buffer_head, LRUNode* buffer_tail) -> void;
 #endif
-  auto Remove(const Key& key) -> bool;
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
 
   auto Size() -> size_t;
   auto Clear() -> void;
@@ -61,6 +146,86 @@ class LRUCache {
     hash_table_.SetResizer(resizer);
   }
 
+  auto GetStats() -> ShardStats;
+  auto GetChainStats() -> ChainStats { return hash_table_.GetChainStats(); }
+  /**
+   * @brief 在 latch_ 下从 tail_ 到 head_ 追加所有条目，即最先被淘汰的在前。
+   * 按这个顺序重新 Insert 可以恢复同样的 LRU 顺序。
+   */
+  auto ExportEntries(std::vector<std::pair<Key, Value>>& entries) -> void;
+  /**
+   * @brief 打开后被淘汰的 key 会记入与分片容量相同的 ghost 队列，
+   * 用于统计 ghost_hits_。默认关闭。
+   */
+  auto SetGhostTracking(bool enable) -> void;
+  /**
+   * @brief 设置后被淘汰和 Remove 的条目在 latch_ 下写入 queue，nullptr 表示
+   * 关闭。打开冷池时淘汰记录在条目被挤出冷池时产生，而不是离开 hot 链表时。
+   */
+  auto SetRemovalQueue(RemovalQueueType* queue) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    removal_queue_ = queue;
+  }
+#ifdef USE_HOT_KEY_CACHE
+  // 设置后因容量被淘汰的 key 在 latch_ 下让 hot_keys 中的副本失效
+  auto SetHotKeyTable(HotKeyTableType* hot_keys) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    hot_keys_ = hot_keys;
+  }
+#endif
+
+#ifdef USE_COLD_TIER
+  /**
+   * @brief 冷池的字节预算，0 表示关闭（默认）。打开后 evict() 把条目写进
+   * ColdPool，超出预算时丢弃最旧的条目；Find 在 hot 未命中时查冷池，命中后
+   * 取出并重新插入 hot 链表。Size() 只统计 hot 部分。
+   */
+  auto SetColdTier(size_t budget_bytes) -> void;
+#endif
+
+#ifdef USE_BACKGROUND_EVICTION
+  /**
+   * @brief 设置后台淘汰的水位，单位是容量的百分比。条目数超过 high_percent
+   * 后 AboveHighWatermark() 变为 true，由后台线程调用 EvictToLowWatermark
+   * 淘汰到 low_percent。high_percent 为 0 表示关闭（默认）。
+   * 分片被填满时 Insert 仍然在线淘汰。
+   */
+  auto SetWatermarks(size_t low_percent, size_t high_percent) -> void;
+  // 不加锁读取的提示，只用来决定是否唤醒后台线程
+  auto AboveHighWatermark() const -> bool {
+    return above_high_.load(std::memory_order_relaxed);
+  }
+  // 每批最多淘汰 kEvictBatch 个，批与批之间释放 latch_，返回淘汰的总数
+  auto EvictToLowWatermark() -> size_t;
+#endif
+
+#ifdef USE_FLASH_TIER
+  /**
+   * @brief 设置后被淘汰的条目交给 flash 层，nullptr 表示关闭。淘汰时只在
+   * latch_ 下把条目放进 flash_victims_，释放 latch_ 之后才调用 Admit；
+   * Insert 和 Remove 在 latch_ 下删除 flash 中同一个 key 的旧值。
+   */
+  auto SetFlashTier(FlashTierType* flash) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    flash_ = flash;
+  }
+  /**
+   * @brief 把 FlashTier::Find 在 offset 处读到的条目提升回分片。在 latch_
+   * 下确认 flash 索引仍指向 offset 才插入，读取期间被 Remove 或覆盖时
+   * 返回 false，调用方按未命中处理。
+   */
+  auto PromoteFromFlash(const Key& key, size_t hash, const Value& value,
+                        uint64_t offset) -> bool;
+#endif
+
+#ifdef USE_MIDPOINT_INSERTION
+  /**
+   * @brief 设置 old 子链表占比（百分比，5~95）和晋升前的停留时间。
+   * 默认值与 InnoDB 的 innodb_old_blocks_pct / innodb_old_blocks_time 相同。
+   */
+  auto SetMidpoint(size_t old_percent, uint32_t dwell_ms) -> void;
+#endif
+
  private:
   HashTableWrapper<Key, LRUNode*, Hash, KeyEqual> hash_table_;
   LRUNode* head_;
@@ -68,21 +233,117 @@ class LRUCache {
   std::mutex latch_;
   size_t max_size_;
   size_t cur_size_;
+  GhostQueue ghost_;
+  bool ghost_tracking_ = false;
+  size_t evictions_ = 0;
+  size_t ghost_hits_ = 0;
+  RemovalQueueType* removal_queue_ = nullptr;
+#ifdef USE_HOT_KEY_CACHE
+  HotKeyTableType* hot_keys_ = nullptr;
+#endif
+#ifdef USE_FLASH_TIER
+  FlashTierType* flash_ = nullptr;
+  // 带上节点里已经算好的 hash，Admit 时不再重新计算指纹
+  struct FlashVictim {
+    Key key_;
+    size_t hash_;
+    Value value_;
+  };
+  // detach_victim 在 latch_ 下摘下、还没有交给 flash 的条目
+  std::vector<FlashVictim> flash_victims_;
+  // 交给 flash 期间持有。淘汰方在释放 latch_ 之前拿到它，之后在 latch_ 下
+  // 删除 flash 中 key 的 Insert、Remove 会等到这批条目写入索引，
+  // 不会被更早淘汰的旧值覆盖
+  std::mutex flash_latch_;
+  // 由 flash_latch_ 保护，Admit 期间不占用 flash_victims_
+  std::vector<FlashVictim> flash_admitting_;
+#endif
+#ifdef USE_COLD_TIER
+  ColdPool<Key, Value, Hash, KeyEqual> cold_;
+  size_t cold_budget_ = 0;
+  size_t cold_hits_ = 0;
+#endif
+#ifdef USE_BACKGROUND_EVICTION
+  static constexpr size_t kEvictBatch = 64;
+  size_t low_percent_ = 0;
+  size_t high_percent_ = 0;
+  // 按当前容量换算的条目数，high_mark_ 为 0 表示关闭
+  size_t low_mark_ = 0;
+  size_t high_mark_ = 0;
+  std::atomic<bool> above_high_{false};
+  size_t background_evictions_ = 0;
+#endif
+#ifdef USE_SIEVE
+  // SIEVE 的 hand，从 tail_ 向 head_ 方向移动，nullptr 表示从 tail_ 重新开始
+  LRUNode* hand_ = nullptr;
+#endif
+#ifdef USE_MIDPOINT_INSERTION
+  // 链表分为 young（head_ 一侧）和 old（tail_ 一侧）两段，midpoint_ 指向
+  // old 子链表的第一个节点，old 子链表为空时指向 tail_
+  LRUNode* midpoint_;
+  size_t old_size_ = 0;
+  size_t old_percent_ = 37;
+  uint32_t dwell_ms_ = 1000;
+  std::chrono::steady_clock::time_point epoch_ =
+      std::chrono::steady_clock::now();
+#endif
 #ifdef PRE_ALLOCATE
-  std::vector<LRUNode> nodes_;
-  std::vector<size_t> free_list_;
+  // deque 扩容时不移动已有节点，哈希表里的节点指针保持有效
+  std::deque<LRUNode> nodes_;
+  std::vector<LRUNode*> free_list_;
+#endif
+  // evict_batch 复用的缓冲区
+  std::vector<Key> evict_keys_;
+  std::vector<size_t> evict_hashes_;
+#ifndef PRE_ALLOCATE
+  std::vector<LRUNode*> evict_nodes_;
 #endif
 
+#if defined(USE_SIEVE) && defined(PRE_ALLOCATE)
+  // 不持有 latch_ 读取命中的节点，节点已被复用时返回 false
+  auto find_sieve(LRUNode* cur_node, const Key& key, Value& value) -> bool;
+#endif
   auto evict() -> void;
+  // 连续淘汰最多 count 个节点，哈希表删除合并成一次 RemoveBatch
+  auto evict_batch(size_t count) -> size_t;
+  auto select_victim() -> LRUNode*;
+  // 统计、交给冷池或 flash、写移除队列并摘下链表，不碰哈希表
+  auto detach_victim(LRUNode* node) -> void;
 
   auto push_node(LRUNode* node) -> void;
 
   auto remove_node(LRUNode* node) -> void;
 
-  auto remove_helper(const Key& key, LRUNode* del_node) -> bool;
+  auto remove_helper(const Key& key, size_t hash, LRUNode* del_node) -> bool;
+  auto insert_helper(const Key& key, size_t hash, const Value& value) -> bool;
+  // Remove 持有 latch_ 之后的部分
+  auto remove_locked(const Key& key, size_t hash) -> bool;
+#ifdef USE_FLASH_TIER
+  // 持有 latch_ 时调用，等待正在进行的 Admit 后删除 flash 中的 key
+  auto flash_erase(const Key& key, size_t hash) -> bool;
+  // 持有 latch_ 时调用，返回前释放 lock，再把 flash_victims_ 交给 flash
+  auto admit_victims(std::unique_lock<std::mutex>& lock) -> void;
+#endif
+#ifdef USE_COLD_TIER
+  auto cold_push(const Key& key, size_t hash, const Value& value) -> void;
+  auto cold_erase(const Key& key, size_t hash, RemovalQueueType* notify)
+      -> bool;
+  // 冷池放不下而丢弃的条目才算淘汰
+  auto cold_drop(const Key& key, const Value& value) -> void;
+  auto promote_cold(const Key& key, size_t hash, Value& value) -> bool;
+#endif
+#ifdef USE_BACKGROUND_EVICTION
+  auto update_watermarks() -> void;
+#endif
+#ifdef USE_MIDPOINT_INSERTION
+  auto push_old(LRUNode* node) -> void;
+  auto adjust_midpoint() -> void;
+  auto now_ms() const -> uint32_t;
+#endif
 #ifdef PRE_ALLOCATE
   auto allocate_node() -> LRUNode*;
   auto release_node(LRUNode* node) -> void;
+  auto grow_pool(size_t size) -> void;
 #endif
 };
 
@@ -90,12 +351,32 @@ template <typename Key, typename Value, typename Hash = HashFuncImpl,
           typename KeyEqual = std::equal_to<Key>>
 class SegLRUCache {
  public:
+  // 分片的淘汰策略在编译期选择，默认是 LRUCache
+#if defined(USE_S3FIFO)
+  using ShardType = S3FIFOCache<Key, Value>;
+#elif defined(USE_SAMPLED_LRU)
+  using ShardType = SampledLRUCache<Key, Value>;
+#elif defined(USE_LFU)
+  using ShardType = LFUCache<Key, Value>;
+#else
   using ShardType = LRUCache<Key, Value>;
-  using ResizerForShardsType = typename ShardType::ResizerType;
+#endif
+#ifdef USE_BUFFER
   using LRUNode = typename ShardType::LRUNode;
+#endif
+  using RemovalListener =
+      std::function<void(const RemovalRecord<Key, Value>&)>;
 
   explicit SegLRUCache(size_t capacity);
+  ~SegLRUCache();
   auto Find(const Key& key, Value& value) -> bool;
+  /**
+   * @brief 查找 count 个 key，found[i] 表示 keys[i] 是否命中，返回命中数。
+   * 打开 flash 层时，DRAM 未命中的 key 合并成一次 FlashTier::FindBatch，
+   * 需要读盘的记录一起提交，而不是每个 key 各自阻塞在一次 pread 上。
+   */
+  auto FindBatch(const Key* keys, size_t count, Value* values, bool* found)
+      -> size_t;
   auto Insert(const Key& key, Value value) -> bool;
   auto Remove(const Key& key) -> bool;
   auto Size() -> size_t;
@@ -106,8 +387,158 @@ class SegLRUCache {
   auto IsFull() -> bool;
   auto GetHis_Miss() -> void;
 
+  auto GetStats() -> ShardStats;
+  auto GetShardStats(uint32_t shard) -> ShardStats;
+  // 所有分片哈希表的链长分布之和
+  auto GetChainStats() -> ChainStats;
+  auto GetShardChainStats(uint32_t shard) -> ChainStats;
+  // key 所在的分片
+  static auto ShardOf(const Key& key) -> uint32_t {
+    return Shard(SegHash(key));
+  }
+  auto SetGhostTracking(bool enable) -> void;
+  /**
+   * @brief 打开或关闭命中率曲线估计（SHARDS，见 mrc_estimator.h），只统计
+   * Find。打开时清空之前的估计，直方图覆盖此时 Capacity() 的 10 倍。
+   */
+  auto SetMrcTracking(bool enable) -> void;
+  // 总容量为当前 Capacity() 的 0.1 到 10 倍时的估计命中率
+  auto GetMissRatioCurve() -> MissRatioCurve;
+#ifdef USE_HOT_KEY_CACHE
+  auto IsHotKey(const Key& key) -> bool { return hot_keys_.Contains(key); }
+#endif
+#ifdef USE_COLD_TIER
+  // 每个分片的冷池预算都设为 budget_bytes_per_seg
+  auto SetColdTier(size_t budget_bytes_per_seg) -> void;
+#endif
+#ifdef USE_FLASH_TIER
+  /**
+   * @brief 打开 path 作为 flash 层，之后各分片淘汰的条目写入这个文件，
+   * Find 在 DRAM 未命中时查 flash，命中后重新插入分片。
+   * 应在开始读写之前调用。Size() 和 Capacity() 只统计 DRAM 部分。
+   */
+  auto OpenFlashTier(const std::string& path, size_t capacity_bytes) -> bool;
+  auto GetFlashTier() -> FlashTier<Key, Value, Hash, KeyEqual>& {
+    return flash_;
+  }
+#endif
+
+  /**
+   * @brief 在分片之间移动一轮容量，总容量保持为构造时的 capacity * segNum。
+   *
+   * 上一轮以来有淘汰、没有空闲容量的分片各接收 kRebalanceStep 分之一的
+   * 初始容量，按 ghost 命中数（多给容量能带来的收益）排先后。容量优先从
+   * 空闲容量多的分片收回；都没有空闲时，只从淘汰数和 ghost 命中数都不到
+   * 接收方一半的分片收回。ghost 命中需要先 SetGhostTracking(true)，
+   * 不打开时只移动空闲容量。
+   * 每个分片只在自己的 Resize 里短暂持锁，不会阻塞其他分片。
+   */
+  auto Rebalance() -> void;
+  // 打开 ghost 统计并启动后台线程，每隔 interval 调用一次 Rebalance
+  auto StartRebalancer(std::chrono::milliseconds interval) -> void;
+  auto StopRebalancer() -> void;
+
+  /**
+   * @brief 设置移除监听器，nullptr 表示关闭。各分片在 latch_ 下只把被淘汰或
+   * Remove 的条目复制进自己的无锁队列（每个分片 queue_capacity 条），
+   * listener 平时只在 DrainRemovals 或 StartRemovalNotifier 的后台线程中调用，
+   * 不计入 Insert/Remove 的耗时。
+   * 队列满时默认（kDrain）不丢记录：记录暂存起来，产生它的 Find/Insert/Remove
+   * 释放分片 latch_ 之后在调用线程上 DrainRemovals 一次。kDrop 时新记录被
+   * 丢弃，见 DroppedRemovals。
+   * Clear 不产生记录。应在开始读写之前调用，已排队的记录会被丢弃。
+   */
+  auto SetRemovalListener(RemovalListener listener,
+                          size_t queue_capacity = kRemovalQueueCapacity,
+                          RemovalOverflow overflow = RemovalOverflow::kDrain)
+      -> void;
+  // 在调用线程上处理已排队的记录，返回处理的条数。listener 不会被并发调用
+  auto DrainRemovals() -> size_t;
+  // 启动后台线程，每隔 interval 调用一次 DrainRemovals，停止时再处理一次
+  auto StartRemovalNotifier(std::chrono::milliseconds interval) -> void;
+  auto StopRemovalNotifier() -> void;
+  auto DroppedRemovals() -> size_t;
+
+#ifdef USE_ACCESS_TRACE
+  /**
+   * @brief 开始把 Find/Insert/Remove 记录到 path（格式见 access_trace.h），
+   * 按 key hash 每 sample_rate 个 key 抽一个。记录只写调用线程自己的
+   * 无锁队列，由后台线程每隔 flush_interval 写入文件。
+   */
+  auto StartAccessTrace(const std::string& path, uint32_t sample_rate = 1,
+                        std::chrono::milliseconds flush_interval =
+                            std::chrono::milliseconds(100)) -> bool;
+  auto StopAccessTrace() -> void;
+  auto GetAccessTracer() -> AccessTracer& { return tracer_; }
+#endif
+
+#ifdef USE_BACKGROUND_EVICTION
+  /**
+   * @brief 设置各分片的水位并启动后台淘汰线程。Insert 之后发现分片超过
+   * 高水位时唤醒线程（每次越过只有一个线程付出唤醒的代价），线程把超过的
+   * 分片分批淘汰到低水位，前台 Insert 通常能直接拿到空闲节点。
+   */
+  auto StartEvictor(size_t low_percent, size_t high_percent) -> void;
+  // 停止线程并关闭水位，之后淘汰全部回到 Insert 中进行
+  auto StopEvictor() -> void;
+#endif
+
+  /**
+   * @brief 把所有分片写成二进制快照，每个分片按从 tail 到 head 的顺序。
+   * 逐个分片导出，每个分片只在复制条目时持有自己的 latch_，可以和读写并发。
+   * 先写 path.tmp 再 rename，失败时返回 false 且不影响已有的快照。
+   */
+  auto SaveSnapshot(const std::string& path) -> bool;
+  /**
+   * @brief mmap 快照文件，每个线程负责一部分分片，按文件中的顺序 Insert，
+   * 最后插入的条目最新。已存在的 key 保持不变。
+   */
+  auto LoadSnapshot(const std::string& path) -> bool;
+
  private:
-  LRUCACHE lru_cache_[segNum];
+  // 快照文件头，后面依次是 num_shards_ 个 uint64_t 的条目数和所有条目
+  struct SnapshotHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t num_shards_;
+    uint32_t key_size_;
+    uint32_t value_size_;
+  };
+  static constexpr char kSnapshotMagic[8] = {'M', 'Y', 'L', 'R',
+                                             'U', 'S', 'N', 'P'};
+  static constexpr uint32_t kSnapshotVersion = 1;
+  // LoadSnapshot 每批 HashBatch 的 key 数
+  static constexpr size_t kLoadBatch = 256;
+
+  static constexpr size_t kRemovalQueueCapacity = 4096;
+
+  // 每轮移动初始分片容量的 1/kRebalanceStep
+  static constexpr size_t kRebalanceStep = 16;
+  // 分片容量的下限是初始容量的 1/kMinCapacityDivisor
+  static constexpr size_t kMinCapacityDivisor = 4;
+
+  ShardType lru_cache_[segNum];
+  // 分片是生产者，removal_latch_ 下的 DrainRemovals 是唯一的消费者
+  RemovalQueue<Key, Value> removal_queues_[segNum];
+  RemovalListener removal_listener_;
+  std::mutex removal_latch_;
+  // DrainRemovals 取出的溢出记录，受 removal_latch_ 保护
+  std::vector<RemovalRecord<Key, Value>> removal_overflow_;
+  std::thread removal_notifier_;
+  std::mutex removal_notifier_latch_;
+  std::condition_variable removal_notifier_cv_;
+  bool removal_notifier_stop_ = false;
+#ifdef USE_BACKGROUND_EVICTION
+  // 没有被唤醒时也定期检查一次，兜住越过高水位时唤醒失败的情况
+  static constexpr std::chrono::milliseconds kEvictorInterval{10};
+  std::thread evictor_;
+  std::mutex evictor_latch_;
+  std::condition_variable evictor_cv_;
+  bool evictor_stop_ = false;
+  std::atomic<bool> evictor_wakeup_{false};
+
+  auto wake_evictor() -> void;
+#endif
 #ifdef USE_BUFFER
   LRUNode* buffer_[segNum];
   LRUNode* buffer_tail_[segNum];
@@ -119,13 +550,48 @@ class SegLRUCache {
   // std::atomic<size_t> hit_count_ = 0;
   // std::atomic<size_t> miss_count_ = 0;
 
-  ResizerForShardsType resizer_;
+#ifdef USE_HOT_KEY_CACHE
+  HotKeyTable<Key, Value, Hash, KeyEqual> hot_keys_;
+#endif
+#ifdef USE_FLASH_TIER
+  // 声明在 lru_cache_ 之后，先于分片析构
+  FlashTier<Key, Value, Hash, KeyEqual> flash_;
+
+  auto find_flash(const Key& key, size_t hash, Value& value) -> bool;
+#endif
 
-  static auto Shard(size_t hash) -> uint32_t {
-    return static_cast<uint32_t>(hash & (segNum - 1));
+#ifdef USE_ACCESS_TRACE
+  AccessTracer tracer_;
+#endif
+  MrcEstimator mrc_;
+
+  auto find_hashed(const Key& key, size_t hash, Value& value) -> bool;
+  // 分片的移除队列溢出过时在调用线程上处理一次，调用时不能持有分片 latch_
+  auto drain_if_needed(uint32_t shard) -> void;
+  // 当前线程是否正在 DrainRemovals 中调用 listener
+  static auto draining() -> bool& {
+    static thread_local bool draining = false;
+    return draining;
   }
+  // 只查热点副本和分片，不查 flash 层
+  auto find_memory(const Key& key, size_t hash, Value& value) -> bool;
+  // hash 为 SegHash(key)，Insert 和 LoadSnapshot 共用
+  auto insert_hashed(const Key& key, size_t hash, const Value& value) -> bool;
+
+  // 构造或 Resize 时每个分片的容量
+  size_t base_capacity_;
+  size_t last_ghost_hits_[segNum] = {0};
+  size_t last_evictions_[segNum] = {0};
+  std::mutex rebalance_latch_;
+  std::thread rebalancer_;
+  std::mutex rebalancer_latch_;
+  std::condition_variable rebalancer_cv_;
+  bool rebalancer_stop_ = false;
+
+  // 高位选分片，低位留给分片内的哈希表选桶，见 ShardOfHash
+  static auto Shard(size_t hash) -> uint32_t { return ShardOfHash(hash); }
 
-  static auto SegHash(const Key& key) -> size_t { return ShardHashFunc()(key); }
+  static auto SegHash(const Key& key) -> size_t { return Hash()(key); }
 };
 
 }  // namespace myLru
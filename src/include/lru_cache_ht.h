@@ -27,28 +27,39 @@ class LRUCacheHT {
   inline static LRUNode* const OutOfListMarker = reinterpret_cast<LRUNode*>(-1);
   struct LRUNode {
     LRUNode() : next_(nullptr), prev_(nullptr) {}
-    LRUNode(const Key& key, const Value& value) : key_(key), value_(value) {}
+    LRUNode(const Key& key, size_t hash, const Value& value)
+        : key_(key), hash_(hash), value_(value) {}
 
     LRUNode* next_;
     LRUNode* prev_;
     Key key_;
+    // 插入时的 Hash()(key_)，淘汰时直接使用
+    size_t hash_ = 0;
     Value value_;
 
     auto inList() -> bool { return prev_ != LRUCacheHT::OutOfListMarker; }
   };
 
-  using ResizerType = HashTableResizer<Key, LRUNode*, Hash, KeyEqual>;
+  using ResizerType = HashTableResizer;
   LRUCacheHT();
   LRUCacheHT(size_t size);
   LRUCacheHT(const LRUCacheHT&) = delete;
   LRUCacheHT& operator=(const LRUCacheHT&) = delete;
   ~LRUCacheHT();
 
-  auto Find(const Key& key, Value& value) -> bool;
+  auto Find(const Key& key, Value& value) -> bool {
+    return Find(key, Hash()(key), value);
+  }
+  // hash 为 SegLRUCacheHT 算好的 Hash()(key)
+  auto Find(const Key& key, size_t hash, Value& value) -> bool;
 
-  auto Insert(const Key& key, const Value& value) -> bool;
+  auto Insert(const Key& key, const Value& value) -> bool {
+    return Insert(key, Hash()(key), value);
+  }
+  auto Insert(const Key& key, size_t hash, const Value& value) -> bool;
 
-  auto Remove(const Key& key) -> bool;
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
 
   auto Size() -> size_t;
   auto Clear() -> void;
@@ -75,7 +86,7 @@ class LRUCacheHT {
 
   auto remove_node(LRUNode* node) -> void;
 
-  auto remove_helper(const Key& key, LRUNode* del_node) -> bool;
+  auto remove_helper(const Key& key, size_t hash, LRUNode* del_node) -> bool;
 };
 
 template <typename Key, typename Value, typename Hash = HashFuncImpl,
@@ -83,7 +94,6 @@ template <typename Key, typename Value, typename Hash = HashFuncImpl,
 class SegLRUCacheHT {
  public:
   using ShardType = LRUCacheHT<Key, Value>;
-  using ResizerForShardsType = typename ShardType::ResizerType;
   explicit SegLRUCacheHT(size_t capacity);
   auto Find(const Key& key, Value& value) -> bool;
   auto Insert(const Key& key, const Value& value) -> bool;
@@ -102,11 +112,9 @@ class SegLRUCacheHT {
   std::atomic<size_t> hit_count_ = 0;
   std::atomic<size_t> miss_count_ = 0;
 
-  ResizerForShardsType resizer_;
 
-  static auto Shard(size_t hash) -> uint32_t {
-    return static_cast<uint32_t>(hash & (segNum - 1));
-  }
+  // 高位选分片，低位留给分片内的哈希表选桶
+  static auto Shard(size_t hash) -> uint32_t { return ShardOfHash(hash); }
 
   static auto SegHash(const Key& key) -> size_t { return Hash()(key); }
 };
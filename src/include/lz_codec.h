@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace myLru {
+
+/**
+ * @brief 与 LZ4 block 格式相近的 LZ77 压缩，用于冷数据池。
+ *
+ * 每个序列是一个 token（高 4 位字面量长度，低 4 位匹配长度 - 4，取 15 时后面
+ * 跟 255 累加的扩展字节）、字面量、2 字节小端偏移和匹配长度扩展，最后一个
+ * 序列只有字面量。压缩只用一张按 4 字节哈希的位置表，不做链式搜索，
+ * 速度优先于压缩率。
+ */
+class LZCodec {
+ public:
+  static auto Compress(const void* src, size_t size, std::string& out)
+      -> void {
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    out.clear();
+    out.reserve(size + size / 255 + 16);
+    // 小输入只初始化表的前一部分，避免每个小 value 都清 16KB
+    int bits = 4;
+    while (bits < kHashBits && (size_t(1) << bits) < size) {
+      bits++;
+    }
+    int32_t table[kHashSize];
+    std::memset(table, 0xff, sizeof(int32_t) << bits);
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + kMinMatch <= size) {
+      uint32_t seq = load32(in + pos);
+      uint32_t h = (seq * 2654435761u) >> (32 - bits);
+      int32_t cand = table[h];
+      table[h] = static_cast<int32_t>(pos);
+      if (cand < 0 || pos - cand > kMaxOffset || load32(in + cand) != seq) {
+        pos++;
+        continue;
+      }
+      size_t len = kMinMatch;
+      while (pos + len < size && in[cand + len] == in[pos + len]) {
+        len++;
+      }
+      emit(out, in + anchor, pos - anchor, pos - cand, len);
+      pos += len;
+      anchor = pos;
+    }
+    emit(out, in + anchor, size - anchor, 0, 0);
+  }
+
+  // 输出必须正好填满 dst_size 字节，格式错误或越界时返回 false
+  static auto Decompress(const void* src, size_t size, void* dst,
+                         size_t dst_size) -> bool {
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* iend = ip + size;
+    uint8_t* ostart = static_cast<uint8_t*>(dst);
+    uint8_t* op = ostart;
+    uint8_t* oend = ostart + dst_size;
+    while (ip < iend) {
+      uint8_t token = *ip++;
+      size_t lit = token >> 4;
+      if (lit == 15 && !read_length(ip, iend, lit)) {
+        return false;
+      }
+      if (lit > static_cast<size_t>(iend - ip) ||
+          lit > static_cast<size_t>(oend - op)) {
+        return false;
+      }
+      if (lit > 0) {
+        std::memcpy(op, ip, lit);
+      }
+      ip += lit;
+      op += lit;
+      if (ip == iend) {
+        break;
+      }
+      if (iend - ip < 2) {
+        return false;
+      }
+      size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+      ip += 2;
+      size_t len = token & 15;
+      if (len == 15 && !read_length(ip, iend, len)) {
+        return false;
+      }
+      len += kMinMatch;
+      if (offset == 0 || offset > static_cast<size_t>(op - ostart) ||
+          len > static_cast<size_t>(oend - op)) {
+        return false;
+      }
+      // 匹配可能和输出重叠（offset < len），只能逐字节复制
+      const uint8_t* match = op - offset;
+      for (size_t i = 0; i < len; ++i) {
+        op[i] = match[i];
+      }
+      op += len;
+    }
+    return op == oend;
+  }
+
+ private:
+  static constexpr size_t kMinMatch = 4;
+  static constexpr size_t kMaxOffset = 65535;
+  static constexpr int kHashBits = 12;
+  static constexpr size_t kHashSize = size_t(1) << kHashBits;
+
+  static auto load32(const uint8_t* p) -> uint32_t {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static auto write_length(std::string& out, size_t len) -> void {
+    while (len >= 255) {
+      out.push_back(static_cast<char>(255));
+      len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+  }
+
+  static auto read_length(const uint8_t*& ip, const uint8_t* iend,
+                          size_t& len) -> bool {
+    uint8_t b;
+    do {
+      if (ip == iend) {
+        return false;
+      }
+      b = *ip++;
+      len += b;
+    } while (b == 255);
+    return true;
+  }
+
+  // match_len 为 0 表示最后一个只有字面量的序列
+  static auto emit(std::string& out, const uint8_t* lit, size_t lit_len,
+                   size_t offset, size_t match_len) -> void {
+    size_t ml = match_len == 0 ? 0 : match_len - kMinMatch;
+    uint8_t token = static_cast<uint8_t>((lit_len < 15 ? lit_len : 15) << 4 |
+                                         (ml < 15 ? ml : 15));
+    out.push_back(static_cast<char>(token));
+    if (lit_len >= 15) {
+      write_length(out, lit_len - 15);
+    }
+    out.append(reinterpret_cast<const char*>(lit), lit_len);
+    if (match_len == 0) {
+      return;
+    }
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15) {
+      write_length(out, ml - 15);
+    }
+  }
+};
+
+}  // namespace myLru
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "shard_stats.h"
+
+namespace myLru {
+
+/**
+ * @brief 用 SHARDS 在线估计 LRU 的命中率曲线。
+ *
+ * 按 key hash 做空间抽样：hash 第 16..39 位（tag）小于阈值的 key 被跟踪，
+ * 抽样率 R = 阈值 / 2^24。每次访问被跟踪的 key 时，用树状数组按上次访问
+ * 时间数出这之后访问过的其他被跟踪 key 数，即抽样后的重用距离 d，
+ * d / R 就是完整访问流里的 LRU 栈距离，计入直方图；第一次访问算作未命中。
+ * 容量为 c 的 LRU 的命中率是栈距离小于 c 的访问所占的比例。
+ *
+ * 跟踪的 key 数不超过 max_keys（fixed-size SHARDS）：超过时去掉 tag 最大的
+ * key 并把阈值降到这个 tag，已有的直方图按新旧抽样率之比缩放。
+ * 内存只取决于 max_keys 和直方图格数，与 key 空间和访问数无关。
+ *
+ * 少数热点 key 是否被抽中会让样本访问数明显偏离 总访问数 × R，
+ * Curve 按 SHARDS_adj 把差值计入距离最小的一格。
+ *
+ * Record 对所有访问按 hash 分条计数。被抽中的访问带上时间戳先放进同一
+ * 分条的缓冲区，攒够 kBatchSamples 个时 try_lock latch_，把所有分条的
+ * 样本按时间排序后一起更新；拿不到锁就继续攒，超过 kMaxBufferedSamples
+ * 才等锁。Curve 之前同样先合并。
+ */
+class MrcEstimator {
+ public:
+  explicit MrcEstimator(size_t max_keys = kDefaultMaxKeys);
+
+  /**
+   * @brief 清空并开始估计，直方图覆盖 0 到 10 倍 base_capacity 的栈距离，
+   * 分成 kBins 格。
+   */
+  auto Start(size_t base_capacity) -> void;
+  auto Stop() -> void;
+  auto IsRunning() const -> bool {
+    return running_.load(std::memory_order_relaxed);
+  }
+
+  auto Record(uint64_t key_hash) -> void {
+    if (!running_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    refs_[key_hash & (kRefStripes - 1)].count_.fetch_add(
+        1, std::memory_order_relaxed);
+    if (tag_of(key_hash) < threshold_.load(std::memory_order_relaxed)) {
+      record(key_hash);
+    }
+  }
+
+  // 当前容量的 0.1 到 10 倍上的命中率
+  auto Curve(size_t current_capacity) -> MissRatioCurve;
+
+  static constexpr size_t kDefaultMaxKeys = 8192;
+  static constexpr size_t kBins = 1000;
+  // 曲线上的点数，0.1 到 10 倍按对数均分，包含 1 倍
+  static constexpr int kCurvePoints = 41;
+
+ private:
+  static constexpr uint32_t kTagBits = 24;
+  static constexpr size_t kTimeSlotsPerKey = 4;
+  static constexpr size_t kRefStripes = 16;
+  static constexpr size_t kBatchSamples = 64;
+  static constexpr size_t kMaxBufferedSamples = 16 * kBatchSamples;
+
+  struct alignas(64) RefCounter {
+    std::atomic<size_t> count_{0};
+  };
+
+  struct Sample {
+    uint64_t key_hash_;
+    int64_t time_ns_;
+  };
+
+  // 同一个 key 总是落在同一个分条，分条内保持访问顺序
+  struct alignas(64) SampleStripe {
+    std::mutex latch_;
+    std::vector<Sample> samples_;
+  };
+
+  static auto tag_of(uint64_t key_hash) -> uint32_t {
+    return (key_hash >> 16) & ((uint32_t(1) << kTagBits) - 1);
+  }
+
+  auto record(uint64_t key_hash) -> void;
+  // 以下在 latch_ 下调用
+  // 取出所有分条缓冲的样本，按时间先后更新直方图
+  auto merge_locked() -> void;
+  auto apply(uint64_t key_hash) -> void;
+  auto fenwick_add(size_t pos, int32_t delta) -> void;
+  auto fenwick_prefix(size_t pos) const -> size_t;
+  auto compact() -> void;
+  auto lower_threshold() -> void;
+  auto untrack(uint64_t key_hash, uint32_t time) -> void;
+
+  const size_t max_keys_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint32_t> threshold_{0};
+  // 开始以来的总访问数，按 hash 低位分条避免所有线程写同一行
+  RefCounter refs_[kRefStripes];
+  SampleStripe stripes_[kRefStripes];
+
+  std::mutex latch_;
+  // merge_locked 复用的缓冲区
+  std::vector<Sample> pending_;
+  // 直方图一格的栈距离宽度
+  double bin_width_ = 1;
+  std::vector<double> histogram_;
+  // 距离超出直方图范围和第一次访问
+  double overflow_ = 0;
+  size_t sampled_refs_ = 0;
+
+  // 被跟踪 key 的上次访问时间。时间是树状数组的下标，用完
+  // kTimeSlotsPerKey * max_keys_ 个槽位时 compact 按先后重新编号
+  std::unordered_map<uint64_t, uint32_t> last_access_;
+  std::vector<uint32_t> fenwick_;
+  uint32_t next_time_ = 0;
+  // 按 tag 排序，降低阈值时从最大的一端去掉
+  std::set<std::pair<uint32_t, uint64_t>> by_tag_;
+};
+
+}  // namespace myLru
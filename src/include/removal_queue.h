@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace myLru {
+
+// 条目离开缓存的原因
+enum class RemovalReason : uint8_t {
+  kSize,      // 容量不足被淘汰，包括 Resize 缩容和冷池超出预算
+  kExpired,   // 过期；分片目前没有 TTL，保留给按时间淘汰的策略
+  kExplicit,  // 调用 Remove
+};
+
+// 环形队列满时新记录的去向
+enum class RemovalOverflow : uint8_t {
+  kDrain,  // 暂存到溢出缓冲区并标记，由生产者释放分片 latch_ 后立即处理
+  kDrop,   // 丢弃并计数，见 Dropped
+};
+
+template <typename Key, typename Value>
+struct RemovalRecord {
+  Key key_;
+  Value value_;
+  RemovalReason reason_;
+};
+
+/**
+ * @brief 单生产者单消费者的无锁环形队列，保存分片移除的条目。
+ *
+ * 生产者是持有分片 latch_ 的线程，Push 只复制一条记录、发布一个原子下标，
+ * 不分配内存也不等待。队列满时按 RemovalOverflow 处理：默认把记录追加到
+ * 加锁的溢出缓冲区并置位 NeedsDrain，之后的记录也进溢出缓冲区，直到消费者
+ * 取走它，保证先后顺序不变；kDrop 时丢弃并计数。
+ * 消费者由调用方保证同一时刻只有一个（SegLRUCache 在 removal_latch_ 下
+ * 先 Pop 到空，再 TakeOverflow）。
+ */
+template <typename Key, typename Value>
+class RemovalQueue {
+ public:
+  using Record = RemovalRecord<Key, Value>;
+
+  // 容量向上取整到 2 的幂，只能在没有生产者和消费者时调用
+  auto Reset(size_t capacity,
+             RemovalOverflow overflow = RemovalOverflow::kDrain) -> void {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    slots_.assign(size, Record{});
+    mask_ = size - 1;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    cached_head_ = 0;
+    cached_tail_ = 0;
+    overflow_mode_ = overflow;
+    overflow_.clear();
+    overflowed_.store(false, std::memory_order_relaxed);
+  }
+
+  // 只有 kDrop 模式下丢弃记录时返回 false
+  auto Push(const Key& key, const Value& value, RemovalReason reason)
+      -> bool {
+    // 溢出缓冲区里还有记录时新记录排在它们后面
+    if (overflowed_.load(std::memory_order_relaxed)) {
+      return push_overflow(key, value, reason);
+    }
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_.size()) {
+        if (overflow_mode_ == RemovalOverflow::kDrop) {
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        return push_overflow(key, value, reason);
+      }
+    }
+    Record& slot = slots_[tail & mask_];
+    slot.key_ = key;
+    slot.value_ = value;
+    slot.reason_ = reason;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  auto Pop(Record& record) -> bool {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    record = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief 环形队列已经取空时，把溢出缓冲区整个换给 records 并清除
+   * NeedsDrain。环形队列里还有更早的记录时不取，返回 false。
+   */
+  auto TakeOverflow(std::vector<Record>& records) -> bool {
+    std::lock_guard<std::mutex> lock(overflow_latch_);
+    // 生产者在持有 overflow_latch_ 之前发布的记录这里都能看到
+    if (overflow_.empty() ||
+        head_.load(std::memory_order_relaxed) !=
+            tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    records.swap(overflow_);
+    overflow_.clear();
+    overflowed_.store(false, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 有记录在溢出缓冲区中等待，生产者释放分片 latch_ 后应当处理一次
+  auto NeedsDrain() const -> bool {
+    return overflowed_.load(std::memory_order_relaxed);
+  }
+
+  auto Capacity() const -> size_t { return slots_.size(); }
+  auto Dropped() const -> size_t {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::vector<Record> slots_;
+  size_t mask_ = 0;
+  // 生产者和消费者各自的下标放在不同的 cache line，另一方的下标只在
+  // 本地缓存的值显示队列满或空时才重新读取
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+  RemovalOverflow overflow_mode_ = RemovalOverflow::kDrain;
+  std::atomic<size_t> dropped_{0};
+  // 每次操作都可能检查 NeedsDrain，单独占一个 cache line，平时只读不写
+  alignas(64) std::atomic<bool> overflowed_{false};
+  std::mutex overflow_latch_;
+  std::vector<Record> overflow_;
+
+  auto push_overflow(const Key& key, const Value& value, RemovalReason reason)
+      -> bool {
+    std::lock_guard<std::mutex> lock(overflow_latch_);
+    overflow_.push_back(Record{key, value, reason});
+    overflowed_.store(true, std::memory_order_relaxed);
+    return true;
+  }
+};
+
+}  // namespace myLru
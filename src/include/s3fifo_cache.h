@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "hash_table_resizer.h"
+#include "hashtable_wrapper.h"
+#include "hot_key_table.h"
+#include "removal_queue.h"
+#include "seqlock_field.h"
+#include "shard_stats.h"
+namespace myLru {
+
+#define S3FIFOCACHE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define S3FIFOCACHE S3FIFOCache<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief S3-FIFO 淘汰策略：small FIFO + main FIFO + ghost FIFO。
+ *
+ * 所有节点放在预分配的节点池中，两个 FIFO 都是存放节点下标的环形缓冲区。
+ * 命中只对节点的 2-bit 频率计数做一次 relaxed store，不加锁也不移动节点；
+ * 插入和淘汰只是环形缓冲区的 push/pop，在 latch_ 下完成。
+ * ghost 队列只保存被 small 队列淘汰的 key 的指纹，用于判断是否直接进入 main。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class S3FIFOCache {
+ public:
+  enum class QueueId : uint8_t { kNone, kSmall, kMain };
+
+  struct S3FIFONode {
+    // 写节点时 version_ 为奇数，无锁的 Find 通过前后两次读取判断是否读到了
+    // 正在被复用的节点
+    std::atomic<uint32_t> version_{0};
+    std::atomic<uint8_t> freq_{0};
+    QueueId queue_ = QueueId::kNone;
+    // Remove 后节点仍留在环形缓冲区里，出队时才真正回收
+    bool removed_ = false;
+    // 无锁的 Find 与复用节点的 Insert 并发访问，见 SeqlockField
+    SeqlockField<Key> key_;
+    SeqlockField<Value> value_;
+  };
+
+  using ResizerType = HashTableResizer;
+  using RemovalQueueType = RemovalQueue<Key, Value>;
+#ifdef USE_HOT_KEY_CACHE
+  using HotKeyTableType = HotKeyTable<Key, Value, Hash, KeyEqual>;
+#endif
+
+  S3FIFOCache();
+  S3FIFOCache(size_t size);
+  S3FIFOCache(const S3FIFOCache&) = delete;
+  S3FIFOCache& operator=(const S3FIFOCache&) = delete;
+  ~S3FIFOCache();
+
+  auto Find(const Key& key, Value& value) -> bool {
+    return Find(key, Hash()(key), value);
+  }
+  // hash 为调用方算好的 Hash()(key)
+  auto Find(const Key& key, size_t hash, Value& value) -> bool;
+
+  auto Insert(const Key& key, Value value) -> bool {
+    return Insert(key, Hash()(key), value);
+  }
+  auto Insert(const Key& key, size_t hash, Value value) -> bool;
+
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
+
+  auto Size() -> size_t;
+  auto Clear() -> void;
+  auto Resize(size_t size) -> void;
+  auto IsEmpty() -> bool { return cur_size_ == 0; }
+  auto Capacity() -> size_t { return max_size_; }
+  auto IsFull() -> bool { return cur_size_ == max_size_; }
+
+  auto SetResizer(ResizerType* resizer) -> void {
+    hash_table_.SetResizer(resizer);
+  }
+
+  auto GetStats() -> ShardStats;
+  auto GetChainStats() -> ChainStats { return hash_table_.GetChainStats(); }
+  // 导出顺序：先 small 再 main，各自按出队顺序，跳过已 Remove 的节点
+  auto ExportEntries(std::vector<std::pair<Key, Value>>& entries) -> void;
+  // S3-FIFO 本身就维护 ghost 队列，这里什么也不做
+  auto SetGhostTracking(bool /*enable*/) -> void {}
+  // 设置后被淘汰和 Remove 的条目在 latch_ 下写入 queue，nullptr 表示关闭
+  auto SetRemovalQueue(RemovalQueueType* queue) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    removal_queue_ = queue;
+  }
+#ifdef USE_HOT_KEY_CACHE
+  // 设置后因容量被淘汰的 key 在 latch_ 下让 hot_keys 中的副本失效
+  auto SetHotKeyTable(HotKeyTableType* hot_keys) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    hot_keys_ = hot_keys;
+  }
+#endif
+
+ private:
+  // 固定容量的下标环形缓冲区
+  struct RingQueue {
+    std::vector<uint32_t> slots_;
+    size_t head_ = 0;  // 下一个出队位置
+    size_t size_ = 0;
+
+    auto Reset(size_t capacity) -> void {
+      slots_.assign(capacity, 0);
+      head_ = 0;
+      size_ = 0;
+    }
+    auto Push(uint32_t idx) -> void {
+      slots_[(head_ + size_) % slots_.size()] = idx;
+      size_++;
+    }
+    auto Pop() -> uint32_t {
+      uint32_t idx = slots_[head_];
+      head_ = (head_ + 1) % slots_.size();
+      size_--;
+      return idx;
+    }
+    auto Empty() const -> bool { return size_ == 0; }
+    auto Size() const -> size_t { return size_; }
+  };
+
+  // small 队列占总容量的比例
+  static constexpr size_t kSmallRatioPercent = 10;
+  static constexpr uint8_t kMaxFreq = 3;
+
+  HashTableWrapper<Key, S3FIFONode*, Hash, KeyEqual> hash_table_;
+  std::mutex latch_;
+  size_t max_size_;
+  size_t cur_size_;
+
+  // deque 保证扩容时已有节点地址不变
+  std::deque<S3FIFONode> nodes_;
+  std::vector<uint32_t> free_list_;
+  RingQueue small_;
+  RingQueue main_;
+
+  // ghost 队列只保存被 small 队列淘汰的 key 的指纹
+  GhostQueue ghost_;
+  size_t evictions_ = 0;
+  size_t ghost_hits_ = 0;
+  RemovalQueueType* removal_queue_ = nullptr;
+#ifdef USE_HOT_KEY_CACHE
+  HotKeyTableType* hot_keys_ = nullptr;
+#endif
+
+  Hash hash_function_;
+
+  auto evict() -> void;
+  auto evict_small() -> void;
+  auto evict_main() -> void;
+
+  auto grow_pool(size_t size) -> void;
+  auto release_node(uint32_t idx) -> void;
+  // hash 为 Hash()(key)，key 是节点当前的 key，由调用方读出一次
+  auto evict_node(uint32_t idx, const Key& key, size_t hash) -> void;
+
+  auto ghost_capacity() const -> size_t;
+
+  auto small_capacity() const -> size_t {
+    size_t cap = max_size_ * kSmallRatioPercent / 100;
+    return cap == 0 ? 1 : cap;
+  }
+};
+
+}  // namespace myLru
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "hash_table_resizer.h"
+#include "hashtable_wrapper.h"
+#include "hot_key_table.h"
+#include "removal_queue.h"
+#include "seqlock_field.h"
+#include "shard_stats.h"
+namespace myLru {
+
+#define SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define SAMPLEDLRUCACHE SampledLRUCache<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief Redis 风格的近似 LRU：没有链表，每个节点只保存一个访问时间。
+ *
+ * 时间戳来自一个 32 位的逻辑时钟，每次 Insert 加一，精度恰好是“一次淘汰”。
+ * 时钟会回绕，比较新旧时只看 now - access_time_ 的无符号差值，未访问时间
+ * 不超过 2^32 次插入的节点顺序都是准确的。节点头部只有时间戳和 version_
+ * 共 8 字节，是 LRUNode 的 next_/prev_ 的一半，占用标记折叠在 version_ 中。
+ * Find 只对命中节点做一次 relaxed store，不加锁。evict() 从节点池中随机抽取
+ * kSampleSize 个已占用的节点，与跨调用保留的淘汰候选池合并后淘汰最旧的一个。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class SampledLRUCache {
+ public:
+  struct SampledNode {
+    std::atomic<uint32_t> access_time_{0};
+    // 与 S3FIFOCache 相同，无锁的 Find 用 version_ 识别被复用的节点：
+    // 最低位 kWriting 表示正在写，kOccupied 表示节点在用，计数从 bit 2 开始
+    std::atomic<uint32_t> version_{0};
+    // 无锁的 Find 与复用节点的 Insert 并发访问，见 SeqlockField
+    SeqlockField<Key> key_;
+    SeqlockField<Value> value_;
+  };
+
+  using ResizerType = HashTableResizer;
+  using RemovalQueueType = RemovalQueue<Key, Value>;
+#ifdef USE_HOT_KEY_CACHE
+  using HotKeyTableType = HotKeyTable<Key, Value, Hash, KeyEqual>;
+#endif
+
+  SampledLRUCache();
+  SampledLRUCache(size_t size);
+  SampledLRUCache(const SampledLRUCache&) = delete;
+  SampledLRUCache& operator=(const SampledLRUCache&) = delete;
+  ~SampledLRUCache();
+
+  auto Find(const Key& key, Value& value) -> bool {
+    return Find(key, Hash()(key), value);
+  }
+  // hash 为调用方算好的 Hash()(key)
+  auto Find(const Key& key, size_t hash, Value& value) -> bool;
+
+  auto Insert(const Key& key, Value value) -> bool {
+    return Insert(key, Hash()(key), value);
+  }
+  auto Insert(const Key& key, size_t hash, Value value) -> bool;
+
+  auto Remove(const Key& key) -> bool { return Remove(key, Hash()(key)); }
+  auto Remove(const Key& key, size_t hash) -> bool;
+
+  auto Size() -> size_t;
+  auto Clear() -> void;
+  auto Resize(size_t size) -> void;
+  auto IsEmpty() -> bool { return cur_size_ == 0; }
+  auto Capacity() -> size_t { return max_size_; }
+  auto IsFull() -> bool { return cur_size_ == max_size_; }
+
+  auto SetResizer(ResizerType* resizer) -> void {
+    hash_table_.SetResizer(resizer);
+  }
+
+  auto GetStats() -> ShardStats;
+  auto GetChainStats() -> ChainStats { return hash_table_.GetChainStats(); }
+  // 导出顺序：按 access_time_ 从旧到新
+  auto ExportEntries(std::vector<std::pair<Key, Value>>& entries) -> void;
+  /**
+   * @brief 打开后被淘汰的 key 会记入与分片容量相同的 ghost 队列，
+   * 用于统计 ghost_hits_。默认关闭。
+   */
+  auto SetGhostTracking(bool enable) -> void;
+  // 设置后被淘汰和 Remove 的条目在 latch_ 下写入 queue，nullptr 表示关闭
+  auto SetRemovalQueue(RemovalQueueType* queue) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    removal_queue_ = queue;
+  }
+#ifdef USE_HOT_KEY_CACHE
+  // 设置后因容量被淘汰的 key 在 latch_ 下让 hot_keys 中的副本失效
+  auto SetHotKeyTable(HotKeyTableType* hot_keys) -> void {
+    std::lock_guard<std::mutex> lock(latch_);
+    hot_keys_ = hot_keys;
+  }
+#endif
+
+ private:
+  struct PoolEntry {
+    SampledNode* node_;
+    uint32_t access_time_;
+    Key key_;
+  };
+
+  static constexpr uint32_t kWriting = 1;
+  static constexpr uint32_t kOccupied = 2;
+  static constexpr uint32_t kVersionStep = 4;
+
+  // 每次淘汰抽样的节点数，与 Redis maxmemory-samples 的默认值一致
+  static constexpr size_t kSampleSize = 5;
+  // 跨调用保留的候选节点数
+  static constexpr size_t kEvictionPoolSize = 16;
+
+  HashTableWrapper<Key, SampledNode*, Hash, KeyEqual> hash_table_;
+  std::mutex latch_;
+  size_t max_size_;
+  size_t cur_size_;
+
+  GhostQueue ghost_;
+  bool ghost_tracking_ = false;
+  size_t evictions_ = 0;
+  size_t ghost_hits_ = 0;
+  RemovalQueueType* removal_queue_ = nullptr;
+#ifdef USE_HOT_KEY_CACHE
+  HotKeyTableType* hot_keys_ = nullptr;
+#endif
+  std::atomic<uint32_t> clock_{0};
+  uint64_t rng_state_ = COMMON_BASE_SEED;
+
+  std::deque<SampledNode> nodes_;
+  std::vector<SampledNode*> free_list_;
+  // 按 access_time_ 从旧到新排列，新旧由 older() 判断
+  std::vector<PoolEntry> eviction_pool_;
+
+  auto evict() -> void;
+  // 在当前时钟下 a 是否比 b 更久没有被访问，时钟回绕后仍然成立
+  auto older(uint32_t a, uint32_t b) const -> bool {
+    uint32_t now = clock_.load(std::memory_order_relaxed);
+    return now - a > now - b;
+  }
+  static auto occupied(const SampledNode& node) -> bool {
+    return node.version_.load(std::memory_order_relaxed) & kOccupied;
+  }
+  auto sample_into_pool() -> void;
+  // hash 为 Hash()(节点的 key)
+  auto evict_node(SampledNode* node, size_t hash) -> void;
+  auto grow_pool(size_t size) -> void;
+  auto next_random() -> uint64_t;
+};
+
+}  // namespace myLru
@@ -18,7 +18,7 @@ template <typename Key, typename Value, typename HashFunc = HashFuncImpl,
 class SegHashTable {
  public:
   using HashTableResizerType =
-      HashTableResizer<Key, Value, HashFunc, KeyEqualFunc>;
+      HashTableResizer;
 
   SegHashTable() : length_(4096), list_(4096), bucket_locks_(4096) {
     // current_list_.store(&list_);
@@ -31,7 +31,12 @@ class SegHashTable {
   }
 
   bool Insert(const Key& key, Value value_to_insert) {
-    size_t bucket_idx = GetBucketIndex(key);
+    return Insert(key, HashFunc()(key), value_to_insert);
+  }
+
+  // 带 hash 的版本使用调用方已经算好的 HashFunc()(key)
+  bool Insert(const Key& key, size_t hash, Value value_to_insert) {
+    size_t bucket_idx = hash & (length_ - 1);
     std::unique_lock<std::mutex> lock(bucket_locks_[bucket_idx]);
     // auto* current_list = current_list_.load();
     auto& chain = list_[bucket_idx];
@@ -48,7 +53,11 @@ class SegHashTable {
   }
 
   bool Get(const Key& key, Value& value_out) {
-    size_t bucket_idx = GetBucketIndex(key);
+    return Get(key, HashFunc()(key), value_out);
+  }
+
+  bool Get(const Key& key, size_t hash, Value& value_out) {
+    size_t bucket_idx = hash & (length_ - 1);
     std::lock_guard<std::mutex> lock(bucket_locks_[bucket_idx]);
     // auto* current_list = current_list_.load();
     auto& chain = list_[bucket_idx];
@@ -62,7 +71,11 @@ class SegHashTable {
   }
 
   bool Remove(const Key& key) {
-    size_t bucket_idx = GetBucketIndex(key);
+    return Remove(key, HashFunc()(key));
+  }
+
+  bool Remove(const Key& key, size_t hash) {
+    size_t bucket_idx = hash & (length_ - 1);
     std::lock_guard<std::mutex> lock(bucket_locks_[bucket_idx]);
     // auto* current_list = current_list_.load();
     auto& chain = list_[bucket_idx];
@@ -76,8 +89,39 @@ class SegHashTable {
     return false;
   }
 
+  // 每个桶有自己的锁，逐个删除
+  size_t RemoveBatch(const std::vector<Key>& keys) {
+    size_t removed = 0;
+    for (const Key& key : keys) {
+      if (Remove(key)) {
+        removed++;
+      }
+    }
+    return removed;
+  }
+
+  size_t RemoveBatch(const std::vector<Key>& keys,
+                     const std::vector<size_t>& hashes) {
+    size_t removed = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (Remove(keys[i], hashes[i])) {
+        removed++;
+      }
+    }
+    return removed;
+  }
+
   size_t Size() const { return elems_.load(); }
 
+  ChainStats GetChainStats() {
+    ChainStats stats;
+    for (size_t i = 0; i < length_; ++i) {
+      std::lock_guard<std::mutex> lock(bucket_locks_[i]);
+      stats.Record(list_[i].size());
+    }
+    return stats;
+  }
+
   void Clear() {
     for (auto& chain : list_) {
       chain.clear();
@@ -122,10 +166,6 @@ class SegHashTable {
   size_t length_;
   std::atomic<size_t> elems_{0};
   HashTableResizerType* resizer_ = nullptr;
-
-  size_t GetBucketIndex(const Key& key) {
-    return HashFuncImpl()(key) & (length_ - 1);
-  }
 };
 
 }  // namespace myLru
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace myLru {
+
+/**
+ * @brief seqlock 保护的字段，读者不持锁时也可以与写者并发访问。
+ *
+ * 值按 64 位字拆开，每个字用 relaxed atomic 读写，并发读写不构成数据竞争；
+ * 读到的值可能是新旧混合的，由调用方用前后两次读取的版本号判断是否丢弃。
+ * 持锁的一方同样通过 Load/Store 访问。T 必须可平凡复制。
+ */
+template <typename T>
+class SeqlockField {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqlockField requires a trivially copyable type");
+
+ public:
+  SeqlockField() { Store(T{}); }
+  SeqlockField(const SeqlockField&) = delete;
+  SeqlockField& operator=(const SeqlockField&) = delete;
+
+  auto Load() const -> T {
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+      words[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  auto Store(const T& value) -> void {
+    uint64_t words[kWords] = {0};
+    std::memcpy(words, &value, sizeof(T));
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+  std::atomic<uint64_t> words_[kWords];
+};
+
+}  // namespace myLru
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace myLru {
+
+/**
+ * @brief 单个分片的统计信息，计数器从分片创建起累计，不随 Clear 清零。
+ */
+struct ShardStats {
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  // 因容量不足被淘汰的节点数，不包括 Remove
+  size_t evictions_ = 0;
+  // 插入的 key 最近刚被本分片淘汰过的次数，分片更大时这些插入本来会是命中
+  size_t ghost_hits_ = 0;
+  // USE_COLD_TIER 下冷池的条目数、按预算口径计算的字节数和命中数
+  size_t cold_size_ = 0;
+  size_t cold_bytes_ = 0;
+  size_t cold_hits_ = 0;
+  // USE_BACKGROUND_EVICTION 下由后台线程完成的淘汰数，已包含在 evictions_ 中
+  size_t background_evictions_ = 0;
+
+  auto operator+=(const ShardStats& other) -> ShardStats& {
+    capacity_ += other.capacity_;
+    size_ += other.size_;
+    evictions_ += other.evictions_;
+    ghost_hits_ += other.ghost_hits_;
+    cold_size_ += other.cold_size_;
+    cold_bytes_ += other.cold_bytes_;
+    cold_hits_ += other.cold_hits_;
+    background_evictions_ += other.background_evictions_;
+    return *this;
+  }
+};
+
+/**
+ * @brief 分片哈希表的链长分布。histogram_[i] 是长度为 i 的桶数，最后一格
+ * 包含所有更长的链。只有 MyHashTable 和 SegHashTable 统计，libcuckoo 下全为 0。
+ */
+struct ChainStats {
+  static constexpr size_t kMaxLength = 8;
+
+  size_t buckets_ = 0;
+  size_t elements_ = 0;
+  size_t max_length_ = 0;
+  size_t histogram_[kMaxLength + 1] = {0};
+
+  auto Record(size_t length) -> void {
+    buckets_++;
+    elements_ += length;
+    max_length_ = length > max_length_ ? length : max_length_;
+    histogram_[length < kMaxLength ? length : kMaxLength]++;
+  }
+
+  auto UsedBuckets() const -> size_t { return buckets_ - histogram_[0]; }
+
+  auto operator+=(const ChainStats& other) -> ChainStats& {
+    buckets_ += other.buckets_;
+    elements_ += other.elements_;
+    max_length_ =
+        other.max_length_ > max_length_ ? other.max_length_ : max_length_;
+    for (size_t i = 0; i <= kMaxLength; ++i) {
+      histogram_[i] += other.histogram_[i];
+    }
+    return *this;
+  }
+};
+
+/**
+ * @brief 估计出的命中率曲线：缓存总容量为 capacity_ 时 Find 的命中率。
+ * 点按容量从小到大排列，覆盖当前容量的 0.1 到 10 倍（对数间隔）。
+ */
+struct MissRatioCurve {
+  struct Point {
+    size_t capacity_;
+    double hit_ratio_;
+  };
+  std::vector<Point> points_;
+  // 当前的抽样率和计入曲线的抽样访问数
+  double sample_rate_ = 0;
+  size_t sampled_refs_ = 0;
+
+  // 相邻两点之间线性插值，超出范围时取端点
+  auto HitRatioAt(size_t capacity) const -> double {
+    if (points_.empty()) {
+      return 0;
+    }
+    if (capacity <= points_.front().capacity_) {
+      return points_.front().hit_ratio_;
+    }
+    for (size_t i = 1; i < points_.size(); ++i) {
+      const Point& hi = points_[i];
+      if (capacity <= hi.capacity_) {
+        const Point& lo = points_[i - 1];
+        double t = static_cast<double>(capacity - lo.capacity_) /
+                   (hi.capacity_ - lo.capacity_);
+        return lo.hit_ratio_ + t * (hi.hit_ratio_ - lo.hit_ratio_);
+      }
+    }
+    return points_.back().hit_ratio_;
+  }
+};
+
+/**
+ * @brief 只保存被淘汰 key 指纹的 FIFO，容量为 0 时不记录任何东西。
+ * 不是线程安全的，由分片在自己的 latch_ 下使用。
+ */
+class GhostQueue {
+ public:
+  auto Capacity() const -> size_t { return ring_.size(); }
+
+  // 调整容量，保留最新的指纹
+  auto Reset(size_t capacity) -> void {
+    std::vector<size_t> old_ring;
+    old_ring.reserve(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      old_ring.push_back(ring_[(head_ + i) % ring_.size()]);
+    }
+    ring_.assign(capacity, 0);
+    head_ = 0;
+    size_ = 0;
+    index_.clear();
+    size_t skip = old_ring.size() > capacity ? old_ring.size() - capacity : 0;
+    for (size_t i = skip; i < old_ring.size(); ++i) {
+      Push(old_ring[i]);
+    }
+  }
+
+  auto Clear() -> void {
+    head_ = 0;
+    size_ = 0;
+    index_.clear();
+  }
+
+  auto Push(size_t fingerprint) -> void {
+    if (ring_.empty()) {
+      return;
+    }
+    if (size_ == ring_.size()) {
+      auto it = index_.find(ring_[head_]);
+      if (it != index_.end() && --it->second == 0) {
+        index_.erase(it);
+      }
+      head_ = (head_ + 1) % ring_.size();
+      size_--;
+    }
+    ring_[(head_ + size_) % ring_.size()] = fingerprint;
+    size_++;
+    index_[fingerprint]++;
+  }
+
+  auto Contains(size_t fingerprint) const -> bool {
+    return index_.find(fingerprint) != index_.end();
+  }
+
+ private:
+  std::vector<size_t> ring_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  std::unordered_map<size_t, uint32_t> index_;
+};
+
+}  // namespace myLru
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "config.h"
+namespace myLru {
+
+#define SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS \
+  template <typename Key, typename Value, typename Hash, typename KeyEqual>
+
+#define SHMSEGLRUCACHE ShmSegLRUCache<Key, Value, Hash, KeyEqual>
+
+/**
+ * @brief 放在具名 POSIX 共享内存里的分段 LRU，同一台机器上的多个进程共用
+ * 一份缓存。
+ *
+ * 段内不能存放指针，链表和哈希链都用分片内的 uint32_t 下标，节点池、
+ * 哈希桶和分片元数据在创建时一次性布置在段里。每个分片的 latch_ 是
+ * PTHREAD_PROCESS_SHARED + PTHREAD_MUTEX_ROBUST 的互斥锁，持锁进程崩溃后
+ * 下一个加锁的进程会拿到 EOWNERDEAD，此时分片可能只改了一半，直接清空重建。
+ *
+ * 第一个进程用 O_EXCL 创建并初始化段，其余进程等待 ready_ 后校验布局再使用。
+ * Key 和 Value 必须可以按字节复制。
+ */
+template <typename Key, typename Value, typename Hash = HashFuncImpl,
+          typename KeyEqual = std::equal_to<Key>>
+class ShmSegLRUCache {
+ public:
+  /**
+   * @brief 打开或创建名为 name（如 "/mylru"）的段。段已存在时
+   * capacity_per_seg 必须与创建者一致，否则抛出 std::runtime_error。
+   */
+  ShmSegLRUCache(const std::string& name, size_t capacity_per_seg);
+  ShmSegLRUCache(const ShmSegLRUCache&) = delete;
+  ShmSegLRUCache& operator=(const ShmSegLRUCache&) = delete;
+  // 只解除映射，段本身要用 Unlink 删除
+  ~ShmSegLRUCache();
+
+  auto Find(const Key& key, Value& value) -> bool;
+  auto Insert(const Key& key, Value value) -> bool;
+  auto Remove(const Key& key) -> bool;
+  auto Size() -> size_t;
+  auto Clear() -> void;
+  auto Capacity() -> size_t { return capacity_per_seg_ * segNum; }
+  auto IsEmpty() -> bool { return Size() == 0; }
+  auto IsFull() -> bool { return Size() == Capacity(); }
+
+  static auto Unlink(const std::string& name) -> bool;
+
+ private:
+  // 分片改为取 hash 高位后，旧版本写入的段里 key 所在的分片对不上，
+  // 版本号随之加一，attach 旧段会失败。节点增加 hash_ 后再加一
+  static constexpr uint64_t kMagic = 0x4d594c5255534d33ULL;  // "MYLRUSM3"
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  struct alignas(64) ShmHeader {
+    uint64_t magic_;
+    std::atomic<uint32_t> ready_;
+    uint32_t num_shards_;
+    uint32_t key_size_;
+    uint32_t value_size_;
+    uint64_t capacity_per_seg_;
+    uint64_t num_buckets_;
+    uint64_t shard_stride_;
+  };
+
+  struct alignas(64) ShmShard {
+    pthread_mutex_t latch_;
+    // 哨兵节点的下标分别是 capacity 和 capacity + 1
+    uint32_t head_;
+    uint32_t tail_;
+    uint32_t free_head_;
+    uint64_t size_;
+  };
+
+  struct ShmNode {
+    uint32_t next_;
+    uint32_t prev_;
+    uint32_t hash_next_;
+    // Hash()(key_) 的低 32 位，淘汰时据此找到桶，不再重新计算。
+    // 节点下标是 32 位的，桶数也不超过 2^32；放在 key_ 之前的填充里
+    uint32_t hash_;
+    Key key_;
+    Value value_;
+  };
+
+  std::string name_;
+  size_t capacity_per_seg_;
+  size_t num_buckets_;
+  size_t shard_stride_;
+  size_t mapped_size_ = 0;
+  char* base_ = nullptr;
+
+  auto header() -> ShmHeader* { return reinterpret_cast<ShmHeader*>(base_); }
+  auto shard(size_t idx) -> ShmShard*;
+  auto buckets(size_t idx) -> uint32_t*;
+  auto nodes(size_t idx) -> ShmNode*;
+
+  auto create(int fd) -> void;
+  auto attach(int fd) -> void;
+  auto init_shard(size_t idx) -> void;
+  auto lock_shard(size_t idx) -> void;
+  auto unlock_shard(size_t idx) -> void;
+
+  // 以下函数都在分片锁内调用
+  auto lookup(size_t idx, const Key& key, size_t hash) -> uint32_t;
+  auto unlink_hash(size_t idx, uint32_t node_idx, size_t hash) -> void;
+  auto remove_node(ShmNode* pool, uint32_t node_idx) -> void;
+  auto push_node(size_t idx, ShmNode* pool, uint32_t node_idx) -> void;
+  auto free_node(size_t idx, uint32_t node_idx) -> void;
+};
+
+}  // namespace myLru
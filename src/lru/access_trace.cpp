@@ -0,0 +1,273 @@
+#include "access_trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace myLru {
+
+namespace {
+
+std::atomic<uint64_t> next_tracer_id{1};
+
+auto steady_ns() -> int64_t {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+// 单生产者单消费者的环形队列，与 RemovalQueue 相同的下标缓存方式
+class AccessTracer::Ring {
+ public:
+  Ring() : slots_(kRingCapacity) {}
+
+  auto Push(const AccessRecord& record) -> void {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == kRingCapacity) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == kRingCapacity) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    slots_[tail & (kRingCapacity - 1)] = record;
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  // 把队列里的记录追加到 out，返回条数
+  auto PopAll(std::vector<AccessRecord>& out) -> size_t {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    for (size_t i = head; i < tail; ++i) {
+      out.push_back(slots_[i & (kRingCapacity - 1)]);
+    }
+    head_.store(tail, std::memory_order_release);
+    return tail - head;
+  }
+
+  auto Dropped() const -> size_t {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  auto ResetDropped() -> void { dropped_.store(0, std::memory_order_relaxed); }
+
+  // 生产者线程退出时调用，之后不会再有 Push
+  auto Retire() -> void { retired_.store(true, std::memory_order_release); }
+  auto Retired() const -> bool {
+    return retired_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::vector<AccessRecord> slots_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+  std::atomic<size_t> dropped_{0};
+  std::atomic<bool> retired_{false};
+};
+
+// 线程在各个记录器里注册的队列，线程退出时析构，把它们全部标记为退役
+struct AccessTracer::ThreadRings {
+  ~ThreadRings() {
+    for (auto& entry : rings_) {
+      entry.second->Retire();
+    }
+  }
+
+  // 最近一次使用的记录器和它在其中的队列
+  uint64_t last_id_ = 0;
+  Ring* last_ring_ = nullptr;
+  std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings_;
+};
+
+static_assert((AccessTracer::kRingCapacity &
+               (AccessTracer::kRingCapacity - 1)) == 0,
+              "ring capacity must be a power of two");
+static_assert(sizeof(AccessRecord) == 16, "AccessRecord must stay packed");
+
+AccessTracer::AccessTracer() : id_(next_tracer_id.fetch_add(1)) {}
+
+AccessTracer::~AccessTracer() { Stop(); }
+
+auto AccessTracer::Start(const std::string& path, uint32_t sample_rate,
+                         uint32_t num_shards,
+                         std::chrono::milliseconds flush_interval) -> bool {
+  Stop();
+  if (sample_rate == 0) {
+    return false;
+  }
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  // 上一次停止后才写进队列的记录不属于这次
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(rings_latch_);
+    for (auto& ring : rings_) {
+      ring->ResetDropped();
+    }
+    retired_dropped_ = 0;
+  }
+
+  AccessTraceHeader header{};
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kVersion;
+  header.record_size_ = sizeof(AccessRecord);
+  header.sample_rate_ = sample_rate;
+  header.num_shards_ = num_shards;
+  header.start_unix_ns_ =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+    std::fclose(file);
+    return false;
+  }
+  file_ = file;
+  written_.store(0, std::memory_order_relaxed);
+  threshold_.store((uint64_t(1) << 32) / sample_rate,
+                   std::memory_order_relaxed);
+  start_ns_.store(steady_ns(), std::memory_order_relaxed);
+  tracing_.store(true, std::memory_order_release);
+
+  flusher_stop_ = false;
+  flusher_ = std::thread([this, flush_interval] {
+    std::unique_lock<std::mutex> lock(flusher_latch_);
+    while (!flusher_stop_) {
+      flusher_cv_.wait_for(lock, flush_interval);
+      lock.unlock();
+      drain();
+      lock.lock();
+    }
+  });
+  return true;
+}
+
+auto AccessTracer::Stop() -> void {
+  tracing_.store(false, std::memory_order_relaxed);
+  if (flusher_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(flusher_latch_);
+      flusher_stop_ = true;
+    }
+    flusher_cv_.notify_one();
+    flusher_.join();
+  }
+  if (file_ != nullptr) {
+    drain();
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+auto AccessTracer::Dropped() const -> size_t {
+  std::lock_guard<std::mutex> lock(rings_latch_);
+  size_t dropped = retired_dropped_;
+  for (const auto& ring : rings_) {
+    dropped += ring->Dropped();
+  }
+  return dropped;
+}
+
+auto AccessTracer::Rings() const -> size_t {
+  std::lock_guard<std::mutex> lock(rings_latch_);
+  return rings_.size();
+}
+
+auto AccessTracer::record(AccessOp op, uint64_t key_hash, uint32_t shard,
+                          bool hit) -> void {
+  Ring* ring = ring_for_this_thread();
+  int64_t elapsed_ns =
+      steady_ns() - start_ns_.load(std::memory_order_relaxed);
+  ring->Push(AccessRecord::Make(static_cast<uint64_t>(elapsed_ns) / 1000, op,
+                                key_hash, shard, hit));
+}
+
+auto AccessTracer::thread_rings() -> ThreadRings& {
+  thread_local ThreadRings rings;
+  return rings;
+}
+
+auto AccessTracer::ring_for_this_thread() -> Ring* {
+  ThreadRings& local = thread_rings();
+  if (local.last_id_ == id_) {
+    return local.last_ring_;
+  }
+  // 第一次记录，或者这个线程上一次用的是另一个记录器
+  Ring* ring = nullptr;
+  for (auto& entry : local.rings_) {
+    if (entry.first == id_) {
+      ring = entry.second.get();
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    // 只剩这个线程持有的队列属于已析构的记录器，顺便清掉
+    local.rings_.erase(
+        std::remove_if(local.rings_.begin(), local.rings_.end(),
+                       [](const std::pair<uint64_t, std::shared_ptr<Ring>>&
+                              entry) { return entry.second.use_count() == 1; }),
+        local.rings_.end());
+    auto created = std::make_shared<Ring>();
+    {
+      std::lock_guard<std::mutex> lock(rings_latch_);
+      rings_.push_back(created);
+    }
+    local.rings_.emplace_back(id_, created);
+    ring = created.get();
+  }
+  local.last_id_ = id_;
+  local.last_ring_ = ring;
+  return ring;
+}
+
+auto AccessTracer::drain() -> void {
+  std::vector<AccessRecord> batch;
+  std::lock_guard<std::mutex> lock(rings_latch_);
+  for (auto it = rings_.begin(); it != rings_.end();) {
+    Ring& ring = **it;
+    // 先看退役标记再取记录，看到标记时线程最后写入的记录也一定可见
+    bool retired = ring.Retired();
+    batch.clear();
+    size_t count = ring.PopAll(batch);
+    if (count > 0 && file_ != nullptr) {
+      size_t done = std::fwrite(batch.data(), sizeof(AccessRecord), count,
+                                file_);
+      written_.fetch_add(done, std::memory_order_relaxed);
+    }
+    if (retired) {
+      retired_dropped_ += ring.Dropped();
+      it = rings_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (file_ != nullptr) {
+    std::fflush(file_);
+  }
+}
+
+auto ReadAccessTrace(const std::string& path, AccessTraceHeader& header,
+                     std::vector<AccessRecord>& records) -> bool {
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+            std::memcmp(header.magic_, AccessTracer::kMagic,
+                        sizeof(header.magic_)) == 0 &&
+            header.version_ == AccessTracer::kVersion &&
+            header.record_size_ == sizeof(AccessRecord);
+  records.clear();
+  AccessRecord buffer[1024];
+  size_t count;
+  while (ok &&
+         (count = std::fread(buffer, sizeof(AccessRecord), 1024, file)) > 0) {
+    records.insert(records.end(), buffer, buffer + count);
+  }
+  std::fclose(file);
+  return ok;
+}
+
+}  // namespace myLru
@@ -0,0 +1,597 @@
+#include "flash_tier.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+namespace myLru {
+
+static auto pwrite_all(int fd, const void* data, size_t size, off_t offset)
+    -> bool {
+  const char* cur = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = pwrite(fd, cur, size, offset);
+    if (written <= 0) {
+      return false;
+    }
+    cur += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+#ifdef USE_IO_URING
+/**
+ * @brief 批量读写的最小 io_uring 封装，直接使用系统调用，不依赖 liburing。
+ * 不是线程安全的，同一时间只能有一个线程使用。
+ */
+FLASHTIER_TEMPLATE_ARGUMENTS
+struct FLASHTIER::IoRing {
+  int fd_ = -1;
+  void* sq_ptr_ = MAP_FAILED;
+  size_t sq_len_ = 0;
+  void* cq_ptr_ = MAP_FAILED;
+  size_t cq_len_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_len_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  ~IoRing() {
+    if (sqes_ != nullptr) {
+      munmap(sqes_, sqes_len_);
+    }
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+      munmap(cq_ptr_, cq_len_);
+    }
+    if (sq_ptr_ != MAP_FAILED) {
+      munmap(sq_ptr_, sq_len_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  auto Init(unsigned entries) -> bool {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      return false;
+    }
+    sq_len_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_len_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+    }
+    sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) {
+      return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      cq_ptr_ = sq_ptr_;
+    } else {
+      cq_ptr_ = mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ptr_ == MAP_FAILED) {
+        return false;
+      }
+    }
+    sqes_len_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+    char* sq = static_cast<char*>(sq_ptr_);
+    char* cq = static_cast<char*>(cq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  /**
+   * @brief 填好 count 个 sqe 后一次 io_uring_enter 提交，并等待全部完成。
+   * fill(i, sqe) 填写第 i 个请求，complete(user_data, res) 处理每个完成事件。
+   * count 不能超过 Init 时的 entries。系统调用失败时返回 false。
+   *
+   * 内核已经接收的请求全部完成之后才返回，失败时也一样：否则内核可能还在
+   * 读写调用方的 buffer。没有被接收的 sqe 从提交队列中撤回。
+   */
+  template <typename Fill, typename Complete>
+  auto Run(unsigned count, Fill&& fill, Complete&& complete) -> bool {
+    unsigned tail = __atomic_load_n(sq_tail_, __ATOMIC_ACQUIRE);
+    for (unsigned i = 0; i < count; ++i) {
+      unsigned idx = tail & *sq_mask_;
+      io_uring_sqe* sqe = &sqes_[idx];
+      std::memset(sqe, 0, sizeof(*sqe));
+      fill(i, sqe);
+      sq_array_[idx] = idx;
+      tail++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    bool ok = true;
+    unsigned to_submit = count;
+    // 需要等到的完成事件数，提交失败后只等已经被接收的请求
+    unsigned target = count;
+    unsigned completed = 0;
+    while (completed < target) {
+      int rc = static_cast<int>(
+          syscall(__NR_io_uring_enter, fd_, to_submit, target - completed,
+                  IORING_ENTER_GETEVENTS, nullptr, 0));
+      if (rc < 0 && errno != EINTR && to_submit > 0) {
+        ok = false;
+        tail -= to_submit;
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        target -= to_submit;
+        to_submit = 0;
+      } else if (rc > 0) {
+        to_submit -= std::min<unsigned>(to_submit, rc);
+      }
+      unsigned head = __atomic_load_n(cq_head_, __ATOMIC_ACQUIRE);
+      while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        complete(cqe.user_data, cqe.res);
+        head++;
+        completed++;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    return ok;
+  }
+
+  // 一次提交所有 region，有一个失败或没写满就返回 false
+  auto WriteBatch(int file_fd, const std::vector<Region*>& regions,
+                  size_t num_regions) -> bool {
+    bool ok = true;
+    bool submitted = Run(
+        static_cast<unsigned>(regions.size()),
+        [&](unsigned i, io_uring_sqe* sqe) {
+          const Region* region = regions[i];
+          size_t bytes = region->records_.size() * sizeof(Record);
+          sqe->opcode = IORING_OP_WRITE;
+          sqe->fd = file_fd;
+          sqe->addr = reinterpret_cast<uint64_t>(region->records_.data());
+          sqe->len = static_cast<uint32_t>(bytes);
+          sqe->off = (region->id_ % num_regions) * kRegionSize;
+          sqe->user_data = bytes;
+        },
+        [&](uint64_t bytes, int res) {
+          if (res < 0 || static_cast<uint64_t>(res) != bytes) {
+            ok = false;
+          }
+        });
+    return submitted && ok;
+  }
+
+  // 一次提交 count 条记录的读取，ok[i] 表示第 i 条完整读到
+  auto ReadBatch(int file_fd, const off_t* positions, Record* records,
+                 bool* ok, unsigned count) -> bool {
+    return Run(
+        count,
+        [&](unsigned i, io_uring_sqe* sqe) {
+          sqe->opcode = IORING_OP_READ;
+          sqe->fd = file_fd;
+          sqe->addr = reinterpret_cast<uint64_t>(&records[i]);
+          sqe->len = static_cast<uint32_t>(sizeof(Record));
+          sqe->off = positions[i];
+          sqe->user_data = i;
+        },
+        [&](uint64_t i, int res) {
+          ok[i] = res == static_cast<int>(sizeof(Record));
+        });
+  }
+};
+#endif
+
+// ---------------------------------------
+//            FlashTier
+//----------------------------------------
+
+// IoRing 只在这里是完整类型，构造和析构都放在这里
+FLASHTIER_TEMPLATE_ARGUMENTS
+FLASHTIER::FlashTier() = default;
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+FLASHTIER::~FlashTier() { Close(); }
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Open(const std::string& path, size_t capacity_bytes) -> bool {
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_trivially_copyable<Value>::value,
+                "flash records are copied byte by byte");
+  Close();
+  if (capacity_bytes / kRegionSize < kMinRegions) {
+    return false;
+  }
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  fd_ = fd;
+  num_regions_ = capacity_bytes / kRegionSize;
+  region_fingerprints_.assign(num_regions_, {});
+  active_.reset(new Region());
+  active_->records_.reserve(kRecordsPerRegion);
+  active_region_.store(0);
+  flushed_region_.store(0);
+  dropped_.store(0);
+#ifdef USE_IO_URING
+  // 内核不支持或被禁用时退回 pwrite
+  ring_.reset(new IoRing());
+  if (!ring_->Init(kMaxPending)) {
+    ring_.reset();
+  }
+  read_ring_.reset(new IoRing());
+  if (!read_ring_->Init(kReadBatch)) {
+    read_ring_.reset();
+  }
+#endif
+  flusher_stop_ = false;
+  flusher_ = std::thread(&FlashTier::flush_loop, this);
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Close() -> void {
+  if (fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    flusher_stop_ = true;
+  }
+  flusher_cv_.notify_one();
+  flusher_.join();
+#ifdef USE_IO_URING
+  ring_.reset();
+  read_ring_.reset();
+#endif
+  close(fd_);
+  fd_ = -1;
+  Clear();
+  active_.reset();
+  pending_.clear();
+  free_.clear();
+  region_fingerprints_.clear();
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Admit(const Key& key, size_t hash, const Value& value)
+    -> bool {
+  if (fd_ < 0) {
+    return false;
+  }
+  size_t fingerprint = hash;
+  std::lock_guard<std::mutex> lock(latch_);
+  if (active_->records_.size() == kRecordsPerRegion && !seal_active()) {
+    dropped_++;
+    return false;
+  }
+  uint64_t offset =
+      active_->id_ * kRecordsPerRegion + active_->records_.size();
+  active_->records_.push_back(Record{key, value});
+  region_fingerprints_[active_->id_ % num_regions_].push_back(fingerprint);
+  IndexStripe& s = stripe(fingerprint);
+  std::lock_guard<std::mutex> stripe_lock(s.latch_);
+  s.map_[fingerprint] = offset;
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Find(const Key& key, size_t hash, Value& value,
+                      uint64_t* offset_out) -> bool {
+  if (fd_ < 0) {
+    return false;
+  }
+  uint64_t offset;
+  if (!lookup(hash, offset)) {
+    return false;
+  }
+  Record record;
+  if (!copy_buffered(offset, record) && !read_record(offset, record)) {
+    return false;
+  }
+  if (!KeyEqual()(record.key_, key)) {
+    return false;
+  }
+  value = record.value_;
+  if (offset_out != nullptr) {
+    *offset_out = offset;
+  }
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::FindBatch(const Key* keys, const size_t* hashes, size_t count,
+                          Value* values, uint64_t* offsets, bool* found)
+    -> size_t {
+  std::fill(found, found + count, false);
+  if (fd_ < 0) {
+    return 0;
+  }
+  size_t hits = 0;
+  std::vector<Record> records(count);
+  // 需要读盘的下标，读完后统一比较 key
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < count; ++i) {
+    if (!lookup(hashes[i], offsets[i])) {
+      continue;
+    }
+    if (!copy_buffered(offsets[i], records[i])) {
+      pending.push_back(i);
+    } else if (KeyEqual()(records[i].key_, keys[i])) {
+      values[i] = records[i].value_;
+      found[i] = true;
+      hits++;
+    }
+  }
+  if (pending.empty()) {
+    return hits;
+  }
+  std::vector<uint64_t> read_offsets(pending.size());
+  std::vector<Record> read_buffer(pending.size());
+  std::unique_ptr<bool[]> ok(new bool[pending.size()]);
+  for (size_t i = 0; i < pending.size(); ++i) {
+    read_offsets[i] = offsets[pending[i]];
+  }
+  read_records(read_offsets.data(), read_buffer.data(), ok.get(),
+               pending.size());
+  for (size_t i = 0; i < pending.size(); ++i) {
+    size_t idx = pending[i];
+    if (ok[i] && KeyEqual()(read_buffer[i].key_, keys[idx])) {
+      values[idx] = read_buffer[i].value_;
+      found[idx] = true;
+      hits++;
+    }
+  }
+  return hits;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Indexed(const Key& key, size_t hash, uint64_t offset)
+    -> bool {
+  (void)key;
+  if (fd_ < 0) {
+    return false;
+  }
+  IndexStripe& s = stripe(hash);
+  std::lock_guard<std::mutex> lock(s.latch_);
+  auto it = s.map_.find(hash);
+  return it != s.map_.end() && it->second == offset;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Remove(const Key& key, size_t hash) -> bool {
+  (void)key;
+  if (fd_ < 0) {
+    return false;
+  }
+  IndexStripe& s = stripe(hash);
+  std::lock_guard<std::mutex> lock(s.latch_);
+  return s.map_.erase(hash) > 0;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Clear() -> void {
+  for (IndexStripe& s : index_) {
+    std::lock_guard<std::mutex> lock(s.latch_);
+    s.map_.clear();
+  }
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::Size() -> size_t {
+  size_t size = 0;
+  for (IndexStripe& s : index_) {
+    std::lock_guard<std::mutex> lock(s.latch_);
+    size += s.map_.size();
+  }
+  return size;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::seal_active() -> bool {
+  if (pending_.size() >= kMaxPending) {
+    return false;
+  }
+  uint64_t next = active_->id_ + 1;
+  pending_.push_back(std::move(active_));
+  if (free_.empty()) {
+    active_.reset(new Region());
+    active_->records_.reserve(kRecordsPerRegion);
+  } else {
+    active_ = std::move(free_.back());
+    free_.pop_back();
+    active_->records_.clear();
+  }
+  active_->id_ = next;
+  active_region_.store(next);
+  // 新的活跃 region 和一圈之前的 region 共用同一块文件空间
+  if (next >= num_regions_) {
+    reclaim(next - num_regions_);
+  }
+  flusher_cv_.notify_one();
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::reclaim(uint64_t region) -> void {
+  std::vector<size_t>& fingerprints =
+      region_fingerprints_[region % num_regions_];
+  for (size_t fingerprint : fingerprints) {
+    IndexStripe& s = stripe(fingerprint);
+    std::lock_guard<std::mutex> lock(s.latch_);
+    auto it = s.map_.find(fingerprint);
+    if (it != s.map_.end() && it->second / kRecordsPerRegion == region) {
+      s.map_.erase(it);
+    }
+  }
+  fingerprints.clear();
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::flush_loop() -> void {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    flusher_cv_.wait(lock,
+                     [this]() { return flusher_stop_ || !pending_.empty(); });
+    if (flusher_stop_) {
+      return;
+    }
+    // pending_ 只在队尾追加，这些 Region 在写盘期间地址不变
+    std::vector<Region*> batch;
+    for (const auto& region : pending_) {
+      batch.push_back(region.get());
+    }
+    lock.unlock();
+    bool written = write_regions(batch);
+    lock.lock();
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (!written) {
+        // 文件里可能是旧数据，让索引不再指向这些 region
+        reclaim(batch[i]->id_);
+      }
+      free_.push_back(std::move(pending_.front()));
+      pending_.pop_front();
+    }
+    flushed_region_.store(batch.back()->id_ + 1);
+  }
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::write_regions(const std::vector<Region*>& regions) -> bool {
+#ifdef USE_IO_URING
+  if (ring_ != nullptr) {
+    if (ring_->WriteBatch(fd_, regions, num_regions_)) {
+      return true;
+    }
+    // 提交失败后 ring 的状态不可信，之后都走 pwrite
+    ring_.reset();
+  }
+#endif
+  bool ok = true;
+  for (Region* region : regions) {
+    ok = pwrite_all(fd_, region->records_.data(),
+                    region->records_.size() * sizeof(Record),
+                    (region->id_ % num_regions_) * kRegionSize) &&
+         ok;
+  }
+  return ok;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::lookup(size_t fingerprint, uint64_t& offset) -> bool {
+  IndexStripe& s = stripe(fingerprint);
+  std::lock_guard<std::mutex> lock(s.latch_);
+  auto it = s.map_.find(fingerprint);
+  if (it == s.map_.end()) {
+    return false;
+  }
+  offset = it->second;
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::copy_buffered(uint64_t offset, Record& record) -> bool {
+  uint64_t region = offset / kRecordsPerRegion;
+  if (region < flushed_region_.load()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(latch_);
+  const Region* found = nullptr;
+  if (active_->id_ == region) {
+    found = active_.get();
+  } else {
+    for (const auto& pending : pending_) {
+      if (pending->id_ == region) {
+        found = pending.get();
+        break;
+      }
+    }
+  }
+  if (found == nullptr) {
+    return false;
+  }
+  record = found->records_[offset % kRecordsPerRegion];
+  return true;
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::read_record(uint64_t offset, Record& record) -> bool {
+  uint64_t region = offset / kRecordsPerRegion;
+  if (!readable(region)) {
+    return false;
+  }
+  off_t position = (region % num_regions_) * kRegionSize +
+                   (offset % kRecordsPerRegion) * sizeof(Record);
+  if (pread(fd_, &record, sizeof(Record), position) !=
+      static_cast<ssize_t>(sizeof(Record))) {
+    return false;
+  }
+  // 读取期间 region 可能已经被新一圈的数据覆盖
+  return readable(region);
+}
+
+FLASHTIER_TEMPLATE_ARGUMENTS
+auto FLASHTIER::read_records(const uint64_t* offsets, Record* records,
+                             bool* ok, size_t count) -> void {
+  size_t done = 0;
+#ifdef USE_IO_URING
+  {
+    std::lock_guard<std::mutex> lock(read_latch_);
+    off_t positions[kReadBatch];
+    while (read_ring_ != nullptr && done < count) {
+      unsigned batch =
+          static_cast<unsigned>(std::min(kReadBatch, count - done));
+      for (unsigned i = 0; i < batch; ++i) {
+        uint64_t offset = offsets[done + i];
+        positions[i] =
+            (offset / kRecordsPerRegion % num_regions_) * kRegionSize +
+            (offset % kRecordsPerRegion) * sizeof(Record);
+      }
+      if (!read_ring_->ReadBatch(fd_, positions, records + done, ok + done,
+                                 batch)) {
+        // 提交失败后 ring 的状态不可信，这一批和之后都走 pread
+        read_ring_.reset();
+        break;
+      }
+      for (unsigned i = 0; i < batch; ++i) {
+        // 读取期间 region 可能已经被新一圈的数据覆盖
+        ok[done + i] =
+            ok[done + i] && readable(offsets[done + i] / kRecordsPerRegion);
+      }
+      done += batch;
+    }
+  }
+#endif
+  for (size_t i = done; i < count; ++i) {
+    ok[i] = read_record(offsets[i], records[i]);
+  }
+}
+
+template class FlashTier<KeyType, ValueType, HashType, KeyEqualType>;
+
+};  // namespace myLru
@@ -0,0 +1,147 @@
+#include "hash_batch.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MYLRU_HASH_BATCH_X86
+#include <immintrin.h>
+#endif
+
+namespace myLru {
+
+namespace {
+
+constexpr uint64_t kMul1 = 0xbf58476d1ce4e5b9ULL;
+constexpr uint64_t kMul2 = 0x94d049bb133111ebULL;
+
+auto hash_scalar(const int64_t* keys, size_t count, size_t* hashes) -> void {
+  HashFuncImpl hash;
+  for (size_t i = 0; i < count; ++i) {
+    hashes[i] = hash(keys[i]);
+  }
+}
+
+#ifdef MYLRU_HASH_BATCH_X86
+// 低 64 位乘积：lo(a)*lo(b) + ((hi(a)*lo(b) + lo(a)*hi(b)) << 32)
+__attribute__((target("avx2"))) inline auto mullo_avx2(__m256i a, __m256i b)
+    -> __m256i {
+  __m256i lo = _mm256_mul_epu32(a, b);
+  __m256i cross =
+      _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                       _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+  return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2"))) auto hash_avx2(const int64_t* keys,
+                                               size_t count, size_t* hashes)
+    -> void {
+  const __m256i mul1 = _mm256_set1_epi64x(static_cast<int64_t>(kMul1));
+  const __m256i mul2 = _mm256_set1_epi64x(static_cast<int64_t>(kMul2));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+    x = mullo_avx2(_mm256_xor_si256(x, _mm256_srli_epi64(x, 30)), mul1);
+    x = mullo_avx2(_mm256_xor_si256(x, _mm256_srli_epi64(x, 27)), mul2);
+    x = _mm256_xor_si256(x, _mm256_srli_epi64(x, 31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), x);
+  }
+  hash_scalar(keys + i, count - i, hashes + i);
+}
+
+// 逻辑右移，移位量是编译期常量。GCC 12 的 _mm512_srli_epi64 和
+// _mm512_srlv_epi64 用未初始化的 _mm512_undefined_epi32() 作为 passthrough，
+// 会报 -Wmaybe-uninitialized；全掩码的 maskz 版本用零作为 passthrough，
+// 结果相同
+template <unsigned Shift>
+__attribute__((target("avx512f"))) inline auto srli_avx512(__m512i x)
+    -> __m512i {
+  return _mm512_maskz_srli_epi64(static_cast<__mmask8>(0xff), x, Shift);
+}
+
+__attribute__((target("avx512f,avx512dq"))) auto hash_avx512(
+    const int64_t* keys, size_t count, size_t* hashes) -> void {
+  const __m512i mul1 = _mm512_set1_epi64(static_cast<int64_t>(kMul1));
+  const __m512i mul2 = _mm512_set1_epi64(static_cast<int64_t>(kMul2));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m512i x = _mm512_loadu_si512(keys + i);
+    x = _mm512_mullo_epi64(_mm512_xor_si512(x, srli_avx512<30>(x)), mul1);
+    x = _mm512_mullo_epi64(_mm512_xor_si512(x, srli_avx512<27>(x)), mul2);
+    x = _mm512_xor_si512(x, srli_avx512<31>(x));
+    _mm512_storeu_si512(hashes + i, x);
+  }
+  hash_scalar(keys + i, count - i, hashes + i);
+}
+#endif
+
+// 调用方保证 CPU 支持 kernel
+auto run_kernel(HashKernel kernel, const int64_t* keys, size_t count,
+                size_t* hashes) -> void {
+  switch (kernel) {
+#ifdef MYLRU_HASH_BATCH_X86
+    case HashKernel::kAvx2:
+      hash_avx2(keys, count, hashes);
+      return;
+    case HashKernel::kAvx512:
+      hash_avx512(keys, count, hashes);
+      return;
+#endif
+    default:
+      hash_scalar(keys, count, hashes);
+  }
+}
+
+auto select_kernel() -> HashKernel {
+  if (HashKernelSupported(HashKernel::kAvx512)) {
+    return HashKernel::kAvx512;
+  }
+  if (HashKernelSupported(HashKernel::kAvx2)) {
+    return HashKernel::kAvx2;
+  }
+  return HashKernel::kScalar;
+}
+
+}  // namespace
+
+auto HashKernelSupported(HashKernel kernel) -> bool {
+  switch (kernel) {
+    case HashKernel::kScalar:
+      return true;
+#ifdef MYLRU_HASH_BATCH_X86
+    case HashKernel::kAvx2:
+      return __builtin_cpu_supports("avx2");
+    case HashKernel::kAvx512:
+      return __builtin_cpu_supports("avx512f") &&
+             __builtin_cpu_supports("avx512dq");
+#endif
+    default:
+      return false;
+  }
+}
+
+auto HashKernelName(HashKernel kernel) -> const char* {
+  switch (kernel) {
+    case HashKernel::kAvx2:
+      return "avx2";
+    case HashKernel::kAvx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+auto HashBatchKernel() -> HashKernel {
+  static const HashKernel kernel = select_kernel();
+  return kernel;
+}
+
+auto HashBatch(HashKernel kernel, const int64_t* keys, size_t count,
+               size_t* hashes) -> void {
+  run_kernel(HashKernelSupported(kernel) ? kernel : HashKernel::kScalar, keys,
+             count, hashes);
+}
+
+auto HashBatch(const int64_t* keys, size_t count, size_t* hashes) -> void {
+  run_kernel(HashBatchKernel(), keys, count, hashes);
+}
+
+}  // namespace myLru
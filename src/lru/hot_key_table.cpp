@@ -0,0 +1,206 @@
+#include "hot_key_table.h"
+
+#include <algorithm>
+#include <thread>
+namespace myLru {
+
+// ---------------------------------------
+//            HotKeyTable
+//----------------------------------------
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Find(const Key& key, size_t hash, Value& value,
+                       uint32_t& fill_version) -> bool {
+  fill_version = kNoFill;
+  HotSlot& slot = slot_of(hash);
+  uint32_t version = slot.version_.load(std::memory_order_acquire);
+  if (version & 1) {
+    return false;
+  }
+  if (!slot.used_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  bool valid = slot.valid_.load(std::memory_order_relaxed);
+  if (valid) {
+    value = slot.value_.Load();
+  }
+  bool same_key = KeyEqual()(slot.key_.Load(), key);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!same_key ||
+      slot.version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+  if (!valid) {
+    fill_version = version;
+    return false;
+  }
+  return true;
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Fill(const Key& key, size_t hash, const Value& value,
+                       uint32_t fill_version) -> void {
+  if (fill_version & 1) {
+    return;
+  }
+  HotSlot& slot = slot_of(hash);
+  uint32_t expected = fill_version;
+  if (!slot.version_.compare_exchange_strong(expected, fill_version + 1,
+                                             std::memory_order_acquire)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  if (slot.used_.load(std::memory_order_relaxed) &&
+      !slot.valid_.load(std::memory_order_relaxed) &&
+      KeyEqual()(slot.key_.Load(), key)) {
+    slot.value_.Store(value);
+    slot.valid_.store(true, std::memory_order_relaxed);
+  }
+  unlock_slot(slot, fill_version);
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Invalidate(const Key& key, size_t hash) -> void {
+  HotSlot& slot = slot_of(hash);
+  // 绝大多数写入的 key 不是热点，先只读地确认一次，避免写热点槽位所在的
+  // cache line
+  uint32_t version = slot.version_.load(std::memory_order_acquire);
+  if (!(version & 1)) {
+    bool match = slot.used_.load(std::memory_order_relaxed) &&
+                 KeyEqual()(slot.key_.Load(), key);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!match && slot.version_.load(std::memory_order_relaxed) == version) {
+      return;
+    }
+  }
+  version = lock_slot(slot);
+  if (slot.used_.load(std::memory_order_relaxed) &&
+      KeyEqual()(slot.key_.Load(), key)) {
+    slot.valid_.store(false, std::memory_order_relaxed);
+  }
+  unlock_slot(slot, version);
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Record(const Key& key) -> bool {
+  static thread_local uint32_t tick = 0;
+  if ((++tick & (kSampleRate - 1)) != 0) {
+    return false;
+  }
+  // 统计只是启发式的，拿不到锁就丢掉这个样本
+  std::unique_lock<std::mutex> lock(sketch_latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return true;
+  }
+  auto it = std::find_if(counters_.begin(), counters_.end(),
+                         [&](const Counter& c) {
+                           return KeyEqual()(c.key_, key);
+                         });
+  if (it != counters_.end()) {
+    it->count_++;
+  } else if (counters_.size() < kCounters) {
+    counters_.push_back(Counter{key, 1, 0});
+  } else {
+    auto min_it = std::min_element(
+        counters_.begin(), counters_.end(),
+        [](const Counter& a, const Counter& b) { return a.count_ < b.count_; });
+    min_it->key_ = key;
+    min_it->error_ = min_it->count_;
+    min_it->count_++;
+  }
+  if (++samples_ >= kWindowSamples) {
+    publish();
+  }
+  return true;
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Contains(const Key& key) -> bool {
+  HotSlot& slot = slot_of(Hash()(key));
+  uint32_t version = lock_slot(slot);
+  bool found = slot.used_.load(std::memory_order_relaxed) &&
+               KeyEqual()(slot.key_.Load(), key);
+  unlock_slot(slot, version);
+  return found;
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::Clear() -> void {
+  for (HotSlot& slot : slots_) {
+    uint32_t version = lock_slot(slot);
+    slot.used_.store(false, std::memory_order_relaxed);
+    slot.valid_.store(false, std::memory_order_relaxed);
+    unlock_slot(slot, version);
+  }
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::lock_slot(HotSlot& slot) -> uint32_t {
+  while (true) {
+    uint32_t version = slot.version_.load(std::memory_order_relaxed);
+    if (!(version & 1) &&
+        slot.version_.compare_exchange_weak(version, version + 1,
+                                            std::memory_order_acquire)) {
+      std::atomic_thread_fence(std::memory_order_release);
+      return version;
+    }
+    std::this_thread::yield();
+  }
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::unlock_slot(HotSlot& slot, uint32_t version) -> void {
+  slot.version_.store(version + 2, std::memory_order_release);
+}
+
+HOTKEYTABLE_TEMPLATE_ARGUMENTS
+auto HOTKEYTABLE::publish() -> void {
+  // 按保证计数（count_ - error_）从高到低，冲突的槽位留给更热的 key
+  std::sort(counters_.begin(), counters_.end(),
+            [](const Counter& a, const Counter& b) {
+              return a.count_ - a.error_ > b.count_ - b.error_;
+            });
+  const Counter* wanted[kSlots] = {nullptr};
+  for (const Counter& c : counters_) {
+    if (c.count_ - c.error_ < samples_ / kHotShareDivisor) {
+      break;
+    }
+    size_t idx = Hash()(c.key_) & (kSlots - 1);
+    if (wanted[idx] == nullptr) {
+      wanted[idx] = &c;
+    }
+  }
+
+  for (size_t i = 0; i < kSlots; ++i) {
+    HotSlot& slot = slots_[i];
+    // 保留仍然是热点的槽位，不打断它的读者
+    bool used = slot.used_.load(std::memory_order_relaxed);
+    if (wanted[i] != nullptr && used &&
+        KeyEqual()(slot.key_.Load(), wanted[i]->key_)) {
+      continue;
+    }
+    if (wanted[i] == nullptr && !used) {
+      continue;
+    }
+    uint32_t version = lock_slot(slot);
+    if (wanted[i] != nullptr) {
+      slot.key_.Store(wanted[i]->key_);
+      slot.used_.store(true, std::memory_order_relaxed);
+    } else {
+      slot.used_.store(false, std::memory_order_relaxed);
+    }
+    slot.valid_.store(false, std::memory_order_relaxed);
+    unlock_slot(slot, version);
+  }
+
+  // 计数减半，让不再热的 key 逐渐退出
+  for (Counter& c : counters_) {
+    c.count_ /= 2;
+    c.error_ /= 2;
+  }
+  samples_ = 0;
+}
+
+template class HotKeyTable<KeyType, ValueType, HashType, KeyEqualType>;
+
+};  // namespace myLru
@@ -0,0 +1,372 @@
+#include "lfu_cache.h"
+
+#include <algorithm>
+#include <vector>
+namespace myLru {
+
+// ---------------------------------------
+//            LFUCache
+//----------------------------------------
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+LFUCACHE::LFUCache() : max_size_(0), cur_size_(0) {
+  bucket_head_.next_ = &bucket_tail_;
+  bucket_tail_.prev_ = &bucket_head_;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+LFUCACHE::LFUCache(size_t size) : max_size_(0), cur_size_(0) {
+  bucket_head_.next_ = &bucket_tail_;
+  bucket_tail_.prev_ = &bucket_head_;
+  Resize(size);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+LFUCACHE::~LFUCache() { Clear(); }
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Find(const Key& key, size_t hash, Value& value) -> bool {
+#ifdef USE_HHVM
+  LRUNode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+    return false;
+  }
+  // 不持有 latch_ 时节点可能在读取期间被淘汰并复用，
+  // 用 version_ 做一次 seqlock 式的校验
+  uint32_t version = cur_node->version_.load(std::memory_order_acquire);
+  if (version & 1) {
+    return false;
+  }
+  Value read = cur_node->value_.Load();
+  bool same_key = KeyEqual()(cur_node->key_.Load(), key);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!same_key ||
+      cur_node->version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+  value = read;
+  // 拿不到锁时只返回值，放弃这一次频率计数
+  std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return true;
+  }
+  // 校验之后、拿到锁之前节点已被淘汰或复用
+  if (cur_node->version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+#else
+  std::lock_guard<std::mutex> lock(latch_);
+  LRUNode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+    return false;
+  }
+  value = cur_node->value_.Load();
+#endif
+  increment(cur_node);
+  tick();
+  return true;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Insert(const Key& key, size_t hash, Value value) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (max_size_ == 0) {
+    return false;
+  }
+  if (cur_size_ >= max_size_) {
+    evict();
+  }
+  if (free_list_.empty()) {
+    return false;
+  }
+  LRUNode* new_node = free_list_.back();
+  new_node->version_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  new_node->key_.Store(key);
+  new_node->hash_ = hash;
+  new_node->value_.Store(value);
+  new_node->version_.fetch_add(1, std::memory_order_release);
+  if (!hash_table_.Insert(key, hash, new_node)) {
+    return false;
+  }
+  free_list_.pop_back();
+
+  FreqBucket* first = bucket_head_.next_;
+  if (first == &bucket_tail_ || first->freq_ != 1) {
+    first = allocate_bucket(1, &bucket_head_);
+  }
+  push_node(first, new_node);
+  cur_size_++;
+  if (ghost_tracking_ && ghost_.Contains(hash)) {
+    ghost_hits_++;
+  }
+  tick();
+  return true;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Remove(const Key& key, size_t hash) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (cur_size_ == 0) {
+    return false;
+  }
+  LRUNode* to_remove;
+  if (!hash_table_.Get(key, hash, to_remove)) {
+    return false;
+  }
+  if (to_remove == nullptr || to_remove->bucket_ == nullptr ||
+      !KeyEqual()(to_remove->key_.Load(), key)) {
+    return false;
+  }
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, to_remove->value_.Load(),
+                         RemovalReason::kExplicit);
+  }
+  remove_node(to_remove);
+  hash_table_.Remove(key, hash);
+  release_node(to_remove);
+  cur_size_--;
+  return true;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return cur_size_;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Clear() -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  hash_table_.Clear();
+  while (bucket_head_.next_ != &bucket_tail_) {
+    FreqBucket* bucket = bucket_head_.next_;
+    bucket->head_.next_ = &bucket->tail_;
+    bucket->tail_.prev_ = &bucket->head_;
+    release_bucket(bucket);
+  }
+  free_list_.clear();
+  free_list_.reserve(nodes_.size());
+  for (size_t i = nodes_.size(); i > 0; --i) {
+    nodes_[i - 1].next_ = nullptr;
+    nodes_[i - 1].prev_ = nullptr;
+    nodes_[i - 1].bucket_ = nullptr;
+    nodes_[i - 1].version_.fetch_add(2, std::memory_order_release);
+    free_list_.push_back(&nodes_[i - 1]);
+  }
+  ghost_.Clear();
+  ops_since_decay_ = 0;
+  cur_size_ = 0;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::Resize(size_t size) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  while (cur_size_ > size) {
+    evict();
+  }
+  if (cur_size_ == 0) {
+    hash_table_.SetSize(size);
+  } else {
+    hash_table_.Reserve(size);
+  }
+  max_size_ = size;
+  if (!custom_decay_interval_) {
+    decay_interval_ = kDecayFactor * size;
+  }
+  if (ghost_tracking_) {
+    ghost_.Reset(size);
+  }
+  if (nodes_.size() < size) {
+    grow_pool(size);
+  }
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::SetDecayInterval(size_t ops) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  decay_interval_ = ops;
+  custom_decay_interval_ = true;
+  ops_since_decay_ = 0;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::GetStats() -> ShardStats {
+  std::lock_guard<std::mutex> lock(latch_);
+  ShardStats stats;
+  stats.capacity_ = max_size_;
+  stats.size_ = cur_size_;
+  stats.evictions_ = evictions_;
+  stats.ghost_hits_ = ghost_hits_;
+  return stats;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::SetGhostTracking(bool enable) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  ghost_tracking_ = enable;
+  ghost_.Reset(enable ? max_size_ : 0);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::ExportEntries(std::vector<std::pair<Key, Value>>& entries)
+    -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  entries.reserve(entries.size() + cur_size_);
+  for (FreqBucket* bucket = bucket_head_.next_; bucket != &bucket_tail_;
+       bucket = bucket->next_) {
+    for (LRUNode* node = bucket->tail_.prev_; node != &bucket->head_;
+         node = node->prev_) {
+      entries.emplace_back(node->key_.Load(), node->value_.Load());
+    }
+  }
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::evict() -> void {
+  FreqBucket* min_bucket = bucket_head_.next_;
+  if (min_bucket == &bucket_tail_) {
+    return;
+  }
+  // 同一频率内按 LRU 淘汰
+  LRUNode* last_node = min_bucket->tail_.prev_;
+  Key key = last_node->key_.Load();
+  remove_node(last_node);
+  hash_table_.Remove(key, last_node->hash_);
+  cur_size_--;
+  evictions_++;
+  if (ghost_tracking_) {
+    ghost_.Push(last_node->hash_);
+  }
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, last_node->value_.Load(), RemovalReason::kSize);
+  }
+#ifdef USE_HOT_KEY_CACHE
+  if (hot_keys_ != nullptr) {
+    hot_keys_->Invalidate(key, last_node->hash_);
+  }
+#endif
+  release_node(last_node);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::release_node(LRUNode* node) -> void {
+  // 之前已经拿到这个节点的无锁 Find 校验时会失败
+  node->version_.fetch_add(2, std::memory_order_release);
+  free_list_.push_back(node);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::increment(LRUNode* node) -> void {
+  FreqBucket* bucket = node->bucket_;
+  size_t new_freq = bucket->freq_ + 1;
+  FreqBucket* target = bucket->next_;
+  if (target == &bucket_tail_ || target->freq_ != new_freq) {
+    target = allocate_bucket(new_freq, bucket);
+  }
+  remove_node(node);
+  push_node(target, node);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::decay() -> void {
+  // 频率减半保持桶的相对顺序，只有相邻的桶可能合并。
+  // 合并时频率较高的桶拼到前一个桶的头部（MRU 一侧）。
+  FreqBucket* kept = nullptr;
+  FreqBucket* bucket = bucket_head_.next_;
+  while (bucket != &bucket_tail_) {
+    FreqBucket* next_bucket = bucket->next_;
+    bucket->freq_ = std::max<size_t>(1, bucket->freq_ / 2);
+    if (kept != nullptr && kept->freq_ == bucket->freq_) {
+      LRUNode* first = bucket->head_.next_;
+      LRUNode* last = bucket->tail_.prev_;
+      for (LRUNode* node = first; node != &bucket->tail_; node = node->next_) {
+        node->bucket_ = kept;
+      }
+      LRUNode* ori_first = kept->head_.next_;
+      kept->head_.next_ = first;
+      first->prev_ = &kept->head_;
+      last->next_ = ori_first;
+      ori_first->prev_ = last;
+      bucket->head_.next_ = &bucket->tail_;
+      bucket->tail_.prev_ = &bucket->head_;
+      release_bucket(bucket);
+    } else {
+      kept = bucket;
+    }
+    bucket = next_bucket;
+  }
+  ops_since_decay_ = 0;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::tick() -> void {
+  if (decay_interval_ > 0 && ++ops_since_decay_ >= decay_interval_) {
+    decay();
+  }
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::push_node(FreqBucket* bucket, LRUNode* node) -> void {
+  LRUNode* ori_first = bucket->head_.next_;
+  ori_first->prev_ = node;
+  node->next_ = ori_first;
+  node->prev_ = &bucket->head_;
+  bucket->head_.next_ = node;
+  node->bucket_ = bucket;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::remove_node(LRUNode* node) -> void {
+  LRUNode* ori_next = node->next_;
+  LRUNode* ori_prev = node->prev_;
+  ori_next->prev_ = ori_prev;
+  ori_prev->next_ = ori_next;
+  node->next_ = nullptr;
+  node->prev_ = nullptr;
+  FreqBucket* bucket = node->bucket_;
+  node->bucket_ = nullptr;
+  if (bucket->Empty()) {
+    release_bucket(bucket);
+  }
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::allocate_bucket(size_t freq, FreqBucket* prev) -> FreqBucket* {
+  FreqBucket* bucket;
+  if (free_buckets_.empty()) {
+    buckets_.emplace_back();
+    bucket = &buckets_.back();
+  } else {
+    bucket = free_buckets_.back();
+    free_buckets_.pop_back();
+  }
+  bucket->freq_ = freq;
+  bucket->prev_ = prev;
+  bucket->next_ = prev->next_;
+  prev->next_->prev_ = bucket;
+  prev->next_ = bucket;
+  return bucket;
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::release_bucket(FreqBucket* bucket) -> void {
+  bucket->prev_->next_ = bucket->next_;
+  bucket->next_->prev_ = bucket->prev_;
+  bucket->next_ = nullptr;
+  bucket->prev_ = nullptr;
+  free_buckets_.push_back(bucket);
+}
+
+LFUCACHE_TEMPLATE_ARGUMENTS
+auto LFUCACHE::grow_pool(size_t size) -> void {
+  free_list_.reserve(size);
+  for (size_t i = nodes_.size(); i < size; ++i) {
+    nodes_.emplace_back();
+    free_list_.push_back(&nodes_.back());
+  }
+}
+
+template class LFUCache<KeyType, ValueType, HashType, KeyEqualType>;
+
+};  // namespace myLru
@@ -1,8 +1,32 @@
 #include "lru_cache.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 namespace myLru {
 
+static auto pwrite_all(int fd, const void* data, size_t size, off_t offset)
+    -> bool {
+  const char* cur = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = pwrite(fd, cur, size, offset);
+    if (written <= 0) {
+      return false;
+    }
+    cur += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
 // ---------------------------------------
 //            LRUCache
 //----------------------------------------
@@ -13,6 +37,9 @@ LRUCACHE::LRUCache() : max_size_(0), cur_size_(0) {
   tail_ = new LRUNode();
   head_->next_ = tail_;
   tail_->prev_ = head_;
+#ifdef USE_MIDPOINT_INSERTION
+  midpoint_ = tail_;
+#endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
@@ -21,13 +48,11 @@ LRUCACHE::LRUCache(size_t size) : max_size_(size), cur_size_(0) {
   tail_ = new LRUNode();
   head_->next_ = tail_;
   tail_->prev_ = head_;
+#ifdef USE_MIDPOINT_INSERTION
+  midpoint_ = tail_;
+#endif
 #ifdef PRE_ALLOCATE
-  nodes_.reserve(size);
-  for (size_t i = 0; i < size; ++i) {
-    // nodes : vector<LRUNode> nodes_;
-    // nodes_.emplace_back();
-    free_list_.push_back(i);
-  }
+  grow_pool(size);
 #endif
 }
 
@@ -39,34 +64,65 @@ LRUCACHE::~LRUCache() {
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
-auto LRUCACHE::Find(const Key& key, Value& value) -> bool {
-#ifdef USE_HHVM
+auto LRUCACHE::Find(const Key& key, size_t hash, Value& value) -> bool {
+#if defined(USE_SIEVE) && defined(PRE_ALLOCATE)
+  // SIEVE 命中不修改链表，节点来自不释放的节点池，不需要 latch_
   LRUNode* cur_node;
-  if (!hash_table_.Get(key, cur_node)) {
+  if (hash_table_.Get(key, hash, cur_node) &&
+      find_sieve(cur_node, key, value)) {
+    return true;
+  }
+#ifdef USE_COLD_TIER
+  std::lock_guard<std::mutex> cold_lock(latch_);
+  return promote_cold(key, hash, value);
+#else
+  return false;
+#endif
+#else
+#if defined(USE_HHVM) && !defined(USE_SIEVE)
+  LRUNode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+#ifdef USE_COLD_TIER
+    std::lock_guard<std::mutex> cold_lock(latch_);
+    return promote_cold(key, hash, value);
+#else
     return false;
+#endif
   }
 #else
   std::lock_guard<std::mutex> lock(latch_);
   LRUNode* cur_node;
-  if (!hash_table_.Get(key, cur_node)) {
+  if (!hash_table_.Get(key, hash, cur_node)) {
+#ifdef USE_COLD_TIER
+    return promote_cold(key, hash, value);
+#else
     return false;
+#endif
   }
 
 #endif
 
-  value = cur_node->value_;
+  value = cur_node->value_.Load();
 
+#ifdef USE_SIEVE
+  // 没有 PRE_ALLOCATE 时被淘汰的节点会被 delete，SIEVE 命中也持有 latch_，
+  // 只打访问标记，不修改链表
+  if (!cur_node->visited_.load(std::memory_order_relaxed)) {
+    cur_node->visited_.store(true, std::memory_order_relaxed);
+  }
+  return true;
+#else
 #ifdef USE_HHVM
   std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
 
   if (!lock.owns_lock()) {
-    value = cur_node->value_;
+    value = cur_node->value_.Load();
     return true;
   }
 #endif
 
 #ifdef USE_HASH_RESIZER
-  if (cur_node == nullptr || cur_node->key_ != key ||
+  if (cur_node == nullptr || cur_node->key_.Load() != key ||
       cur_node->next_ == nullptr || cur_node->prev_ == nullptr) {
     // LRU_ERR("Something wrong in hashtable.");
     // std::cout << key << " " << cur_node->key_ << std::endl;
@@ -75,71 +131,183 @@ auto LRUCACHE::Find(const Key& key, Value& value) -> bool {
 #endif
 
   if (cur_node->inList()) {
+#ifdef USE_MIDPOINT_INSERTION
+    // old 子链表中的节点只有在插入超过 dwell_ms_ 后再次命中才晋升到
+    // young，扫描期间的短时间重复访问不会挤掉热点
+    if (cur_node->old_ && now_ms() - cur_node->old_time_ < dwell_ms_) {
+      return true;
+    }
+#endif
     remove_node(cur_node);
     push_node(cur_node);
+#ifdef USE_MIDPOINT_INSERTION
+    adjust_midpoint();
+#endif
+  }
+  return true;
+#endif
+#endif
+}
+
+#if defined(USE_SIEVE) && defined(PRE_ALLOCATE)
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::find_sieve(LRUNode* cur_node, const Key& key, Value& value)
+    -> bool {
+  // 节点可能在读取期间被淘汰并复用，用 version_ 做一次 seqlock 式的校验
+  uint32_t version = cur_node->version_.load(std::memory_order_acquire);
+  if (version & 1) {
+    return false;
+  }
+  Value read = cur_node->value_.Load();
+  bool same_key = KeyEqual()(cur_node->key_.Load(), key);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!same_key ||
+      cur_node->version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+  value = read;
+  if (!cur_node->visited_.load(std::memory_order_relaxed)) {
+    cur_node->visited_.store(true, std::memory_order_relaxed);
   }
   return true;
 }
+#endif
 
 LRUCACHE_TEMPLATE_ARGUMENTS
-auto LRUCACHE::Insert(const Key& key, Value value) -> bool {
+auto LRUCACHE::Insert(const Key& key, size_t hash, Value value) -> bool {
+#ifdef USE_FLASH_TIER
+  std::unique_lock<std::mutex> lock(latch_);
+  bool inserted = insert_helper(key, hash, value);
+  // flash 中同一个 key 的旧值不能再被读到
+  if (inserted) {
+    flash_erase(key, hash);
+  }
+  admit_victims(lock);
+  return inserted;
+#else
   std::lock_guard<std::mutex> lock(latch_);
+#ifdef USE_COLD_TIER
+  // key 不会同时在 hot 和 cold 中，新值让冷池里的旧值作废
+  cold_erase(key, hash, nullptr);
+#endif
+  return insert_helper(key, hash, value);
+#endif
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::insert_helper(const Key& key, size_t hash, const Value& value)
+    -> bool {
   if (cur_size_ == max_size_) {
     evict();
   }
+#ifdef USE_BACKGROUND_EVICTION
+  // 这次插入之后会超过高水位
+  if (high_mark_ > 0 && cur_size_ >= high_mark_) {
+    above_high_.store(true, std::memory_order_relaxed);
+  }
+#endif
 #ifdef PRE_ALLOCATE
   LRUNode* new_node = allocate_node();
   if (new_node == nullptr) {
     return false;  // No free nodes available
   }
-  new_node->key_ = key;
-  new_node->value_ = value;
+#ifdef USE_SIEVE
+  new_node->version_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+#endif
+  new_node->key_.Store(key);
+  new_node->hash_ = hash;
+  new_node->value_.Store(value);
+#ifdef USE_SIEVE
+  new_node->visited_.store(false, std::memory_order_relaxed);
+  new_node->version_.fetch_add(1, std::memory_order_release);
+#endif
 
-  if (!hash_table_.Insert(key, new_node)) {
+  if (!hash_table_.Insert(key, hash, new_node)) {
     release_node(new_node);
     return false;
   }
 
+#ifdef USE_MIDPOINT_INSERTION
+  push_old(new_node);
+  cur_size_++;
+  adjust_midpoint();
+#else
   push_node(new_node);
   cur_size_++;
+#endif
+  if (ghost_tracking_ && ghost_.Contains(hash)) {
+    ghost_hits_++;
+  }
   return true;
 #else
 
-  LRUNode* new_node = new LRUNode(key, value);
-  if (!hash_table_.Insert(key, new_node)) {
+  LRUNode* new_node = new LRUNode(key, hash, value);
+  if (!hash_table_.Insert(key, hash, new_node)) {
     delete new_node;
     return false;
   }
 
+#ifdef USE_MIDPOINT_INSERTION
+  push_old(new_node);
+  cur_size_++;
+  adjust_midpoint();
+#else
   push_node(new_node);
   cur_size_++;
+#endif
+  if (ghost_tracking_ && ghost_.Contains(hash)) {
+    ghost_hits_++;
+  }
   return true;
 #endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
-auto LRUCACHE::Remove(const Key& key) -> bool {
+auto LRUCACHE::Remove(const Key& key, size_t hash) -> bool {
   std::lock_guard<std::mutex> lock(latch_);
+#ifdef USE_FLASH_TIER
+  // 和 DRAM 中的删除在同一段 latch_ 内完成，之后的提升不会把 key 带回来
+  bool in_flash = flash_erase(key, hash);
+  return remove_locked(key, hash) || in_flash;
+#else
+  return remove_locked(key, hash);
+#endif
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::remove_locked(const Key& key, size_t hash) -> bool {
+#ifdef USE_COLD_TIER
+  if (cold_erase(key, hash, removal_queue_)) {
+    return true;
+  }
+#endif
   if (cur_size_ == 0) {
     return false;
   }
 #ifdef PRE_ALLOCATE
   LRUNode* to_remove;
-  if (!hash_table_.Get(key, to_remove)) {
+  if (!hash_table_.Get(key, hash, to_remove)) {
     return false;  // Key not found
   }
-  if (to_remove == nullptr || to_remove->key_ != key ||
+  if (to_remove == nullptr || to_remove->key_.Load() != key ||
       to_remove->next_ == nullptr || to_remove->prev_ == nullptr) {
     // LRU_ERR("Something wrong in hashtable.");
     return false;
   }
-  return remove_helper(key, to_remove);
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, to_remove->value_.Load(), RemovalReason::kExplicit);
+  }
+  return remove_helper(key, hash, to_remove);
 #else
   LRUNode* cur_node;
-  if (!hash_table_.Get(key, cur_node)) {
+  if (!hash_table_.Get(key, hash, cur_node)) {
     return false;
   }
-  return remove_helper(key, cur_node);
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, cur_node->value_.Load(), RemovalReason::kExplicit);
+  }
+  return remove_helper(key, hash, cur_node);
 #endif
 }
 
@@ -160,7 +328,7 @@ auto LRUCACHE::Clear() -> void {
   free_list_.clear();
   free_list_.reserve(nodes_.size());
   for (size_t i = 0; i < nodes_.size(); ++i) {
-    free_list_.push_back(i);
+    free_list_.push_back(&nodes_[i]);
   }
 #else
   LRUNode* cur_node = head_->next_;
@@ -172,52 +340,220 @@ auto LRUCACHE::Clear() -> void {
 #endif
   head_->next_ = tail_;
   tail_->prev_ = head_;
+#ifdef USE_SIEVE
+  hand_ = nullptr;
+#endif
+#ifdef USE_MIDPOINT_INSERTION
+  midpoint_ = tail_;
+  old_size_ = 0;
+#endif
   hash_table_.Clear();
+  ghost_.Clear();
   cur_size_ = 0;
+#ifdef USE_COLD_TIER
+  cold_.Clear();
+#endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto LRUCACHE::Resize(size_t size) -> void {
-  std::lock_guard<std::mutex> lock(latch_);
-  if (size < max_size_) {
-    while (cur_size_ > size) {
-      evict();
-    }
+  std::unique_lock<std::mutex> lock(latch_);
+  if (cur_size_ > size) {
+    evict_batch(cur_size_ - size);
+  }
+  // 空表直接重建；非空的表按新容量一次迁移到位，而不是之后再逐次翻倍
+  if (cur_size_ == 0) {
+    hash_table_.SetSize(size);
+  } else {
+    hash_table_.Reserve(size);
   }
-  hash_table_.SetSize(size);
   max_size_ = size;
+  if (ghost_tracking_) {
+    ghost_.Reset(size);
+  }
+#ifdef USE_BACKGROUND_EVICTION
+  update_watermarks();
+#endif
 #ifdef PRE_ALLOCATE
-  nodes_.resize(size);
-  free_list_.clear();
-  free_list_.reserve(size);
-  for (size_t i = 0; i < size; ++i) {
-    free_list_.push_back(i);
+  // 只扩充节点池，正在使用的节点保持不动
+  if (nodes_.size() < size) {
+    grow_pool(size);
   }
 #endif
+#ifdef USE_MIDPOINT_INSERTION
+  adjust_midpoint();
+#endif
+#ifdef USE_FLASH_TIER
+  admit_victims(lock);
+#endif
+}
+
+#ifdef USE_MIDPOINT_INSERTION
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::SetMidpoint(size_t old_percent, uint32_t dwell_ms) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  old_percent_ = std::min<size_t>(95, std::max<size_t>(5, old_percent));
+  dwell_ms_ = dwell_ms;
+  adjust_midpoint();
+}
+#endif
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::GetStats() -> ShardStats {
+  std::lock_guard<std::mutex> lock(latch_);
+  ShardStats stats;
+  stats.capacity_ = max_size_;
+  stats.size_ = cur_size_;
+  stats.evictions_ = evictions_;
+  stats.ghost_hits_ = ghost_hits_;
+#ifdef USE_COLD_TIER
+  stats.cold_size_ = cold_.Size();
+  stats.cold_bytes_ = cold_.Bytes();
+  stats.cold_hits_ = cold_hits_;
+#endif
+#ifdef USE_BACKGROUND_EVICTION
+  stats.background_evictions_ = background_evictions_;
+#endif
+  return stats;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::SetGhostTracking(bool enable) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  ghost_tracking_ = enable;
+  ghost_.Reset(enable ? max_size_ : 0);
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::ExportEntries(std::vector<std::pair<Key, Value>>& entries)
+    -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+#ifdef USE_COLD_TIER
+  // 冷池中的条目比 hot 链表中的都旧，排在最前面
+  entries.reserve(entries.size() + cur_size_ + cold_.Size());
+  cold_.ForEach([&](const Key& key, const Value& value) {
+    entries.emplace_back(key, value);
+  });
+#else
+  entries.reserve(entries.size() + cur_size_);
+#endif
+  for (LRUNode* node = tail_->prev_; node != head_; node = node->prev_) {
+    entries.emplace_back(node->key_.Load(), node->value_.Load());
+  }
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto LRUCACHE::evict() -> void {
-  LRUNode* last_node = tail_->prev_;
-  if (last_node == head_) {
+  LRUNode* victim = select_victim();
+  if (victim == nullptr) {
     return;
   }
+  detach_victim(victim);
 #ifdef PRE_ALLOCATE
-  remove_node(last_node);
-  release_node(last_node);
-  if (!hash_table_.Remove(last_node->key_)) {
+  release_node(victim);
+  if (!hash_table_.Remove(victim->key_.Load(), victim->hash_)) {
     // LRU_ERR("Failed to remove key from hash table");
   }
-  cur_size_--;
 #else
-  remove_node(last_node);
-  if (!hash_table_.Remove(last_node->key_)) {
+  if (!hash_table_.Remove(victim->key_.Load(), victim->hash_)) {
     // LRU_ERR("Failed to remove key from hash table");
   }
-  cur_size_--;
-  delete last_node;
+  delete victim;
 #endif
-  
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::evict_batch(size_t count) -> size_t {
+  // 先把节点逐个摘下链表，最后一次性从哈希表删除。在那之前节点只放回
+  // free_list_，持有 latch_ 期间不会被复用；非 PRE_ALLOCATE 时最后才释放
+  evict_keys_.clear();
+  evict_hashes_.clear();
+  size_t evicted = 0;
+  while (evicted < count) {
+    LRUNode* victim = select_victim();
+    if (victim == nullptr) {
+      break;
+    }
+    detach_victim(victim);
+    evict_keys_.push_back(victim->key_.Load());
+    evict_hashes_.push_back(victim->hash_);
+#ifdef PRE_ALLOCATE
+    release_node(victim);
+#else
+    evict_nodes_.push_back(victim);
+#endif
+    evicted++;
+  }
+  hash_table_.RemoveBatch(evict_keys_, evict_hashes_);
+#ifndef PRE_ALLOCATE
+  for (LRUNode* node : evict_nodes_) {
+    delete node;
+  }
+  evict_nodes_.clear();
+#endif
+  return evicted;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::select_victim() -> LRUNode* {
+  LRUNode* last_node = tail_->prev_;
+  if (last_node == head_) {
+    return nullptr;
+  }
+#ifdef USE_SIEVE
+  // hand 从上次停下的位置继续向 head_ 方向扫描，清除访问标记，
+  // 淘汰第一个未被访问过的节点
+  if (hand_ != nullptr) {
+    last_node = hand_;
+  }
+  while (last_node->visited_.load(std::memory_order_relaxed)) {
+    last_node->visited_.store(false, std::memory_order_relaxed);
+    last_node = last_node->prev_;
+    if (last_node == head_) {
+      last_node = tail_->prev_;
+    }
+  }
+  // remove_node 会把 hand 移到被淘汰节点的前一个节点
+  hand_ = last_node;
+#endif
+  return last_node;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::detach_victim(LRUNode* last_node) -> void {
+  evictions_++;
+  if (ghost_tracking_) {
+    ghost_.Push(last_node->hash_);
+  }
+#ifdef USE_COLD_TIER
+  if (cold_budget_ > 0) {
+    cold_push(last_node->key_.Load(), last_node->hash_, last_node->value_.Load());
+  } else if (removal_queue_ != nullptr) {
+    removal_queue_->Push(last_node->key_.Load(), last_node->value_.Load(),
+                         RemovalReason::kSize);
+  }
+#else
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(last_node->key_.Load(), last_node->value_.Load(),
+                         RemovalReason::kSize);
+  }
+#endif
+#ifdef USE_HOT_KEY_CACHE
+  // 热点副本只在 Find 命中分片时填充，离开分片后不能再从副本返回
+  if (hot_keys_ != nullptr) {
+    hot_keys_->Invalidate(last_node->key_.Load(), last_node->hash_);
+  }
+#endif
+#ifdef USE_FLASH_TIER
+  // Admit 要拿 FlashTier 的全局 latch_，留到释放分片 latch_ 之后由
+  // admit_victims 完成。这段时间内的 Find 会短暂未命中
+  if (flash_ != nullptr) {
+    flash_victims_.push_back(
+        {last_node->key_.Load(), last_node->hash_, last_node->value_.Load()});
+  }
+#endif
+  remove_node(last_node);
+  cur_size_--;
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
@@ -227,10 +563,27 @@ auto LRUCACHE::push_node(LRUNode* node) -> void {
   node->next_ = ori_first;
   node->prev_ = head_;
   head_->next_ = node;
+#ifdef USE_MIDPOINT_INSERTION
+  node->old_ = false;
+#endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto LRUCACHE::remove_node(LRUNode* node) -> void {
+#ifdef USE_SIEVE
+  if (node == hand_) {
+    hand_ = node->prev_ == head_ ? nullptr : node->prev_;
+  }
+#endif
+#ifdef USE_MIDPOINT_INSERTION
+  if (node == midpoint_) {
+    midpoint_ = node->next_;
+  }
+  if (node->old_) {
+    node->old_ = false;
+    old_size_--;
+  }
+#endif
   LRUNode* ori_next = node->next_;
   LRUNode* ori_prev = node->prev_;
   ori_next->prev_ = ori_prev;
@@ -240,17 +593,214 @@ auto LRUCACHE::remove_node(LRUNode* node) -> void {
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
-auto LRUCACHE::remove_helper(const Key& key, LRUNode* del_node) -> bool {
+auto LRUCACHE::remove_helper(const Key& key, size_t hash, LRUNode* del_node)
+    -> bool {
   remove_node(del_node);
-  hash_table_.Remove(key);
+  hash_table_.Remove(key, hash);
 #ifdef PRE_ALLOCATE
   release_node(del_node);
 #else
   delete del_node;
 #endif
   cur_size_--;
+#ifdef USE_MIDPOINT_INSERTION
+  adjust_midpoint();
+#endif
   return true;
 }
+
+#ifdef USE_MIDPOINT_INSERTION
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::push_old(LRUNode* node) -> void {
+  // 插入到 old 子链表的头部，即 midpoint_ 之前
+  LRUNode* ori_prev = midpoint_->prev_;
+  ori_prev->next_ = node;
+  node->prev_ = ori_prev;
+  node->next_ = midpoint_;
+  midpoint_->prev_ = node;
+  midpoint_ = node;
+  node->old_ = true;
+  node->old_time_ = now_ms();
+  old_size_++;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::adjust_midpoint() -> void {
+  // 每次操作最多让 old 子链表的长度变化一两个节点，这里只需要把分界点
+  // 前后移动几步，不需要重新链接节点。允许一个节点的误差避免来回抖动
+  while (old_size_ * 100 < cur_size_ * old_percent_ &&
+         midpoint_->prev_ != head_) {
+    midpoint_ = midpoint_->prev_;
+    midpoint_->old_ = true;
+    // 与 push_old 相同，进入 old 时重新开始计算停留时间
+    midpoint_->old_time_ = now_ms();
+    old_size_++;
+  }
+  while (old_size_ * 100 > cur_size_ * old_percent_ + 100 &&
+         midpoint_ != tail_) {
+    midpoint_->old_ = false;
+    midpoint_ = midpoint_->next_;
+    old_size_--;
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::now_ms() const -> uint32_t {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - epoch_)
+          .count());
+}
+#endif
+
+#ifdef USE_BACKGROUND_EVICTION
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::SetWatermarks(size_t low_percent, size_t high_percent) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  high_percent_ = std::min<size_t>(100, high_percent);
+  low_percent_ = std::min(low_percent, high_percent_);
+  update_watermarks();
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::EvictToLowWatermark() -> size_t {
+  size_t total = 0;
+  while (true) {
+    std::unique_lock<std::mutex> lock(latch_);
+    size_t evicted = 0;
+    if (high_mark_ > 0 && cur_size_ > low_mark_) {
+      evicted = evict_batch(std::min(kEvictBatch, cur_size_ - low_mark_));
+#ifdef USE_MIDPOINT_INSERTION
+      adjust_midpoint();
+#endif
+    }
+    if (evicted == 0) {
+      // 和 insert_helper 一样在 latch_ 下修改，不会覆盖并发插入设置的 true
+      above_high_.store(false, std::memory_order_relaxed);
+      return total;
+    }
+    background_evictions_ += evicted;
+    total += evicted;
+#ifdef USE_FLASH_TIER
+    admit_victims(lock);
+#endif
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::update_watermarks() -> void {
+  if (high_percent_ == 0) {
+    low_mark_ = 0;
+    high_mark_ = 0;
+    above_high_.store(false, std::memory_order_relaxed);
+    return;
+  }
+  low_mark_ = max_size_ * low_percent_ / 100;
+  high_mark_ = std::max<size_t>(1, max_size_ * high_percent_ / 100);
+}
+#endif
+
+#ifdef USE_COLD_TIER
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::SetColdTier(size_t budget_bytes) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  cold_budget_ = budget_bytes;
+  cold_.Reset(budget_bytes, [this](const Key& key, const Value& value) {
+    cold_drop(key, value);
+  });
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::cold_push(const Key& key, size_t hash, const Value& value)
+    -> void {
+  cold_.Push(key, hash, value, [this](const Key& k, const Value& v) {
+    cold_drop(k, v);
+  });
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::cold_drop(const Key& key, const Value& value) -> void {
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, value, RemovalReason::kSize);
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::cold_erase(const Key& key, size_t hash,
+                          RemovalQueueType* notify) -> bool {
+  if (cold_.Size() == 0) {
+    return false;
+  }
+  if (notify == nullptr) {
+    return cold_.Erase(key, hash);
+  }
+  Value value;
+  if (!cold_.Take(key, hash, value)) {
+    return false;
+  }
+  notify->Push(key, value, RemovalReason::kExplicit);
+  return true;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::promote_cold(const Key& key, size_t hash, Value& value)
+    -> bool {
+  if (cold_.Size() == 0 || !cold_.Take(key, hash, value)) {
+    return false;
+  }
+  cold_hits_++;
+  // 重新插入 hot 链表头部，可能把 hot 的尾部挤进冷池
+  insert_helper(key, hash, value);
+  return true;
+}
+#endif
+
+#ifdef USE_FLASH_TIER
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::PromoteFromFlash(const Key& key, size_t hash,
+                                const Value& value, uint64_t offset) -> bool {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (flash_ == nullptr || !flash_->Indexed(key, hash, offset)) {
+    return false;
+  }
+  // flash 中的记录和提升后的值相同，保留索引项。提升之后立刻删除它的话，
+  // 如果这个 key 在这期间又被淘汰，会把刚写入的新索引项一起删掉。
+  // 并发的提升已经放回分片时不再插入
+  LRUNode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+    insert_helper(key, hash, value);
+  }
+  admit_victims(lock);
+  return true;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::flash_erase(const Key& key, size_t hash) -> bool {
+  if (flash_ == nullptr) {
+    return false;
+  }
+  std::lock_guard<std::mutex> admit_lock(flash_latch_);
+  return flash_->Remove(key, hash);
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::admit_victims(std::unique_lock<std::mutex>& lock) -> void {
+  if (flash_victims_.empty()) {
+    lock.unlock();
+    return;
+  }
+  FlashTierType* flash = flash_;
+  // 先拿到 flash_latch_ 再释放 latch_，见 flash_latch_ 的注释
+  std::lock_guard<std::mutex> admit_lock(flash_latch_);
+  flash_admitting_.swap(flash_victims_);
+  lock.unlock();
+  for (const auto& victim : flash_admitting_) {
+    flash->Admit(victim.key_, victim.hash_, victim.value_);
+  }
+  flash_admitting_.clear();
+}
+#endif
+
 #ifdef USE_BUFFER
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto LRUCACHE::InsertBuffer(LRUNode* buffer_head, LRUNode* buffer_tail)
@@ -261,7 +811,7 @@ auto LRUCACHE::InsertBuffer(LRUNode* buffer_head, LRUNode* buffer_tail)
   LRUNode* cur_node = head_->next_;
   while (cur_node != tail_) {
     LRUNode* next_node = cur_node->next_;
-    if (!hash_table_.Insert(cur_node->key_, cur_node)) {
+    if (!hash_table_.Insert(cur_node->key_.Load(), cur_node->hash_, cur_node)) {
       // If insertion fails, we need to remove the node from the list
       remove_node(cur_node);
       delete cur_node;
@@ -279,9 +829,9 @@ auto LRUCACHE::allocate_node() -> LRUNode* {
   if (free_list_.empty()) {
     return nullptr;  // No free nodes available
   }
-  size_t index = free_list_.back();
+  LRUNode* node = free_list_.back();
   free_list_.pop_back();
-  return &nodes_[index];
+  return node;
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
@@ -289,10 +839,22 @@ auto LRUCACHE::release_node(LRUNode* node) -> void {
   if (node == nullptr) {
     return;
   }
-  size_t index = node - &nodes_[0];
-  free_list_.push_back(index);
+  free_list_.push_back(node);
   node->next_ = nullptr;
   node->prev_ = nullptr;
+#ifdef USE_SIEVE
+  // 之前已经拿到这个节点的无锁 Find 校验时会失败
+  node->version_.fetch_add(2, std::memory_order_release);
+#endif
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto LRUCACHE::grow_pool(size_t size) -> void {
+  free_list_.reserve(size);
+  for (size_t i = nodes_.size(); i < size; ++i) {
+    nodes_.emplace_back();
+    free_list_.push_back(&nodes_.back());
+  }
 }
 #endif
 
@@ -301,11 +863,15 @@ auto LRUCACHE::release_node(LRUNode* node) -> void {
 //----------------------------------------
 
 LRUCACHE_TEMPLATE_ARGUMENTS
-SEGLRUCACHE::SegLRUCache(size_t capacity_per_seg) : lru_cache_() {
+SEGLRUCACHE::SegLRUCache(size_t capacity_per_seg)
+    : lru_cache_(), base_capacity_(capacity_per_seg) {
   for (size_t i = 0; i < segNum; ++i) {
     lru_cache_[i].Resize(capacity_per_seg);
 #ifdef USE_HASH_RESIZER
-    lru_cache_[i].SetResizer(&resizer_);
+    lru_cache_[i].SetResizer(&HashTableResizer::Instance());
+#endif
+#ifdef USE_HOT_KEY_CACHE
+    lru_cache_[i].SetHotKeyTable(&hot_keys_);
 #endif
 
 #ifdef USE_BUFFER
@@ -322,19 +888,140 @@ SEGLRUCACHE::SegLRUCache(size_t capacity_per_seg) : lru_cache_() {
   }
 }
 
+LRUCACHE_TEMPLATE_ARGUMENTS
+SEGLRUCACHE::~SegLRUCache() {
+  StopRebalancer();
+  StopRemovalNotifier();
+#ifdef USE_BACKGROUND_EVICTION
+  StopEvictor();
+#endif
+#ifdef USE_ACCESS_TRACE
+  StopAccessTrace();
+#endif
+}
+
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHE::Find(const Key& key, Value& value) -> bool {
-  int32_t hash = SegHash(key);
-  if (lru_cache_[Shard(hash)].Find(key, value)) {
-    // hit_count_++;
+  // 整个操作只算这一次 hash，分片、分片内的桶和热点副本都用它
+  size_t hash = SegHash(key);
+  mrc_.Record(hash);
+  bool found = find_hashed(key, hash, value);
+  // 从冷池或 flash 提升回分片时可能淘汰别的条目
+  drain_if_needed(Shard(hash));
+#ifdef USE_ACCESS_TRACE
+  tracer_.Record(AccessOp::kFind, hash, Shard(hash), found);
+#endif
+  return found;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::FindBatch(const Key* keys, size_t count, Value* values,
+                            bool* found) -> size_t {
+  std::vector<size_t> hashes(count);
+  size_t hits = 0;
+  HashKeys<Key, Hash>(keys, count, hashes.data());
+  for (size_t i = 0; i < count; ++i) {
+    mrc_.Record(hashes[i]);
+    found[i] = find_memory(keys[i], hashes[i], values[i]);
+    if (found[i]) {
+      hits++;
+    }
+  }
+#ifdef USE_FLASH_TIER
+  if (hits < count && flash_.IsOpen()) {
+    // DRAM 未命中的 key 一起交给 flash 层，读盘只提交一次
+    std::vector<Key> miss_keys;
+    std::vector<size_t> miss_hashes;
+    std::vector<size_t> miss_idx;
+    for (size_t i = 0; i < count; ++i) {
+      if (!found[i]) {
+        miss_keys.push_back(keys[i]);
+        miss_hashes.push_back(hashes[i]);
+        miss_idx.push_back(i);
+      }
+    }
+    std::vector<Value> miss_values(miss_keys.size());
+    std::vector<uint64_t> offsets(miss_keys.size());
+    std::unique_ptr<bool[]> miss_found(new bool[miss_keys.size()]);
+    flash_.FindBatch(miss_keys.data(), miss_hashes.data(), miss_keys.size(),
+                     miss_values.data(), offsets.data(), miss_found.get());
+    for (size_t j = 0; j < miss_idx.size(); ++j) {
+      size_t i = miss_idx[j];
+      // 和 find_flash 一样，由分片确认读到的记录没有被 Remove 或覆盖
+      if (miss_found[j] &&
+          lru_cache_[Shard(hashes[i])].PromoteFromFlash(
+              keys[i], hashes[i], miss_values[j], offsets[j])) {
+        values[i] = miss_values[j];
+        found[i] = true;
+        hits++;
+      }
+    }
+  }
+#endif
+  for (uint32_t i = 0; i < segNum; ++i) {
+    drain_if_needed(i);
+  }
+#ifdef USE_ACCESS_TRACE
+  for (size_t i = 0; i < count; ++i) {
+    tracer_.Record(AccessOp::kFind, hashes[i], Shard(hashes[i]), found[i]);
+  }
+#endif
+  return hits;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::find_hashed(const Key& key, size_t hash, Value& value)
+    -> bool {
+  if (find_memory(key, hash, value)) {
+    return true;
+  }
+#ifdef USE_FLASH_TIER
+  return find_flash(key, hash, value);
+#else
+  return false;
+#endif
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::find_memory(const Key& key, size_t hash, Value& value)
+    -> bool {
+  ShardType& shard = lru_cache_[Shard(hash)];
+#ifdef USE_HOT_KEY_CACHE
+  // 热点 key 直接从只读副本返回，不碰分片的 latch_。被抽样的命中仍然访问
+  // 一次分片，刷新它在分片里的位置；分片已经淘汰了它时让副本一起失效
+  uint32_t fill_version;
+  bool sampled = hot_keys_.Record(key);
+  if (hot_keys_.Find(key, hash, value, fill_version)) {
+    if (sampled && !shard.Find(key, hash, value)) {
+      hot_keys_.Invalidate(key, hash);
+      return false;
+    }
+    return true;
+  }
+  if (shard.Find(key, hash, value)) {
+    hot_keys_.Fill(key, hash, value, fill_version);
     return true;
   }
   return false;
+#else
+  return shard.Find(key, hash, value);
+#endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHE::Insert(const Key& key, Value value) -> bool {
-  uint32_t shard_idx = Shard(SegHash(key));
+  size_t hash = SegHash(key);
+  bool inserted = insert_hashed(key, hash, value);
+#ifdef USE_ACCESS_TRACE
+  tracer_.Record(AccessOp::kInsert, hash, Shard(hash), inserted);
+#endif
+  return inserted;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::insert_hashed(const Key& key, size_t hash, const Value& value)
+    -> bool {
+  uint32_t shard_idx = Shard(hash);
 #ifdef USE_BUFFER
   std::unique_lock<std::mutex> lock(buffer_latch_[shard_idx]);
   if (buffer_size_[shard_idx] >= buffer_capacity_[shard_idx]) {
@@ -346,7 +1033,7 @@ auto SEGLRUCACHE::Insert(const Key& key, Value value) -> bool {
     buffer_size_[shard_idx] = 0;  // Reset buffer size after flushing
   }
   // Insert into the buffer
-  LRUNode* new_node = new LRUNode(key, value);
+  LRUNode* new_node = new LRUNode(key, hash, value);
   LRUNode* ori_first = buffer_[shard_idx]->next_;
   ori_first->prev_ = new_node;
   new_node->next_ = ori_first;
@@ -355,14 +1042,32 @@ auto SEGLRUCACHE::Insert(const Key& key, Value value) -> bool {
   buffer_size_[shard_idx]++;
   return true;
 #else
-  return lru_cache_[shard_idx].Insert(key, value);
+  bool inserted = lru_cache_[shard_idx].Insert(key, hash, value);
+  drain_if_needed(shard_idx);
+#ifdef USE_BACKGROUND_EVICTION
+  if (lru_cache_[shard_idx].AboveHighWatermark()) {
+    wake_evictor();
+  }
+#endif
+#ifdef USE_HOT_KEY_CACHE
+  hot_keys_.Invalidate(key, hash);
+#endif
+  return inserted;
 #endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHE::Remove(const Key& key) -> bool {
-  int32_t hash = SegHash(key);
-  return lru_cache_[Shard(hash)].Remove(key);
+  size_t hash = SegHash(key);
+  bool removed = lru_cache_[Shard(hash)].Remove(key, hash);
+  drain_if_needed(Shard(hash));
+#ifdef USE_HOT_KEY_CACHE
+  hot_keys_.Invalidate(key, hash);
+#endif
+#ifdef USE_ACCESS_TRACE
+  tracer_.Record(AccessOp::kRemove, hash, Shard(hash), removed);
+#endif
+  return removed;
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
@@ -379,18 +1084,31 @@ auto SEGLRUCACHE::Clear() -> void {
   for (size_t i = 0; i < segNum; ++i) {
     lru_cache_[i].Clear();
   }
+#ifdef USE_HOT_KEY_CACHE
+  hot_keys_.Clear();
+#endif
+#ifdef USE_FLASH_TIER
+  flash_.Clear();
+#endif
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHE::Resize(size_t size) -> void {
-  for (size_t i = 0; i < segNum; ++i) {
+  std::lock_guard<std::mutex> lock(rebalance_latch_);
+  base_capacity_ = size;
+  for (uint32_t i = 0; i < segNum; ++i) {
     lru_cache_[i].Resize(size);
+    drain_if_needed(i);
   }
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHE::Capacity() -> size_t {
-  return lru_cache_[0].Capacity() * segNum;
+  size_t capacity = 0;
+  for (size_t i = 0; i < segNum; ++i) {
+    capacity += lru_cache_[i].Capacity();
+  }
+  return capacity;
 }
 
 LRUCACHE_TEMPLATE_ARGUMENTS
@@ -422,6 +1140,515 @@ auto SEGLRUCACHE::GetHis_Miss() -> void {
   //        100);
 }
 
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::GetStats() -> ShardStats {
+  ShardStats stats;
+  for (size_t i = 0; i < segNum; ++i) {
+    stats += lru_cache_[i].GetStats();
+  }
+  return stats;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::GetShardStats(uint32_t shard) -> ShardStats {
+  return lru_cache_[shard].GetStats();
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::GetChainStats() -> ChainStats {
+  ChainStats stats;
+  for (size_t i = 0; i < segNum; ++i) {
+    stats += lru_cache_[i].GetChainStats();
+  }
+  return stats;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::GetShardChainStats(uint32_t shard) -> ChainStats {
+  return lru_cache_[shard].GetChainStats();
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::SetGhostTracking(bool enable) -> void {
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetGhostTracking(enable);
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::SetMrcTracking(bool enable) -> void {
+  if (enable) {
+    mrc_.Start(Capacity());
+  } else {
+    mrc_.Stop();
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::GetMissRatioCurve() -> MissRatioCurve {
+  return mrc_.Curve(Capacity());
+}
+
+#ifdef USE_COLD_TIER
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::SetColdTier(size_t budget_bytes_per_seg) -> void {
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetColdTier(budget_bytes_per_seg);
+  }
+}
+#endif
+
+#ifdef USE_ACCESS_TRACE
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StartAccessTrace(const std::string& path,
+                                   uint32_t sample_rate,
+                                   std::chrono::milliseconds flush_interval)
+    -> bool {
+  return tracer_.Start(path, sample_rate, segNum, flush_interval);
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StopAccessTrace() -> void { tracer_.Stop(); }
+#endif
+
+#ifdef USE_FLASH_TIER
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::OpenFlashTier(const std::string& path, size_t capacity_bytes)
+    -> bool {
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetFlashTier(nullptr);
+  }
+  if (!flash_.Open(path, capacity_bytes)) {
+    return false;
+  }
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetFlashTier(&flash_);
+  }
+  return true;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::find_flash(const Key& key, size_t hash, Value& value)
+    -> bool {
+  uint64_t offset;
+  if (!flash_.Find(key, hash, value, &offset)) {
+    return false;
+  }
+  // pread 期间不持有分片 latch_，由分片确认这条记录没有被 Remove 或覆盖
+  return lru_cache_[Shard(hash)].PromoteFromFlash(key, hash, value, offset);
+}
+#endif
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::Rebalance() -> void {
+  std::lock_guard<std::mutex> lock(rebalance_latch_);
+  ShardStats stats[segNum];
+  size_t gain[segNum];
+  size_t evictions[segNum];
+  size_t idle[segNum];
+  for (uint32_t i = 0; i < segNum; ++i) {
+    stats[i] = lru_cache_[i].GetStats();
+    gain[i] = stats[i].ghost_hits_ - last_ghost_hits_[i];
+    last_ghost_hits_[i] = stats[i].ghost_hits_;
+    evictions[i] = stats[i].evictions_ - last_evictions_[i];
+    last_evictions_[i] = stats[i].evictions_;
+    idle[i] = stats[i].capacity_ > stats[i].size_
+                  ? stats[i].capacity_ - stats[i].size_
+                  : 0;
+  }
+
+  size_t step = std::max<size_t>(1, base_capacity_ / kRebalanceStep);
+  size_t min_capacity =
+      std::max<size_t>(1, base_capacity_ / kMinCapacityDivisor);
+  // 接收方：上一轮有淘汰且没有空闲容量的分片，ghost 命中多的（多给容量
+  // 收益大）优先，其次是淘汰多的
+  uint32_t receivers[segNum];
+  size_t num_receivers = 0;
+  for (uint32_t i = 0; i < segNum; ++i) {
+    if (evictions[i] > 0 && idle[i] < step) {
+      receivers[num_receivers++] = i;
+    }
+  }
+  std::sort(receivers, receivers + num_receivers, [&](uint32_t a, uint32_t b) {
+    if (gain[a] != gain[b]) {
+      return gain[a] > gain[b];
+    }
+    return evictions[a] > evictions[b];
+  });
+  // 供给方：先是空闲容量多的分片，再是淘汰少、ghost 命中少的分片
+  uint32_t donors[segNum];
+  for (uint32_t i = 0; i < segNum; ++i) {
+    donors[i] = i;
+  }
+  std::sort(donors, donors + segNum, [&](uint32_t a, uint32_t b) {
+    if (idle[a] != idle[b]) {
+      return idle[a] > idle[b];
+    }
+    if (evictions[a] != evictions[b]) {
+      return evictions[a] < evictions[b];
+    }
+    return gain[a] < gain[b];
+  });
+
+  size_t next_donor = 0;
+  for (size_t r = 0; r < num_receivers; ++r) {
+    uint32_t receiver = receivers[r];
+    while (next_donor < segNum &&
+           (donors[next_donor] == receiver ||
+            stats[donors[next_donor]].capacity_ < min_capacity + step)) {
+      next_donor++;
+    }
+    if (next_donor == segNum) {
+      return;
+    }
+    uint32_t donor = donors[next_donor];
+    // 空闲容量可以直接移走；否则只在淘汰压力和收益都差两倍以上时移动，
+    // 避免容量来回抖动。之后的供给方只会更忙，不用再看
+    if (idle[donor] < step && (evictions[receiver] <= 2 * evictions[donor] ||
+                               gain[receiver] <= 2 * gain[donor])) {
+      return;
+    }
+    // 先缩小再扩大，任何时刻总容量都不超过预算
+    lru_cache_[donor].Resize(stats[donor].capacity_ - step);
+    drain_if_needed(donor);
+    lru_cache_[receiver].Resize(stats[receiver].capacity_ + step);
+    next_donor++;
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StartRebalancer(std::chrono::milliseconds interval)
+    -> void {
+  if (rebalancer_.joinable()) {
+    return;
+  }
+  SetGhostTracking(true);
+  rebalancer_stop_ = false;
+  rebalancer_ = std::thread([this, interval] {
+    std::unique_lock<std::mutex> lock(rebalancer_latch_);
+    while (!rebalancer_cv_.wait_for(lock, interval,
+                                    [this] { return rebalancer_stop_; })) {
+      lock.unlock();
+      Rebalance();
+      lock.lock();
+    }
+  });
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StopRebalancer() -> void {
+  {
+    std::lock_guard<std::mutex> lock(rebalancer_latch_);
+    rebalancer_stop_ = true;
+  }
+  rebalancer_cv_.notify_all();
+  if (rebalancer_.joinable()) {
+    rebalancer_.join();
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::SetRemovalListener(RemovalListener listener,
+                                     size_t queue_capacity,
+                                     RemovalOverflow overflow) -> void {
+  std::lock_guard<std::mutex> lock(removal_latch_);
+  // 先断开所有生产者，之后才能重置队列
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetRemovalQueue(nullptr);
+  }
+  removal_listener_ = std::move(listener);
+  if (!removal_listener_) {
+    return;
+  }
+  for (size_t i = 0; i < segNum; ++i) {
+    removal_queues_[i].Reset(std::max<size_t>(1, queue_capacity), overflow);
+    lru_cache_[i].SetRemovalQueue(&removal_queues_[i]);
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::DrainRemovals() -> size_t {
+  std::lock_guard<std::mutex> lock(removal_latch_);
+  if (!removal_listener_) {
+    return 0;
+  }
+  // listener 里调用缓存时不再进入 drain_if_needed，removal_latch_ 不可重入
+  struct DrainingScope {
+    DrainingScope() { draining() = true; }
+    ~DrainingScope() { draining() = false; }
+  } scope;
+  size_t drained = 0;
+  RemovalRecord<Key, Value> record;
+  for (size_t i = 0; i < segNum; ++i) {
+    // 每个分片最多处理一轮队列容量，生产者持续写入时也能返回
+    size_t budget = removal_queues_[i].Capacity();
+    while (budget > 0 && removal_queues_[i].Pop(record)) {
+      removal_listener_(record);
+      drained++;
+      budget--;
+    }
+    // 环形队列取空之后才处理溢出的记录，它们都比队列里的晚
+    if (budget > 0 && removal_queues_[i].TakeOverflow(removal_overflow_)) {
+      for (const auto& overflowed : removal_overflow_) {
+        removal_listener_(overflowed);
+        drained++;
+      }
+      removal_overflow_.clear();
+    }
+  }
+  return drained;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::drain_if_needed(uint32_t shard) -> void {
+  if (removal_queues_[shard].NeedsDrain() && !draining()) {
+    DrainRemovals();
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StartRemovalNotifier(std::chrono::milliseconds interval)
+    -> void {
+  if (removal_notifier_.joinable()) {
+    return;
+  }
+  removal_notifier_stop_ = false;
+  removal_notifier_ = std::thread([this, interval] {
+    std::unique_lock<std::mutex> lock(removal_notifier_latch_);
+    while (!removal_notifier_cv_.wait_for(
+        lock, interval, [this] { return removal_notifier_stop_; })) {
+      lock.unlock();
+      DrainRemovals();
+      lock.lock();
+    }
+    lock.unlock();
+    DrainRemovals();
+  });
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StopRemovalNotifier() -> void {
+  {
+    std::lock_guard<std::mutex> lock(removal_notifier_latch_);
+    removal_notifier_stop_ = true;
+  }
+  removal_notifier_cv_.notify_all();
+  if (removal_notifier_.joinable()) {
+    removal_notifier_.join();
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::DroppedRemovals() -> size_t {
+  size_t dropped = 0;
+  for (size_t i = 0; i < segNum; ++i) {
+    dropped += removal_queues_[i].Dropped();
+  }
+  return dropped;
+}
+
+#ifdef USE_BACKGROUND_EVICTION
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StartEvictor(size_t low_percent, size_t high_percent)
+    -> void {
+  if (evictor_.joinable()) {
+    return;
+  }
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetWatermarks(low_percent, high_percent);
+  }
+  evictor_stop_ = false;
+  evictor_ = std::thread([this] {
+    std::unique_lock<std::mutex> lock(evictor_latch_);
+    while (true) {
+      evictor_cv_.wait_for(lock, kEvictorInterval, [this] {
+        return evictor_stop_ || evictor_wakeup_.load();
+      });
+      if (evictor_stop_) {
+        break;
+      }
+      // 先清除再扫描，扫描期间越过高水位的分片会再唤醒一次
+      evictor_wakeup_.store(false);
+      lock.unlock();
+      for (size_t i = 0; i < segNum; ++i) {
+        if (lru_cache_[i].AboveHighWatermark()) {
+          lru_cache_[i].EvictToLowWatermark();
+          drain_if_needed(i);
+        }
+      }
+      lock.lock();
+    }
+  });
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::StopEvictor() -> void {
+  {
+    std::lock_guard<std::mutex> lock(evictor_latch_);
+    evictor_stop_ = true;
+  }
+  evictor_cv_.notify_all();
+  if (evictor_.joinable()) {
+    evictor_.join();
+  }
+  for (size_t i = 0; i < segNum; ++i) {
+    lru_cache_[i].SetWatermarks(0, 0);
+  }
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::wake_evictor() -> void {
+  // 先读一次，超过高水位期间的大量插入不会在同一个 cache line 上做 RMW
+  if (evictor_wakeup_.load(std::memory_order_relaxed) ||
+      evictor_wakeup_.exchange(true)) {
+    return;
+  }
+  // 持有 evictor_latch_ 通知，线程检查完条件、进入等待之前不会错过
+  std::lock_guard<std::mutex> lock(evictor_latch_);
+  evictor_cv_.notify_one();
+}
+#endif
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::SaveSnapshot(const std::string& path) -> bool {
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_trivially_copyable<Value>::value,
+                "snapshots copy keys and values byte by byte");
+  std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  SnapshotHeader header;
+  std::memcpy(header.magic_, kSnapshotMagic, sizeof(header.magic_));
+  header.version_ = kSnapshotVersion;
+  header.num_shards_ = segNum;
+  header.key_size_ = sizeof(Key);
+  header.value_size_ = sizeof(Value);
+
+  const size_t entry_size = sizeof(Key) + sizeof(Value);
+  uint64_t counts[segNum] = {0};
+  off_t offset = sizeof(header) + sizeof(counts);
+  bool ok = true;
+  std::vector<std::pair<Key, Value>> entries;
+  std::vector<char> buffer;
+  for (size_t i = 0; i < segNum && ok; ++i) {
+    entries.clear();
+    lru_cache_[i].ExportEntries(entries);
+    buffer.resize(entries.size() * entry_size);
+    char* cur = buffer.data();
+    for (const auto& entry : entries) {
+      std::memcpy(cur, &entry.first, sizeof(Key));
+      std::memcpy(cur + sizeof(Key), &entry.second, sizeof(Value));
+      cur += entry_size;
+    }
+    ok = pwrite_all(fd, buffer.data(), buffer.size(), offset);
+    offset += buffer.size();
+    counts[i] = entries.size();
+  }
+  ok = ok && pwrite_all(fd, &header, sizeof(header), 0) &&
+       pwrite_all(fd, counts, sizeof(counts), sizeof(header)) &&
+       fsync(fd) == 0;
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+LRUCACHE_TEMPLATE_ARGUMENTS
+auto SEGLRUCACHE::LoadSnapshot(const std::string& path) -> bool {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+    close(fd);
+    return false;
+  }
+  size_t file_size = st.st_size;
+  void* mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  madvise(mapped, file_size, MADV_SEQUENTIAL);
+  const char* base = static_cast<const char*>(mapped);
+
+  SnapshotHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  const size_t entry_size = sizeof(Key) + sizeof(Value);
+  size_t table_end =
+      sizeof(header) + static_cast<size_t>(header.num_shards_) *
+                           sizeof(uint64_t);
+  bool ok = std::memcmp(header.magic_, kSnapshotMagic,
+                        sizeof(header.magic_)) == 0 &&
+            header.version_ == kSnapshotVersion &&
+            header.key_size_ == sizeof(Key) &&
+            header.value_size_ == sizeof(Value) && header.num_shards_ > 0 &&
+            table_end <= file_size;
+  // 每个分片的起始偏移，顺便检查文件是否完整
+  std::vector<size_t> begins;
+  std::vector<uint64_t> counts;
+  if (ok) {
+    counts.resize(header.num_shards_);
+    std::memcpy(counts.data(), base + sizeof(header),
+                counts.size() * sizeof(uint64_t));
+    size_t offset = table_end;
+    for (uint64_t count : counts) {
+      begins.push_back(offset);
+      if (count > (file_size - offset) / entry_size) {
+        ok = false;
+        break;
+      }
+      offset += count * entry_size;
+    }
+  }
+  if (!ok) {
+    munmap(mapped, file_size);
+    return false;
+  }
+
+  // 快照的分片数与当前相同时，每个线程只会写自己负责的分片
+  size_t num_threads = std::min<size_t>(
+      header.num_shards_,
+      std::max<unsigned>(1, std::thread::hardware_concurrency()));
+  std::vector<std::thread> loaders;
+  for (size_t t = 0; t < num_threads; ++t) {
+    loaders.emplace_back([&, t] {
+      // 每次取出 kLoadBatch 个 key 批量算 hash，再逐个插入
+      Key keys[kLoadBatch];
+      size_t hashes[kLoadBatch];
+      for (size_t shard = t; shard < counts.size(); shard += num_threads) {
+        const char* cur = base + begins[shard];
+        for (uint64_t i = 0; i < counts[shard]; i += kLoadBatch) {
+          size_t n = std::min<uint64_t>(kLoadBatch, counts[shard] - i);
+          for (size_t j = 0; j < n; ++j) {
+            std::memcpy(&keys[j], cur + j * entry_size, sizeof(Key));
+          }
+          HashKeys<Key, Hash>(keys, n, hashes);
+          for (size_t j = 0; j < n; ++j) {
+            Value value;
+            std::memcpy(&value, cur + sizeof(Key), sizeof(Value));
+            insert_hashed(keys[j], hashes[j], value);
+            cur += entry_size;
+          }
+        }
+      }
+    });
+  }
+  for (auto& loader : loaders) {
+    loader.join();
+  }
+  munmap(mapped, file_size);
+  return true;
+}
+
 template class LRUCache<KeyType, ValueType, HashType, KeyEqualType>;
 template class SegLRUCache<KeyType, ValueType, HashType, KeyEqualType>;
 
@@ -31,9 +31,9 @@ LRUCACHEHT::~LRUCacheHT() {
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
-auto LRUCACHEHT::Find(const Key& key, Value& value) -> bool {
+auto LRUCACHEHT::Find(const Key& key, size_t hash, Value& value) -> bool {
   LRUNode* cur_node;
-  if (!hash_table_.Get(key, cur_node)) {
+  if (!hash_table_.Get(key, hash, cur_node)) {
     return false;
   }
   value = cur_node->value_;
@@ -51,11 +51,12 @@ auto LRUCACHEHT::Find(const Key& key, Value& value) -> bool {
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
-auto LRUCACHEHT::Insert(const Key& key, const Value& value) -> bool {
+auto LRUCACHEHT::Insert(const Key& key, size_t hash, const Value& value)
+    -> bool {
   std::lock_guard<std::mutex> lock(latch_);
 
-  LRUNode* new_node = new LRUNode(key, value);
-  if (!hash_table_.Insert(key, new_node)) {
+  LRUNode* new_node = new LRUNode(key, hash, value);
+  if (!hash_table_.Insert(key, hash, new_node)) {
     delete new_node;
     return false;
   }
@@ -69,16 +70,16 @@ auto LRUCACHEHT::Insert(const Key& key, const Value& value) -> bool {
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
-auto LRUCACHEHT::Remove(const Key& key) -> bool {
+auto LRUCACHEHT::Remove(const Key& key, size_t hash) -> bool {
   LRUNode* cur_node;
-  if (!hash_table_.Get(key, cur_node)) {
+  if (!hash_table_.Get(key, hash, cur_node)) {
     return false;
   }
   std::lock_guard<std::mutex> lock(latch_);
   if (!cur_node->inList()) {
     return true;
   }
-  return remove_helper(key, cur_node);
+  return remove_helper(key, hash, cur_node);
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
@@ -120,7 +121,7 @@ auto LRUCACHEHT::evict() -> void {
     return;
   }
   remove_node(last_node);
-  if (!hash_table_.Remove(last_node->key_)) {
+  if (!hash_table_.Remove(last_node->key_, last_node->hash_)) {
     // LRU_ERR("Failed to remove key from hash table");
   }
   cur_size_--;
@@ -147,9 +148,10 @@ auto LRUCACHEHT::remove_node(LRUNode* node) -> void {
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
-auto LRUCACHEHT::remove_helper(const Key& key, LRUNode* del_node) -> bool {
+auto LRUCACHEHT::remove_helper(const Key& key, size_t hash, LRUNode* del_node)
+    -> bool {
   remove_node(del_node);
-  hash_table_.Remove(key);
+  hash_table_.Remove(key, hash);
   delete del_node;
   cur_size_--;
   return true;
@@ -164,7 +166,7 @@ SEGLRUCACHEHT::SegLRUCacheHT(size_t capacity) : lru_cache_() {
   for (size_t i = 0; i < segNum; ++i) {
     lru_cache_[i].Resize(capacity);
 #ifdef USE_HASH_RESIZER
-    lru_cache_[i].SetResizer(&resizer_);
+    lru_cache_[i].SetResizer(&HashTableResizer::Instance());
 #endif
   }
 }
@@ -183,8 +185,8 @@ SEGLRUCACHEHT::SegLRUCacheHT(size_t capacity) : lru_cache_() {
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHEHT::Find(const Key& key, Value& value) -> bool {
-  int32_t hash = SegHash(key);
-  if (lru_cache_[Shard(hash)].Find(key, value)) {
+  size_t hash = SegHash(key);
+  if (lru_cache_[Shard(hash)].Find(key, hash, value)) {
     hit_count_++;
     return true;
   } else {
@@ -195,14 +197,14 @@ auto SEGLRUCACHEHT::Find(const Key& key, Value& value) -> bool {
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHEHT::Insert(const Key& key, const Value& value) -> bool {
-  int32_t hash = SegHash(key);
-  return lru_cache_[Shard(hash)].Insert(key, value);
+  size_t hash = SegHash(key);
+  return lru_cache_[Shard(hash)].Insert(key, hash, value);
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
 auto SEGLRUCACHEHT::Remove(const Key& key) -> bool {
-  int32_t hash = SegHash(key);
-  return lru_cache_[Shard(hash)].Remove(key);
+  size_t hash = SegHash(key);
+  return lru_cache_[Shard(hash)].Remove(key, hash);
 }
 
 LRUCACHEHT_TEMPLATE_ARGUMENTS
@@ -0,0 +1,215 @@
+#include "mrc_estimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+
+namespace myLru {
+
+MrcEstimator::MrcEstimator(size_t max_keys)
+    : max_keys_(std::max<size_t>(1, max_keys)) {}
+
+auto MrcEstimator::Start(size_t base_capacity) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  bin_width_ = std::max(1.0, base_capacity * 10.0 / kBins);
+  histogram_.assign(kBins, 0);
+  overflow_ = 0;
+  sampled_refs_ = 0;
+  last_access_.clear();
+  last_access_.reserve(max_keys_ + 1);
+  fenwick_.assign(kTimeSlotsPerKey * max_keys_ + 1, 0);
+  next_time_ = 0;
+  by_tag_.clear();
+  for (auto& refs : refs_) {
+    refs.count_.store(0, std::memory_order_relaxed);
+  }
+  for (auto& stripe : stripes_) {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    stripe.samples_.clear();
+  }
+  threshold_.store(uint32_t(1) << kTagBits, std::memory_order_relaxed);
+  running_.store(true, std::memory_order_relaxed);
+}
+
+auto MrcEstimator::Stop() -> void {
+  running_.store(false, std::memory_order_relaxed);
+}
+
+auto MrcEstimator::record(uint64_t key_hash) -> void {
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  SampleStripe& stripe = stripes_[key_hash & (kRefStripes - 1)];
+  size_t buffered;
+  {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    stripe.samples_.push_back({key_hash, now});
+    buffered = stripe.samples_.size();
+  }
+  if (buffered < kBatchSamples) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    // 别的线程正在合并，它会一起取走这个分条；积压太多时才等待
+    if (buffered < kMaxBufferedSamples) {
+      return;
+    }
+    lock.lock();
+  }
+  merge_locked();
+}
+
+auto MrcEstimator::merge_locked() -> void {
+  pending_.clear();
+  for (auto& stripe : stripes_) {
+    std::lock_guard<std::mutex> stripe_lock(stripe.latch_);
+    pending_.insert(pending_.end(), stripe.samples_.begin(),
+                    stripe.samples_.end());
+    stripe.samples_.clear();
+  }
+  // 分条之间按时间交错，同一时间保持分条内的顺序
+  std::stable_sort(pending_.begin(), pending_.end(),
+                   [](const Sample& a, const Sample& b) {
+                     return a.time_ns_ < b.time_ns_;
+                   });
+  for (const Sample& sample : pending_) {
+    apply(sample.key_hash_);
+  }
+}
+
+auto MrcEstimator::apply(uint64_t key_hash) -> void {
+  uint32_t threshold = threshold_.load(std::memory_order_relaxed);
+  // 缓冲期间阈值可能已经降低
+  if (!running_.load(std::memory_order_relaxed) ||
+      tag_of(key_hash) >= threshold) {
+    return;
+  }
+  if (next_time_ + 1 == fenwick_.size()) {
+    compact();
+  }
+  double rate = static_cast<double>(threshold) / (uint32_t(1) << kTagBits);
+  sampled_refs_++;
+  auto it = last_access_.find(key_hash);
+  if (it != last_access_.end()) {
+    // 上次访问之后访问过的其他 key 数
+    size_t distance = last_access_.size() - fenwick_prefix(it->second);
+    double bin = distance / rate / bin_width_;
+    if (bin < kBins) {
+      histogram_[static_cast<size_t>(bin)] += 1;
+    } else {
+      overflow_ += 1;
+    }
+    fenwick_add(it->second, -1);
+    it->second = next_time_;
+  } else {
+    overflow_ += 1;
+    last_access_.emplace(key_hash, next_time_);
+    by_tag_.emplace(tag_of(key_hash), key_hash);
+  }
+  fenwick_add(next_time_++, 1);
+  if (last_access_.size() > max_keys_) {
+    lower_threshold();
+  }
+}
+
+auto MrcEstimator::fenwick_add(size_t pos, int32_t delta) -> void {
+  for (size_t i = pos + 1; i < fenwick_.size(); i += i & (~i + 1)) {
+    fenwick_[i] += delta;
+  }
+}
+
+// 时间 <= pos 的 key 数
+auto MrcEstimator::fenwick_prefix(size_t pos) const -> size_t {
+  size_t sum = 0;
+  for (size_t i = pos + 1; i > 0; i -= i & (~i + 1)) {
+    sum += fenwick_[i];
+  }
+  return sum;
+}
+
+auto MrcEstimator::compact() -> void {
+  std::vector<std::pair<uint32_t, uint64_t>> order;
+  order.reserve(last_access_.size());
+  for (const auto& [key_hash, time] : last_access_) {
+    order.emplace_back(time, key_hash);
+  }
+  std::sort(order.begin(), order.end());
+  std::fill(fenwick_.begin(), fenwick_.end(), 0);
+  next_time_ = 0;
+  for (const auto& [time, key_hash] : order) {
+    last_access_[key_hash] = next_time_;
+    fenwick_add(next_time_++, 1);
+  }
+}
+
+auto MrcEstimator::lower_threshold() -> void {
+  uint32_t old_threshold = threshold_.load(std::memory_order_relaxed);
+  uint32_t new_threshold = by_tag_.rbegin()->first;
+  while (!by_tag_.empty() && by_tag_.rbegin()->first >= new_threshold) {
+    auto last = std::prev(by_tag_.end());
+    untrack(last->second, last_access_[last->second]);
+    by_tag_.erase(last);
+  }
+  threshold_.store(new_threshold, std::memory_order_relaxed);
+  // 直方图里是按旧抽样率得到的样本数，换算成新抽样率下的
+  double scale = static_cast<double>(new_threshold) / old_threshold;
+  for (auto& count : histogram_) {
+    count *= scale;
+  }
+  overflow_ *= scale;
+}
+
+auto MrcEstimator::untrack(uint64_t key_hash, uint32_t time) -> void {
+  fenwick_add(time, -1);
+  last_access_.erase(key_hash);
+}
+
+auto MrcEstimator::Curve(size_t current_capacity) -> MissRatioCurve {
+  std::lock_guard<std::mutex> lock(latch_);
+  merge_locked();
+  MissRatioCurve curve;
+  curve.sample_rate_ = static_cast<double>(threshold_.load(
+                           std::memory_order_relaxed)) /
+                       (uint32_t(1) << kTagBits);
+  curve.sampled_refs_ = sampled_refs_;
+  size_t refs = 0;
+  for (const auto& stripe : refs_) {
+    refs += stripe.count_.load(std::memory_order_relaxed);
+  }
+  // cumulative[b] 是前 b 格的和
+  std::vector<double> cumulative(histogram_.size() + 1, 0);
+  for (size_t b = 0; b < histogram_.size(); ++b) {
+    cumulative[b + 1] = cumulative[b] + histogram_[b];
+  }
+  double total = cumulative.back() + overflow_;
+  // SHARDS_adj：样本数按抽样率应为 refs * R，差值算作距离最小的命中
+  double expected = refs * curve.sample_rate_;
+  if (!histogram_.empty() && expected > 0) {
+    double adjust = std::max(expected - total, -histogram_[0]);
+    for (size_t b = 1; b < cumulative.size(); ++b) {
+      cumulative[b] += adjust;
+    }
+    total += adjust;
+  }
+  int half = kCurvePoints / 2;
+  for (int k = -half; k <= half; ++k) {
+    size_t capacity = std::max<size_t>(
+        1, std::llround(current_capacity * std::pow(10.0, double(k) / half)));
+    double hits = 0;
+    if (!histogram_.empty()) {
+      // 栈距离小于 capacity 的访问命中，容量落在的那一格按比例计入
+      double bins = std::min<double>(capacity / bin_width_, histogram_.size());
+      size_t full = static_cast<size_t>(bins);
+      hits = cumulative[full];
+      if (full < histogram_.size()) {
+        hits += (cumulative[full + 1] - cumulative[full]) * (bins - full);
+      }
+    }
+    curve.points_.push_back({capacity, total > 0 ? hits / total : 0});
+  }
+  return curve;
+}
+
+}  // namespace myLru
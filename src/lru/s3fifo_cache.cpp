@@ -0,0 +1,300 @@
+#include "s3fifo_cache.h"
+
+#include <vector>
+namespace myLru {
+
+// ---------------------------------------
+//            S3FIFOCache
+//----------------------------------------
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+S3FIFOCACHE::S3FIFOCache() : max_size_(0), cur_size_(0) {}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+S3FIFOCACHE::S3FIFOCache(size_t size) : max_size_(0), cur_size_(0) {
+  Resize(size);
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+S3FIFOCACHE::~S3FIFOCache() { Clear(); }
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Find(const Key& key, size_t hash, Value& value) -> bool {
+  S3FIFONode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+    return false;
+  }
+  // 命中路径不持有 latch_，节点可能在读取期间被淘汰并复用，
+  // 用 version_ 做一次 seqlock 式的校验
+  uint32_t version = cur_node->version_.load(std::memory_order_acquire);
+  if (version & 1) {
+    return false;
+  }
+  value = cur_node->value_.Load();
+  bool same_key = KeyEqual()(cur_node->key_.Load(), key);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!same_key ||
+      cur_node->version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+
+  uint8_t freq = cur_node->freq_.load(std::memory_order_relaxed);
+  if (freq < kMaxFreq) {
+    cur_node->freq_.store(freq + 1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Insert(const Key& key, size_t hash, Value value) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (max_size_ == 0) {
+    return false;
+  }
+  while (cur_size_ >= max_size_ || free_list_.empty()) {
+    evict();
+  }
+
+  uint32_t idx = free_list_.back();
+  S3FIFONode* new_node = &nodes_[idx];
+  new_node->version_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  new_node->key_.Store(key);
+  new_node->value_.Store(value);
+  new_node->freq_.store(0, std::memory_order_relaxed);
+  new_node->removed_ = false;
+  new_node->version_.fetch_add(1, std::memory_order_release);
+
+  if (!hash_table_.Insert(key, hash, new_node)) {
+    return false;
+  }
+  free_list_.pop_back();
+
+  // 最近刚从 small 队列淘汰过的 key 再次插入时直接进入 main 队列
+  if (ghost_.Contains(hash)) {
+    ghost_hits_++;
+    new_node->queue_ = QueueId::kMain;
+    main_.Push(idx);
+  } else {
+    new_node->queue_ = QueueId::kSmall;
+    small_.Push(idx);
+  }
+  cur_size_++;
+  return true;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Remove(const Key& key, size_t hash) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (cur_size_ == 0) {
+    return false;
+  }
+  S3FIFONode* to_remove;
+  if (!hash_table_.Get(key, hash, to_remove)) {
+    return false;
+  }
+  if (to_remove == nullptr || to_remove->removed_ ||
+      !KeyEqual()(to_remove->key_.Load(), key)) {
+    return false;
+  }
+  hash_table_.Remove(key, hash);
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, to_remove->value_.Load(),
+                         RemovalReason::kExplicit);
+  }
+  // 节点留在所在队列中，等出队时再回收。先改版本号，Remove 之前已经
+  // 拿到这个节点的无锁 Find 校验时会失败，不会在 Remove 返回后读到旧值
+  to_remove->version_.fetch_add(2, std::memory_order_release);
+  to_remove->removed_ = true;
+  cur_size_--;
+  return true;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return cur_size_;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Clear() -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  hash_table_.Clear();
+  free_list_.clear();
+  free_list_.reserve(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    nodes_[i].queue_ = QueueId::kNone;
+    nodes_[i].removed_ = false;
+    free_list_.push_back(static_cast<uint32_t>(i));
+  }
+  small_.Reset(nodes_.size());
+  main_.Reset(nodes_.size());
+  ghost_.Clear();
+  cur_size_ = 0;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::Resize(size_t size) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  while (cur_size_ > size) {
+    evict();
+  }
+  if (cur_size_ == 0) {
+    hash_table_.SetSize(size);
+  } else {
+    hash_table_.Reserve(size);
+  }
+  max_size_ = size;
+  if (nodes_.size() < size) {
+    grow_pool(size);
+  }
+
+  // ghost 队列容量与 main 队列一致，保留最新的指纹
+  ghost_.Reset(ghost_capacity());
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::GetStats() -> ShardStats {
+  std::lock_guard<std::mutex> lock(latch_);
+  ShardStats stats;
+  stats.capacity_ = max_size_;
+  stats.size_ = cur_size_;
+  stats.evictions_ = evictions_;
+  stats.ghost_hits_ = ghost_hits_;
+  return stats;
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::ExportEntries(std::vector<std::pair<Key, Value>>& entries)
+    -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  entries.reserve(entries.size() + cur_size_);
+  for (const RingQueue* queue : {&small_, &main_}) {
+    for (size_t i = 0; i < queue->Size(); ++i) {
+      const S3FIFONode& node =
+          nodes_[queue->slots_[(queue->head_ + i) % queue->slots_.size()]];
+      if (!node.removed_) {
+        entries.emplace_back(node.key_.Load(), node.value_.Load());
+      }
+    }
+  }
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::evict() -> void {
+  if (small_.Empty() && main_.Empty()) {
+    return;
+  }
+  if (small_.Size() >= small_capacity() || main_.Empty()) {
+    evict_small();
+  } else {
+    evict_main();
+  }
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::evict_small() -> void {
+  while (!small_.Empty()) {
+    uint32_t idx = small_.Pop();
+    S3FIFONode* node = &nodes_[idx];
+    if (node->removed_) {
+      release_node(idx);
+      return;
+    }
+    if (node->freq_.load(std::memory_order_relaxed) > 1) {
+      node->freq_.store(0, std::memory_order_relaxed);
+      node->queue_ = QueueId::kMain;
+      main_.Push(idx);
+      continue;
+    }
+    Key key = node->key_.Load();
+    size_t hash = hash_function_(key);
+    ghost_.Push(hash);
+    evict_node(idx, key, hash);
+    return;
+  }
+  evict_main();
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::evict_main() -> void {
+  while (!main_.Empty()) {
+    uint32_t idx = main_.Pop();
+    S3FIFONode* node = &nodes_[idx];
+    if (node->removed_) {
+      release_node(idx);
+      return;
+    }
+    uint8_t freq = node->freq_.load(std::memory_order_relaxed);
+    if (freq > 0) {
+      node->freq_.store(freq - 1, std::memory_order_relaxed);
+      main_.Push(idx);
+      continue;
+    }
+    Key key = node->key_.Load();
+    evict_node(idx, key, hash_function_(key));
+    return;
+  }
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::grow_pool(size_t size) -> void {
+  size_t old_size = nodes_.size();
+  for (size_t i = old_size; i < size; ++i) {
+    nodes_.emplace_back();
+  }
+  // 新节点优先使用低下标，free_list_ 从尾部分配
+  std::vector<uint32_t> new_free;
+  new_free.reserve(free_list_.size() + size - old_size);
+  for (size_t i = size; i > old_size; --i) {
+    new_free.push_back(static_cast<uint32_t>(i - 1));
+  }
+  new_free.insert(new_free.end(), free_list_.begin(), free_list_.end());
+  free_list_ = std::move(new_free);
+
+  // 两个环形缓冲区都要能容纳整个节点池，保持原有出队顺序
+  for (RingQueue* queue : {&small_, &main_}) {
+    RingQueue grown;
+    grown.Reset(size);
+    while (!queue->Empty()) {
+      grown.Push(queue->Pop());
+    }
+    *queue = std::move(grown);
+  }
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::release_node(uint32_t idx) -> void {
+  S3FIFONode* node = &nodes_[idx];
+  node->version_.fetch_add(2, std::memory_order_release);
+  node->queue_ = QueueId::kNone;
+  node->removed_ = false;
+  free_list_.push_back(idx);
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::evict_node(uint32_t idx, const Key& key, size_t hash)
+    -> void {
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, nodes_[idx].value_.Load(), RemovalReason::kSize);
+  }
+#ifdef USE_HOT_KEY_CACHE
+  if (hot_keys_ != nullptr) {
+    hot_keys_->Invalidate(key, hash);
+  }
+#endif
+  hash_table_.Remove(key, hash);
+  cur_size_--;
+  evictions_++;
+  release_node(idx);
+}
+
+S3FIFOCACHE_TEMPLATE_ARGUMENTS
+auto S3FIFOCACHE::ghost_capacity() const -> size_t {
+  size_t small_cap = small_capacity();
+  return max_size_ > small_cap ? max_size_ - small_cap : 1;
+}
+
+template class S3FIFOCache<KeyType, ValueType, HashType, KeyEqualType>;
+
+};  // namespace myLru
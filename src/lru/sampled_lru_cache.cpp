@@ -0,0 +1,306 @@
+#include "sampled_lru_cache.h"
+
+#include <algorithm>
+#include <vector>
+namespace myLru {
+
+// ---------------------------------------
+//            SampledLRUCache
+//----------------------------------------
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+SAMPLEDLRUCACHE::SampledLRUCache() : max_size_(0), cur_size_(0) {}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+SAMPLEDLRUCACHE::SampledLRUCache(size_t size) : max_size_(0), cur_size_(0) {
+  Resize(size);
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+SAMPLEDLRUCACHE::~SampledLRUCache() { Clear(); }
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Find(const Key& key, size_t hash, Value& value)
+    -> bool {
+  SampledNode* cur_node;
+  if (!hash_table_.Get(key, hash, cur_node)) {
+    return false;
+  }
+  uint32_t version = cur_node->version_.load(std::memory_order_acquire);
+  if (version & kWriting) {
+    return false;
+  }
+  value = cur_node->value_.Load();
+  bool same_key = KeyEqual()(cur_node->key_.Load(), key);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!same_key ||
+      cur_node->version_.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+
+  uint32_t now = clock_.load(std::memory_order_relaxed);
+  if (cur_node->access_time_.load(std::memory_order_relaxed) != now) {
+    cur_node->access_time_.store(now, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Insert(const Key& key, size_t hash, Value value)
+    -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (max_size_ == 0) {
+    return false;
+  }
+  while (cur_size_ >= max_size_ || free_list_.empty()) {
+    evict();
+  }
+
+  SampledNode* new_node = free_list_.back();
+  uint32_t version = new_node->version_.load(std::memory_order_relaxed);
+  new_node->version_.store(version | kWriting, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  new_node->key_.Store(key);
+  new_node->value_.Store(value);
+  new_node->access_time_.store(
+      clock_.fetch_add(1, std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  version += kVersionStep;
+  new_node->version_.store(version | kOccupied, std::memory_order_release);
+
+  if (!hash_table_.Insert(key, hash, new_node)) {
+    new_node->version_.store(version, std::memory_order_relaxed);
+    return false;
+  }
+  free_list_.pop_back();
+  cur_size_++;
+  if (ghost_tracking_ && ghost_.Contains(hash)) {
+    ghost_hits_++;
+  }
+  return true;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Remove(const Key& key, size_t hash) -> bool {
+  std::lock_guard<std::mutex> lock(latch_);
+  if (cur_size_ == 0) {
+    return false;
+  }
+  SampledNode* to_remove;
+  if (!hash_table_.Get(key, hash, to_remove)) {
+    return false;
+  }
+  if (to_remove == nullptr || !occupied(*to_remove) ||
+      !KeyEqual()(to_remove->key_.Load(), key)) {
+    return false;
+  }
+  if (removal_queue_ != nullptr) {
+    removal_queue_->Push(key, to_remove->value_.Load(),
+                         RemovalReason::kExplicit);
+  }
+  evict_node(to_remove, hash);
+  return true;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Size() -> size_t {
+  std::lock_guard<std::mutex> lock(latch_);
+  return cur_size_;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Clear() -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  hash_table_.Clear();
+  free_list_.clear();
+  free_list_.reserve(nodes_.size());
+  for (size_t i = nodes_.size(); i > 0; --i) {
+    SampledNode& node = nodes_[i - 1];
+    uint32_t version = node.version_.load(std::memory_order_relaxed);
+    node.version_.store((version & ~kOccupied) + kVersionStep,
+                        std::memory_order_release);
+    free_list_.push_back(&node);
+  }
+  eviction_pool_.clear();
+  ghost_.Clear();
+  cur_size_ = 0;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::Resize(size_t size) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  while (cur_size_ > size) {
+    evict();
+  }
+  if (cur_size_ == 0) {
+    hash_table_.SetSize(size);
+  } else {
+    hash_table_.Reserve(size);
+  }
+  max_size_ = size;
+  if (nodes_.size() < size) {
+    grow_pool(size);
+  }
+  if (ghost_tracking_) {
+    ghost_.Reset(size);
+  }
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::GetStats() -> ShardStats {
+  std::lock_guard<std::mutex> lock(latch_);
+  ShardStats stats;
+  stats.capacity_ = max_size_;
+  stats.size_ = cur_size_;
+  stats.evictions_ = evictions_;
+  stats.ghost_hits_ = ghost_hits_;
+  return stats;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::SetGhostTracking(bool enable) -> void {
+  std::lock_guard<std::mutex> lock(latch_);
+  ghost_tracking_ = enable;
+  ghost_.Reset(enable ? max_size_ : 0);
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::ExportEntries(
+    std::vector<std::pair<Key, Value>>& entries) -> void {
+  // 按未访问的时长排序，时钟回绕后仍然成立
+  std::vector<std::pair<uint32_t, SampledNode*>> order;
+  std::lock_guard<std::mutex> lock(latch_);
+  uint32_t now = clock_.load(std::memory_order_relaxed);
+  order.reserve(cur_size_);
+  for (SampledNode& node : nodes_) {
+    if (occupied(node)) {
+      order.emplace_back(
+          now - node.access_time_.load(std::memory_order_relaxed), &node);
+    }
+  }
+  std::sort(order.begin(), order.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  entries.reserve(entries.size() + order.size());
+  for (const auto& item : order) {
+    entries.emplace_back(item.second->key_.Load(),
+                         item.second->value_.Load());
+  }
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::evict() -> void {
+  while (cur_size_ > 0) {
+    sample_into_pool();
+    // 从最旧的候选开始，跳过已被淘汰、复用或在入池后又被访问过的节点
+    while (!eviction_pool_.empty()) {
+      PoolEntry entry = eviction_pool_.front();
+      eviction_pool_.erase(eviction_pool_.begin());
+      SampledNode* node = entry.node_;
+      if (occupied(*node) && KeyEqual()(node->key_.Load(), entry.key_) &&
+          node->access_time_.load(std::memory_order_relaxed) ==
+              entry.access_time_) {
+        evictions_++;
+        // 节点里不保存 hash，这里算一次供下面所有地方使用
+        size_t hash = Hash()(entry.key_);
+        if (ghost_tracking_) {
+          ghost_.Push(hash);
+        }
+        if (removal_queue_ != nullptr) {
+          removal_queue_->Push(entry.key_, node->value_.Load(),
+                               RemovalReason::kSize);
+        }
+#ifdef USE_HOT_KEY_CACHE
+        if (hot_keys_ != nullptr) {
+          hot_keys_->Invalidate(entry.key_, hash);
+        }
+#endif
+        evict_node(node, hash);
+        return;
+      }
+    }
+  }
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::sample_into_pool() -> void {
+  // 节点池中可能有空闲槽位，最多尝试 kSampleSize 的 4 倍次
+  size_t sampled = 0;
+  for (size_t tries = 0; tries < 4 * kSampleSize && sampled < kSampleSize;
+       ++tries) {
+    SampledNode& node = nodes_[next_random() % nodes_.size()];
+    if (!occupied(node)) {
+      continue;
+    }
+    sampled++;
+    uint32_t access_time = node.access_time_.load(std::memory_order_relaxed);
+    if (eviction_pool_.size() == kEvictionPoolSize &&
+        !older(access_time, eviction_pool_.back().access_time_)) {
+      continue;
+    }
+    bool in_pool = false;
+    for (const PoolEntry& entry : eviction_pool_) {
+      if (entry.node_ == &node) {
+        in_pool = true;
+        break;
+      }
+    }
+    if (in_pool) {
+      continue;
+    }
+    auto pos = std::upper_bound(
+        eviction_pool_.begin(), eviction_pool_.end(), access_time,
+        [this](uint32_t t, const PoolEntry& e) {
+          return older(t, e.access_time_);
+        });
+    eviction_pool_.insert(pos,
+                          PoolEntry{&node, access_time, node.key_.Load()});
+    if (eviction_pool_.size() > kEvictionPoolSize) {
+      eviction_pool_.pop_back();
+    }
+  }
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::evict_node(SampledNode* node, size_t hash) -> void {
+  // 之前拿到这个节点的无锁 Find 校验会失败
+  uint32_t version = node->version_.load(std::memory_order_relaxed);
+  node->version_.store((version & ~kOccupied) + kVersionStep,
+                       std::memory_order_release);
+  hash_table_.Remove(node->key_.Load(), hash);
+  free_list_.push_back(node);
+  cur_size_--;
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::grow_pool(size_t size) -> void {
+  size_t old_size = nodes_.size();
+  for (size_t i = old_size; i < size; ++i) {
+    nodes_.emplace_back();
+  }
+  std::vector<SampledNode*> new_free;
+  new_free.reserve(free_list_.size() + size - old_size);
+  for (size_t i = size; i > old_size; --i) {
+    new_free.push_back(&nodes_[i - 1]);
+  }
+  new_free.insert(new_free.end(), free_list_.begin(), free_list_.end());
+  free_list_ = std::move(new_free);
+}
+
+SAMPLEDLRUCACHE_TEMPLATE_ARGUMENTS
+auto SAMPLEDLRUCACHE::next_random() -> uint64_t {
+  // xorshift64*，只在 latch_ 下调用
+  rng_state_ ^= rng_state_ >> 12;
+  rng_state_ ^= rng_state_ << 25;
+  rng_state_ ^= rng_state_ >> 27;
+  return rng_state_ * 0x2545F4914F6CDD1DULL;
+}
+
+template class SampledLRUCache<KeyType, ValueType, HashType, KeyEqualType>;
+
+// 节点头部只有 32 位的 access_time_ 和 version_
+static_assert(sizeof(SampledLRUCache<KeyType, ValueType, HashType,
+                                     KeyEqualType>::SampledNode) ==
+                  8 + sizeof(KeyType) + sizeof(ValueType),
+              "SampledNode header must stay at 8 bytes");
+
+};  // namespace myLru
@@ -0,0 +1,347 @@
+#include "shm_lru_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+namespace myLru {
+
+static auto round_up64(size_t size) -> size_t {
+  return (size + 63) & ~size_t(63);
+}
+
+// ---------------------------------------
+//            ShmSegLRUCache
+//----------------------------------------
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+SHMSEGLRUCACHE::ShmSegLRUCache(const std::string& name,
+                               size_t capacity_per_seg)
+    : name_(name),
+      capacity_per_seg_(capacity_per_seg == 0 ? 1 : capacity_per_seg) {
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_trivially_copyable<Value>::value,
+                "shared memory entries are copied byte by byte");
+  num_buckets_ = 1;
+  while (num_buckets_ < capacity_per_seg_) {
+    num_buckets_ <<= 1;
+  }
+  shard_stride_ = round_up64(sizeof(ShmShard)) +
+                  round_up64(num_buckets_ * sizeof(uint32_t)) +
+                  round_up64((capacity_per_seg_ + 2) * sizeof(ShmNode));
+  mapped_size_ = round_up64(sizeof(ShmHeader)) + shard_stride_ * segNum;
+
+  int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0) {
+    create(fd);
+  } else if (errno == EEXIST) {
+    fd = shm_open(name_.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("shm_open failed: " + name_);
+    }
+    attach(fd);
+  } else {
+    throw std::runtime_error("shm_open failed: " + name_);
+  }
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+SHMSEGLRUCACHE::~ShmSegLRUCache() {
+  if (base_ != nullptr) {
+    munmap(base_, mapped_size_);
+  }
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Unlink(const std::string& name) -> bool {
+  return shm_unlink(name.c_str()) == 0;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Find(const Key& key, Value& value) -> bool {
+  size_t hash = Hash()(key);
+  size_t idx = ShardOfHash(hash);
+  lock_shard(idx);
+  uint32_t node_idx = lookup(idx, key, hash);
+  if (node_idx == kNil) {
+    unlock_shard(idx);
+    return false;
+  }
+  ShmNode* pool = nodes(idx);
+  value = pool[node_idx].value_;
+  remove_node(pool, node_idx);
+  push_node(idx, pool, node_idx);
+  unlock_shard(idx);
+  return true;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Insert(const Key& key, Value value) -> bool {
+  size_t hash = Hash()(key);
+  size_t idx = ShardOfHash(hash);
+  lock_shard(idx);
+  if (lookup(idx, key, hash) != kNil) {
+    unlock_shard(idx);
+    return false;
+  }
+  ShmShard* s = shard(idx);
+  ShmNode* pool = nodes(idx);
+  if (s->size_ == capacity_per_seg_) {
+    uint32_t last = pool[s->tail_].prev_;
+    unlink_hash(idx, last, pool[last].hash_);
+    remove_node(pool, last);
+    free_node(idx, last);
+    s->size_--;
+  }
+  uint32_t node_idx = s->free_head_;
+  s->free_head_ = pool[node_idx].next_;
+  ShmNode& node = pool[node_idx];
+  node.key_ = key;
+  node.hash_ = static_cast<uint32_t>(hash);
+  node.value_ = value;
+  uint32_t& bucket = buckets(idx)[hash & (num_buckets_ - 1)];
+  node.hash_next_ = bucket;
+  bucket = node_idx;
+  push_node(idx, pool, node_idx);
+  s->size_++;
+  unlock_shard(idx);
+  return true;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Remove(const Key& key) -> bool {
+  size_t hash = Hash()(key);
+  size_t idx = ShardOfHash(hash);
+  lock_shard(idx);
+  uint32_t node_idx = lookup(idx, key, hash);
+  if (node_idx == kNil) {
+    unlock_shard(idx);
+    return false;
+  }
+  unlink_hash(idx, node_idx, hash);
+  remove_node(nodes(idx), node_idx);
+  free_node(idx, node_idx);
+  shard(idx)->size_--;
+  unlock_shard(idx);
+  return true;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Size() -> size_t {
+  size_t size = 0;
+  for (size_t i = 0; i < segNum; ++i) {
+    lock_shard(i);
+    size += shard(i)->size_;
+    unlock_shard(i);
+  }
+  return size;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::Clear() -> void {
+  for (size_t i = 0; i < segNum; ++i) {
+    lock_shard(i);
+    init_shard(i);
+    unlock_shard(i);
+  }
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::shard(size_t idx) -> ShmShard* {
+  return reinterpret_cast<ShmShard*>(base_ + round_up64(sizeof(ShmHeader)) +
+                                     idx * shard_stride_);
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::buckets(size_t idx) -> uint32_t* {
+  return reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(shard(idx)) +
+                                     round_up64(sizeof(ShmShard)));
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::nodes(size_t idx) -> ShmNode* {
+  return reinterpret_cast<ShmNode*>(
+      reinterpret_cast<char*>(buckets(idx)) +
+      round_up64(num_buckets_ * sizeof(uint32_t)));
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::create(int fd) -> void {
+  if (ftruncate(fd, mapped_size_) != 0) {
+    close(fd);
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("ftruncate failed: " + name_);
+  }
+  void* mapped =
+      mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    throw std::runtime_error("mmap failed: " + name_);
+  }
+  base_ = static_cast<char*>(mapped);
+
+  ShmHeader* h = header();
+  h->magic_ = kMagic;
+  h->num_shards_ = segNum;
+  h->key_size_ = sizeof(Key);
+  h->value_size_ = sizeof(Value);
+  h->capacity_per_seg_ = capacity_per_seg_;
+  h->num_buckets_ = num_buckets_;
+  h->shard_stride_ = shard_stride_;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  for (size_t i = 0; i < segNum; ++i) {
+    pthread_mutex_init(&shard(i)->latch_, &attr);
+    init_shard(i);
+  }
+  pthread_mutexattr_destroy(&attr);
+  // 其他进程看到 ready_ 之后才会访问分片
+  h->ready_.store(1, std::memory_order_release);
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::attach(int fd) -> void {
+  // 创建者可能还没有 ftruncate 或初始化完，最多等 5 秒；大小不同说明容量
+  // 参数不一致，直接失败
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  struct stat st;
+  while (fstat(fd, &st) == 0 && st.st_size == 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (static_cast<size_t>(st.st_size) != mapped_size_) {
+    close(fd);
+    throw std::runtime_error("shared memory layout mismatch: " + name_);
+  }
+  void* mapped =
+      mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("mmap failed: " + name_);
+  }
+  base_ = static_cast<char*>(mapped);
+
+  ShmHeader* h = header();
+  while (h->ready_.load(std::memory_order_acquire) == 0 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (h->ready_.load(std::memory_order_acquire) == 0 || h->magic_ != kMagic ||
+      h->num_shards_ != segNum || h->key_size_ != sizeof(Key) ||
+      h->value_size_ != sizeof(Value) ||
+      h->capacity_per_seg_ != capacity_per_seg_ ||
+      h->num_buckets_ != num_buckets_ || h->shard_stride_ != shard_stride_) {
+    munmap(base_, mapped_size_);
+    base_ = nullptr;
+    throw std::runtime_error("shared memory layout mismatch: " + name_);
+  }
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::init_shard(size_t idx) -> void {
+  ShmShard* s = shard(idx);
+  uint32_t* bucket = buckets(idx);
+  ShmNode* pool = nodes(idx);
+  for (size_t i = 0; i < num_buckets_; ++i) {
+    bucket[i] = kNil;
+  }
+  s->head_ = static_cast<uint32_t>(capacity_per_seg_);
+  s->tail_ = static_cast<uint32_t>(capacity_per_seg_ + 1);
+  pool[s->head_].next_ = s->tail_;
+  pool[s->head_].prev_ = kNil;
+  pool[s->tail_].prev_ = s->head_;
+  pool[s->tail_].next_ = kNil;
+  // 空闲节点通过 next_ 串起来
+  for (size_t i = 0; i < capacity_per_seg_; ++i) {
+    pool[i].next_ = i + 1 < capacity_per_seg_ ? static_cast<uint32_t>(i + 1)
+                                               : kNil;
+    pool[i].prev_ = kNil;
+    pool[i].hash_next_ = kNil;
+  }
+  s->free_head_ = 0;
+  s->size_ = 0;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::lock_shard(size_t idx) -> void {
+  pthread_mutex_t* latch = &shard(idx)->latch_;
+  int rc = pthread_mutex_lock(latch);
+  if (rc == EOWNERDEAD) {
+    // 上一个持锁进程死在临界区里，链表和哈希链可能不一致
+    init_shard(idx);
+    pthread_mutex_consistent(latch);
+  } else if (rc != 0) {
+    throw std::runtime_error("pthread_mutex_lock failed");
+  }
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::unlock_shard(size_t idx) -> void {
+  pthread_mutex_unlock(&shard(idx)->latch_);
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::lookup(size_t idx, const Key& key, size_t hash)
+    -> uint32_t {
+  ShmNode* pool = nodes(idx);
+  uint32_t cur = buckets(idx)[hash & (num_buckets_ - 1)];
+  while (cur != kNil && !KeyEqual()(pool[cur].key_, key)) {
+    cur = pool[cur].hash_next_;
+  }
+  return cur;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::unlink_hash(size_t idx, uint32_t node_idx, size_t hash)
+    -> void {
+  ShmNode* pool = nodes(idx);
+  uint32_t* link = &buckets(idx)[hash & (num_buckets_ - 1)];
+  while (*link != kNil && *link != node_idx) {
+    link = &pool[*link].hash_next_;
+  }
+  if (*link == node_idx) {
+    *link = pool[node_idx].hash_next_;
+  }
+  pool[node_idx].hash_next_ = kNil;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::remove_node(ShmNode* pool, uint32_t node_idx) -> void {
+  ShmNode& node = pool[node_idx];
+  pool[node.prev_].next_ = node.next_;
+  pool[node.next_].prev_ = node.prev_;
+  node.next_ = kNil;
+  node.prev_ = kNil;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::push_node(size_t idx, ShmNode* pool, uint32_t node_idx)
+    -> void {
+  uint32_t head = shard(idx)->head_;
+  uint32_t ori_first = pool[head].next_;
+  pool[ori_first].prev_ = node_idx;
+  pool[node_idx].next_ = ori_first;
+  pool[node_idx].prev_ = head;
+  pool[head].next_ = node_idx;
+}
+
+SHMSEGLRUCACHE_TEMPLATE_ARGUMENTS
+auto SHMSEGLRUCACHE::free_node(size_t idx, uint32_t node_idx) -> void {
+  ShmShard* s = shard(idx);
+  nodes(idx)[node_idx].next_ = s->free_head_;
+  s->free_head_ = node_idx;
+}
+
+template class ShmSegLRUCache<KeyType, ValueType, HashType, KeyEqualType>;
+
+};  // namespace myLru
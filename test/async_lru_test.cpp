@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "async_lru_cache.h"
+
+namespace myLru {
+
+ValueType generateValueForKey(KeyType key) {
+  ValueType value{};
+  std::memcpy(value.data(), &key, sizeof(KeyType));
+  return value;
+}
+
+// 立即开始、不可等待的顶层协程，用来在测试里发起请求
+struct Detached {
+  struct promise_type {
+    auto get_return_object() -> Detached { return {}; }
+    auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+    auto final_suspend() noexcept -> std::suspend_never { return {}; }
+    auto return_void() -> void {}
+    auto unhandled_exception() -> void { std::terminate(); }
+  };
+};
+
+// 单线程事件循环，Yield 把当前协程放回队尾，模拟等待后端 I/O
+class EventLoop {
+ public:
+  auto Schedule(std::coroutine_handle<> handle) -> void {
+    ready_.push_back(handle);
+  }
+
+  auto Run() -> void {
+    while (!ready_.empty()) {
+      std::coroutine_handle<> handle = ready_.front();
+      ready_.pop_front();
+      handle.resume();
+    }
+  }
+
+  auto Yield() {
+    struct YieldAwaiter {
+      EventLoop* loop_;
+      auto await_ready() noexcept -> bool { return false; }
+      auto await_suspend(std::coroutine_handle<> handle) -> void {
+        loop_->Schedule(handle);
+      }
+      auto await_resume() noexcept -> void {}
+    };
+    return YieldAwaiter{this};
+  }
+
+ private:
+  std::deque<std::coroutine_handle<>> ready_;
+};
+
+using AsyncCache = AsyncSegLRUCache<KeyType, ValueType>;
+
+TEST(AsyncSegLRUCacheTest, FindInsertRemove) {
+  AsyncCache cache(16);
+  bool done = false;
+  [](AsyncCache& cache, bool& done) -> Detached {
+    EXPECT_FALSE((co_await cache.FindAsync(1)).has_value());
+    EXPECT_TRUE(co_await cache.InsertAsync(1, generateValueForKey(1)));
+    std::optional<ValueType> value = co_await cache.FindAsync(1);
+    EXPECT_TRUE(value.has_value());
+    if (value) {
+      EXPECT_EQ(*value, generateValueForKey(1));
+    }
+    EXPECT_TRUE(co_await cache.RemoveAsync(1));
+    EXPECT_FALSE(co_await cache.RemoveAsync(1));
+    EXPECT_FALSE((co_await cache.FindAsync(1)).has_value());
+    done = true;
+  }(cache, done);
+  EXPECT_TRUE(done);
+}
+
+TEST(AsyncSegLRUCacheTest, GetOrLoadSingleFlight) {
+  EventLoop loop;
+  AsyncCache cache(16, [&loop](std::coroutine_handle<> h) { loop.Schedule(h); });
+  int loads = 0;
+  int completed = 0;
+  auto loader = [&loop, &loads](KeyType key) -> Task<ValueType> {
+    loads++;
+    // 让出若干次，保证其余请求在加载完成之前到达
+    for (int i = 0; i < 3; ++i) {
+      co_await loop.Yield();
+    }
+    co_return generateValueForKey(key);
+  };
+  auto request = [](AsyncCache& cache, decltype(loader)& loader,
+                    int& completed) -> Detached {
+    ValueType value = co_await cache.GetOrLoadAsync(42, loader);
+    EXPECT_EQ(value, generateValueForKey(42));
+    completed++;
+  };
+  for (int i = 0; i < 10; ++i) {
+    request(cache, loader, completed);
+  }
+  loop.Run();
+  EXPECT_EQ(completed, 10);
+  EXPECT_EQ(loads, 1);
+
+  // 已经在缓存中，不再调用 loader
+  request(cache, loader, completed);
+  loop.Run();
+  EXPECT_EQ(completed, 11);
+  EXPECT_EQ(loads, 1);
+}
+
+TEST(AsyncSegLRUCacheTest, GetOrLoadPropagatesError) {
+  EventLoop loop;
+  AsyncCache cache(16, [&loop](std::coroutine_handle<> h) { loop.Schedule(h); });
+  auto loader = [&loop](KeyType) -> Task<ValueType> {
+    co_await loop.Yield();
+    throw std::runtime_error("backend down");
+  };
+  int failed = 0;
+  auto request = [](AsyncCache& cache, decltype(loader)& loader,
+                    int& failed) -> Detached {
+    try {
+      co_await cache.GetOrLoadAsync(7, loader);
+    } catch (const std::runtime_error&) {
+      failed++;
+    }
+  };
+  for (int i = 0; i < 4; ++i) {
+    request(cache, loader, failed);
+  }
+  loop.Run();
+  EXPECT_EQ(failed, 4);
+  ValueType value;
+  EXPECT_FALSE(cache.Cache().Find(7, value));
+}
+
+TEST(AsyncSegLRUCacheTest, ConcurrentThreads) {
+  const int num_threads = 4;
+  const int ops_per_thread = 50000;
+  const KeyType key_range = 4096;
+  AsyncCache cache(key_range / segNum + 1);
+  std::atomic<int> errors{0};
+  std::atomic<int> completed{0};
+
+  auto worker = [](AsyncCache& cache, int seed, int ops, KeyType range,
+                   std::atomic<int>& errors,
+                   std::atomic<int>& completed) -> Detached {
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<KeyType> dist(0, range - 1);
+    for (int i = 0; i < ops; ++i) {
+      KeyType key = dist(gen);
+      if (i % 4 == 0) {
+        co_await cache.InsertAsync(key, generateValueForKey(key));
+      } else {
+        std::optional<ValueType> value = co_await cache.FindAsync(key);
+        if (value && *value != generateValueForKey(key)) {
+          errors++;
+        }
+      }
+    }
+    completed++;
+  };
+
+  // 没有 scheduler，被挂起的协程在释放锁的线程上恢复
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      worker(cache, t + 1, ops_per_thread, key_range, errors, completed);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // 最后一次交接可能发生在别的线程上，等所有协程都结束
+  while (completed.load() < num_threads) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(errors.load(), 0);
+}
+
+TEST(AsyncSegLRUCacheTest, EventLoopBenchmark) {
+  const int num_requests = 200000;
+  const int concurrency = 256;
+  const KeyType key_range = 20000;
+  EventLoop loop;
+  AsyncCache cache(key_range / 2 / segNum + 1,
+                   [&loop](std::coroutine_handle<> h) { loop.Schedule(h); });
+  int loads = 0;
+  int next = 0;
+  auto loader = [&loop, &loads](KeyType key) -> Task<ValueType> {
+    loads++;
+    co_await loop.Yield();
+    co_return generateValueForKey(key);
+  };
+  std::mt19937_64 gen(2024);
+  std::uniform_int_distribution<KeyType> dist(0, key_range - 1);
+
+  // 每个客户端协程串行地发请求，所有客户端共享一个线程
+  auto client = [&]() -> Detached {
+    while (next < num_requests) {
+      next++;
+      KeyType key = dist(gen);
+      ValueType value = co_await cache.GetOrLoadAsync(key, loader);
+      EXPECT_EQ(value, generateValueForKey(key));
+    }
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < concurrency; ++i) {
+    client();
+  }
+  loop.Run();
+  auto end = std::chrono::high_resolution_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+  EXPECT_EQ(next, num_requests);
+
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "Coroutine clients: " << concurrency << std::endl;
+  std::cout << "Loader calls: " << loads << std::endl;
+  // 合并到同一次加载上的请求也算命中
+  std::cout << "Hit Ratio: "
+            << static_cast<double>(num_requests - loads) / num_requests * 100
+            << "%"
+            << std::endl;
+  std::cout << "Throughput: " << num_requests / seconds << " ops/sec"
+            << std::endl;
+}
+
+}  // namespace myLru
@@ -1,18 +1,36 @@
 #include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <list>
 #include <numeric>
 #include <random>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "access_trace.h"
+#include "epoch.h"
+#include "hash_batch.h"
 #include "lru_cache.h"
 #include "lru_cache_ht.h"
+#include "mrc_estimator.h"
+#include "shm_lru_cache.h"
 
 namespace myLru {  // Using your namespace
 
@@ -228,6 +246,1673 @@ TEST(SegLRUCacheMultiThreadTest, RandomizedMixedOperations) {
   EXPECT_GT(ops_per_thread * num_threads, 0);
 }
 
+// keys[s] holds the first want[s] non-negative keys that SegLRUCache::ShardOf
+// (and ShmSegLRUCache, which shards the same way) maps to shard s.
+static auto keysByShard(const std::vector<size_t>& want)
+    -> std::vector<std::vector<KeyType>> {
+  std::vector<std::vector<KeyType>> keys(segNum);
+  size_t filled = 0;
+  for (uint32_t i = 0; i < segNum; ++i) {
+    filled += want[i] == 0 ? 1 : 0;
+  }
+  for (KeyType key = 0; filled < segNum; ++key) {
+    uint32_t shard = SegLRUCache<KeyType, ValueType>::ShardOf(key);
+    if (keys[shard].size() < want[shard]) {
+      keys[shard].push_back(key);
+      if (keys[shard].size() == want[shard]) {
+        filled++;
+      }
+    }
+  }
+  return keys;
+}
+
+// Shard 0 gets a working set twice its capacity, the other shards a quarter.
+static auto skewedKeys(size_t capacity_per_segment)
+    -> std::vector<std::vector<KeyType>> {
+  std::vector<size_t> want(segNum, capacity_per_segment / 4);
+  want[0] = 2 * capacity_per_segment;
+  return keysByShard(want);
+}
+
+static auto runSkewedRound(SegLRUCache<KeyType, ValueType>& cache,
+                           const std::vector<std::vector<KeyType>>& keys,
+                           int round) -> std::pair<int, int> {
+  std::atomic<int> hit_count(0);
+  std::atomic<int> miss_count(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      std::mt19937_64 rng(COMMON_BASE_SEED + round * threadNum + i);
+      std::uniform_int_distribution<size_t> shard_dist(0, segNum - 1);
+      for (int j = 0; j < 4000; ++j) {
+        const std::vector<KeyType>& pool = keys[shard_dist(rng)];
+        KeyType key = pool[rng() % pool.size()];
+        ValueType value;
+        if (cache.Find(key, value)) {
+          hit_count++;
+        } else {
+          miss_count++;
+          cache.Insert(key, generateValueForKey(key));
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  return {hit_count.load(), miss_count.load()};
+}
+
+TEST(SegLRUCacheMultiThreadTest, RebalanceSkewedShards) {
+  const size_t capacity_per_segment = 256;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  cache.SetGhostTracking(true);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  auto keys = skewedKeys(capacity_per_segment);
+  auto before = runSkewedRound(cache, keys, 0);
+  std::pair<int, int> after;
+  for (int round = 1; round <= 20; ++round) {
+    cache.Rebalance();
+    after = runSkewedRound(cache, keys, round);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  printEvaluationResult("Skewed Shards After Rebalance (SegLRUCache)",
+                        after.first, after.second, start, end,
+                        after.first + after.second);
+
+  EXPECT_EQ(cache.Capacity(), capacity_per_segment * segNum);
+  EXPECT_GT(cache.GetShardStats(0).capacity_, capacity_per_segment);
+  for (uint32_t i = 1; i < segNum; ++i) {
+    EXPECT_GE(cache.GetShardStats(i).capacity_, capacity_per_segment / 4);
+  }
+  double before_ratio =
+      static_cast<double>(before.first) / (before.first + before.second);
+  double after_ratio =
+      static_cast<double>(after.first) / (after.first + after.second);
+  EXPECT_GT(after_ratio, before_ratio);
+}
+
+// --- 不打开 ghost 统计时，空闲分片的容量也会移给有淘汰的分片 ---
+TEST(SegLRUCacheMultiThreadTest, RebalanceMovesIdleCapacity) {
+  const size_t capacity_per_segment = 256;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  auto keys = skewedKeys(capacity_per_segment);
+  for (int round = 0; round < 10; ++round) {
+    runSkewedRound(cache, keys, round);
+    cache.Rebalance();
+  }
+  EXPECT_EQ(cache.Capacity(), capacity_per_segment * segNum);
+  EXPECT_GT(cache.GetShardStats(0).capacity_, capacity_per_segment);
+  for (uint32_t i = 1; i < segNum; ++i) {
+    EXPECT_GE(cache.GetShardStats(i).capacity_, keys[i].size());
+  }
+}
+
+TEST(SegLRUCacheMultiThreadTest, BackgroundRebalancer) {
+  const size_t capacity_per_segment = 256;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  auto keys = skewedKeys(capacity_per_segment);
+  cache.StartRebalancer(std::chrono::milliseconds(1));
+  for (int round = 0; round < 5; ++round) {
+    runSkewedRound(cache, keys, round);
+  }
+  cache.StopRebalancer();
+
+  EXPECT_EQ(cache.Capacity(), capacity_per_segment * segNum);
+  ShardStats stats = cache.GetStats();
+  EXPECT_LE(stats.size_, stats.capacity_);
+  EXPECT_GT(stats.ghost_hits_, 0);
+}
+
+// --- Zipf 0.99 Find-heavy workload, throughput as the thread count grows ---
+TEST(SegLRUCacheMultiThreadTest, ZipfThreadScaling) {
+  const size_t key_space = testsNum * size_ratio;
+  const int ops_per_thread = 200000;
+  std::vector<double> weights(key_space);
+  for (size_t i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+  }
+  std::discrete_distribution<KeyType> zipf(weights.begin(), weights.end());
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  // 预先生成 key，计时只包含缓存操作
+  std::vector<KeyType> trace(ops_per_thread * threadNum);
+  for (auto& key : trace) {
+    key = zipf(rng);
+  }
+
+  for (int num_threads = 1; num_threads <= threadNum; num_threads *= 2) {
+    SegLRUCache<KeyType, ValueType> cache(key_space * size_ratio / segNum);
+    std::atomic<int> hit_count(0);
+    std::atomic<int> miss_count(0);
+    std::atomic<int> wrong_values(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        const KeyType* keys = trace.data() + i * ops_per_thread;
+        for (int j = 0; j < ops_per_thread; ++j) {
+          ValueType value;
+          if (cache.Find(keys[j], value)) {
+            hit_count++;
+            if (value != generateValueForKey(keys[j])) {
+              wrong_values++;
+            }
+          } else {
+            miss_count++;
+            cache.Insert(keys[j], generateValueForKey(keys[j]));
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    printEvaluationResult(
+        "Zipf 0.99 with " + std::to_string(num_threads) + " threads",
+        hit_count.load(), miss_count.load(), start, end,
+        static_cast<long long>(ops_per_thread) * num_threads);
+    EXPECT_EQ(wrong_values.load(), 0);
+    EXPECT_GT(hit_count.load(), miss_count.load());
+  }
+}
+
+#ifdef USE_COLD_TIER
+// --- 同一条 Zipf trace、相同内存下比较冷池和单纯加大 hot 容量 ---
+TEST(SegLRUCacheMultiThreadTest, ColdTierHitRatioTradeoff) {
+  const size_t key_space = testsNum * size_ratio;
+  const int ops_per_thread = 200000;
+  const size_t capacity_per_segment = key_space * size_ratio / segNum / 2;
+  // hot 条目的内存：LRUNode，加上 MyHashTable 节点（key、节点指针、hash、
+  // next）和一个桶指针，不计 malloc 头，对 hot-only 偏宽
+  const size_t hot_entry_bytes =
+      sizeof(LRUCache<KeyType, ValueType>::LRUNode) + sizeof(KeyType) +
+      3 * sizeof(void*) + sizeof(void*);
+  // 冷池预算约等于再给一份 hot 的内存
+  const size_t budget = capacity_per_segment * hot_entry_bytes;
+  std::vector<double> weights(key_space);
+  for (size_t i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+  }
+  std::discrete_distribution<KeyType> zipf(weights.begin(), weights.end());
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  std::vector<KeyType> trace(ops_per_thread * threadNum);
+  for (auto& key : trace) {
+    key = zipf(rng);
+  }
+
+  struct Config {
+    std::string name_;
+    size_t capacity_;
+    size_t budget_;
+  };
+  const Config configs[] = {
+      {"Hot only", capacity_per_segment, 0},
+      {"Hot + cold tier " + std::to_string(budget) + " bytes/shard",
+       capacity_per_segment, budget},
+      {"Hot only, same memory", capacity_per_segment + budget / hot_entry_bytes,
+       0},
+  };
+  double hit_ratio[3];
+  for (int c = 0; c < 3; ++c) {
+    SegLRUCache<KeyType, ValueType> cache(configs[c].capacity_);
+    cache.SetColdTier(configs[c].budget_);
+    std::atomic<int> hit_count(0);
+    std::atomic<int> miss_count(0);
+    std::atomic<int> wrong_values(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < threadNum; ++i) {
+      threads.emplace_back([&, i]() {
+        const KeyType* keys = trace.data() + i * ops_per_thread;
+        for (int j = 0; j < ops_per_thread; ++j) {
+          ValueType value;
+          if (cache.Find(keys[j], value)) {
+            hit_count++;
+            if (value != generateValueForKey(keys[j])) {
+              wrong_values++;
+            }
+          } else {
+            miss_count++;
+            cache.Insert(keys[j], generateValueForKey(keys[j]));
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    printEvaluationResult(configs[c].name_, hit_count.load(),
+                          miss_count.load(), start, end,
+                          static_cast<long long>(ops_per_thread) * threadNum);
+    ShardStats stats = cache.GetStats();
+    std::cout << "Hot entries: " << stats.size_
+              << ", cold entries: " << stats.cold_size_
+              << ", cold bytes: " << stats.cold_bytes_;
+    if (stats.cold_size_ > 0) {
+      std::cout << " (" << stats.cold_bytes_ / stats.cold_size_
+                << " B/entry vs " << hot_entry_bytes << " B/hot entry)";
+    }
+    std::cout << ", cold hits: " << stats.cold_hits_ << std::endl;
+    EXPECT_EQ(wrong_values.load(), 0);
+    EXPECT_LE(stats.cold_bytes_, configs[c].budget_ * segNum);
+    hit_ratio[c] = static_cast<double>(hit_count.load()) /
+                   (hit_count.load() + miss_count.load());
+  }
+  EXPECT_GT(hit_ratio[1], hit_ratio[0]);
+  // 同样多的内存，冷池每条目更小，能留住更多条目
+  EXPECT_GT(hit_ratio[1], hit_ratio[2]);
+}
+#endif
+
+#ifdef USE_HOT_KEY_CACHE
+TEST(SegLRUCacheMultiThreadTest, HotKeyInvalidation) {
+  SegLRUCache<KeyType, ValueType> cache(64);
+  const KeyType hot_key = 42;
+  ASSERT_TRUE(cache.Insert(hot_key, generateValueForKey(hot_key)));
+  for (KeyType i = 0; i < 16; ++i) {
+    cache.Insert(1000 + i, generateValueForKey(1000 + i));
+  }
+  ValueType value;
+  for (int i = 0; i < 100000; ++i) {
+    KeyType key = (i % 4 == 0) ? 1000 + (i / 4) % 16 : hot_key;
+    ASSERT_TRUE(cache.Find(key, value));
+    ASSERT_EQ(value, generateValueForKey(key));
+  }
+  EXPECT_TRUE(cache.IsHotKey(hot_key));
+
+  // 副本必须随 Remove/Insert 失效
+  ASSERT_TRUE(cache.Remove(hot_key));
+  EXPECT_FALSE(cache.Find(hot_key, value));
+  ASSERT_TRUE(cache.Insert(hot_key, generateValueForKey(7)));
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(cache.Find(hot_key, value));
+    ASSERT_EQ(value, generateValueForKey(7));
+  }
+  cache.Clear();
+  EXPECT_FALSE(cache.Find(hot_key, value));
+}
+
+// --- 热点副本被并发读取时，写线程反复更新和删除热点 key ---
+// 每个值的所有字节相同，读到新旧混合的值说明 seqlock 没有丢弃撕裂的读取；
+// 在 ENABLE_TSAN 构建下同时检查副本的读写不构成数据竞争
+TEST(SegLRUCacheMultiThreadTest, HotKeyConcurrentUpdate) {
+  SegLRUCache<KeyType, ValueType> cache(64);
+  const KeyType hot_key = 42;
+  auto valueOf = [](int round) {
+    ValueType value;
+    value.fill(static_cast<char>('a' + round % 4));
+    return value;
+  };
+  ASSERT_TRUE(cache.Insert(hot_key, valueOf(0)));
+  ValueType value;
+  for (int i = 0; i < 100000; ++i) {
+    ASSERT_TRUE(cache.Find(hot_key, value));
+  }
+  ASSERT_TRUE(cache.IsHotKey(hot_key));
+
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&]() {
+      ValueType got;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (cache.Find(hot_key, got) &&
+            (got[0] < 'a' || got[0] > 'd' ||
+             std::count(got.begin(), got.end(), got[0]) !=
+                 static_cast<long>(got.size()))) {
+          torn.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (int round = 1; round <= 20000; ++round) {
+    if (round % 8 == 0) {
+      cache.Remove(hot_key);
+    }
+    cache.Insert(hot_key, valueOf(round));
+  }
+  stop.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(torn.load(), 0);
+  ASSERT_TRUE(cache.Find(hot_key, value));
+  EXPECT_EQ(value, valueOf(20000));
+}
+
+#if !defined(USE_LFU) && !defined(USE_S3FIFO) && !defined(USE_SIEVE) && \
+    !defined(USE_MIDPOINT_INSERTION) && !defined(USE_COLD_TIER) &&      \
+    !defined(USE_FLASH_TIER)
+// 其他策略会留住访问过的 key，冷池和 flash 层仍能找到被淘汰的 key
+// --- 分片因容量淘汰热点 key 后，副本不能再返回它 ---
+TEST(SegLRUCacheMultiThreadTest, HotKeyEvictionInvalidates) {
+  const size_t capacity_per_segment = 64;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  const KeyType hot_key = 42;
+  ASSERT_TRUE(cache.Insert(hot_key, generateValueForKey(hot_key)));
+  ValueType value;
+  for (int i = 0; i < 100000; ++i) {
+    ASSERT_TRUE(cache.Find(hot_key, value));
+  }
+  ASSERT_TRUE(cache.IsHotKey(hot_key));
+
+  // 只往热点 key 所在的分片插入，不再访问它，直到它被淘汰
+  std::vector<size_t> want(segNum, 0);
+  want[cache.ShardOf(hot_key)] = capacity_per_segment * 20;
+  auto keys = keysByShard(want);
+  for (KeyType key : keys[cache.ShardOf(hot_key)]) {
+    if (key != hot_key) {
+      cache.Insert(key, generateValueForKey(key));
+    }
+  }
+  EXPECT_FALSE(cache.Find(hot_key, value));
+}
+#endif
+#endif
+
+TEST(SegLRUCacheMultiThreadTest, RemovalListenerReasons) {
+  const size_t capacity_per_segment = 8;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  std::vector<RemovalRecord<KeyType, ValueType>> records;
+  cache.SetRemovalListener(
+      [&](const RemovalRecord<KeyType, ValueType>& record) {
+        records.push_back(record);
+      });
+  const KeyType num_keys = capacity_per_segment * segNum * 2;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    cache.Insert(key, generateValueForKey(key));
+  }
+  size_t removed = 0;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    if (cache.Remove(key)) {
+      removed++;
+    }
+  }
+  // 监听器只在 DrainRemovals 里运行
+  EXPECT_TRUE(records.empty());
+  size_t drained = cache.DrainRemovals();
+  EXPECT_EQ(drained, records.size());
+
+  size_t by_size = 0;
+  size_t explicit_removals = 0;
+  for (const auto& record : records) {
+    EXPECT_EQ(record.value_, generateValueForKey(record.key_));
+    if (record.reason_ == RemovalReason::kSize) {
+      by_size++;
+    } else if (record.reason_ == RemovalReason::kExplicit) {
+      explicit_removals++;
+    }
+  }
+  EXPECT_EQ(by_size, cache.GetStats().evictions_);
+  EXPECT_EQ(explicit_removals, removed);
+  EXPECT_EQ(cache.DroppedRemovals(), 0u);
+
+  cache.SetRemovalListener(nullptr);
+  cache.Insert(0, generateValueForKey(0));
+  cache.Remove(0);
+  EXPECT_EQ(cache.DrainRemovals(), 0u);
+}
+
+TEST(SegLRUCacheMultiThreadTest, RemovalQueueFullDrainsOnCaller) {
+  const size_t capacity_per_segment = 16;
+  const size_t queue_capacity = 4;
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  std::mutex records_latch;
+  std::vector<RemovalRecord<KeyType, ValueType>> records;
+  cache.SetRemovalListener(
+      [&](const RemovalRecord<KeyType, ValueType>& record) {
+        std::lock_guard<std::mutex> lock(records_latch);
+        records.push_back(record);
+        // 监听器里再写缓存不会重入 DrainRemovals
+        if (record.key_ % 97 == 0) {
+          cache.Remove(record.key_ + 1);
+        }
+      },
+      queue_capacity);
+  // 没有后台线程也不调用 DrainRemovals，队列很快写满
+  const KeyType keys_per_thread = capacity_per_segment * segNum * 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      KeyType base = static_cast<KeyType>(i) * keys_per_thread;
+      for (KeyType key = base; key < base + keys_per_thread; ++key) {
+        cache.Insert(key, generateValueForKey(key));
+        if (key % 5 == 0) {
+          cache.Remove(key - 3);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  cache.DrainRemovals();
+  EXPECT_EQ(cache.DroppedRemovals(), 0u);
+  size_t by_size = 0;
+  for (const auto& record : records) {
+    EXPECT_EQ(record.value_, generateValueForKey(record.key_));
+    if (record.reason_ == RemovalReason::kSize) {
+      by_size++;
+    }
+  }
+  // 默认不丢记录，每次淘汰都送达
+  EXPECT_EQ(by_size, cache.GetStats().evictions_);
+  EXPECT_GT(records.size(), queue_capacity * segNum);
+}
+
+TEST(SegLRUCacheMultiThreadTest, RemovalNotifierOffCriticalPath) {
+  // 填满 capacity_per_segment * segNum 之后每个线程仍有大量淘汰
+  const int ops_per_thread = 20000;
+  const size_t capacity_per_segment = 256;
+  // 每条记录在监听器里停留的时间，远大于一次 Insert
+  const auto listener_delay = std::chrono::microseconds(20);
+  // 关闭监听器和打开一个很慢的监听器，比较 Insert 的延迟分布。
+  // 同一次运行里的基线作参照，TSan 等插桩构建下绝对延迟本身就很高
+  int64_t baseline_p50 = 0;
+  for (int enabled = 0; enabled < 2; ++enabled) {
+    SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+    std::atomic<size_t> delivered(0);
+    // 监听器只在一个线程上调用，不需要加锁
+    std::vector<std::thread::id> listener_threads;
+    if (enabled) {
+      // 队列满时丢弃，否则 Insert 线程会在释放分片 latch_ 后自己调用监听器
+      cache.SetRemovalListener(
+          [&](const RemovalRecord<KeyType, ValueType>&) {
+            auto until = std::chrono::steady_clock::now() + listener_delay;
+            while (std::chrono::steady_clock::now() < until) {
+            }
+            if (listener_threads.empty() ||
+                listener_threads.back() != std::this_thread::get_id()) {
+              listener_threads.push_back(std::this_thread::get_id());
+            }
+            delivered++;
+          },
+          1024, RemovalOverflow::kDrop);
+      cache.StartRemovalNotifier(std::chrono::milliseconds(1));
+    }
+    std::vector<std::vector<int64_t>> latencies(threadNum);
+    std::vector<std::thread::id> worker_threads(threadNum);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadNum; ++i) {
+      threads.emplace_back([&, i]() {
+        worker_threads[i] = std::this_thread::get_id();
+        latencies[i].reserve(ops_per_thread);
+        KeyType base = static_cast<KeyType>(i) * ops_per_thread;
+        for (int j = 0; j < ops_per_thread; ++j) {
+          auto start = std::chrono::steady_clock::now();
+          cache.Insert(base + j, generateValueForKey(base + j));
+          auto end = std::chrono::steady_clock::now();
+          latencies[i].push_back(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count());
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    cache.StopRemovalNotifier();
+
+    std::vector<int64_t> all;
+    for (auto& l : latencies) {
+      all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    int64_t p50 = all[all.size() / 2];
+    std::cout << (enabled ? "Slow removal listener" : "No removal listener")
+              << ": Insert p50 " << p50 << " ns, p99 "
+              << all[all.size() * 99 / 100] << " ns";
+    if (enabled) {
+      std::cout << ", delivered " << delivered.load() << ", dropped "
+                << cache.DroppedRemovals();
+      // 每次淘汰要么送达监听器，要么因为队列满被丢弃
+      EXPECT_EQ(delivered.load() + cache.DroppedRemovals(),
+                cache.GetStats().evictions_);
+#ifndef USE_BUFFER
+      // 缓冲插入不经过 evict()，不会产生淘汰记录
+      EXPECT_GT(delivered.load(), 0u);
+#endif
+      // 监听器从不在执行 Insert 的线程上运行
+      for (const auto& id : listener_threads) {
+        EXPECT_EQ(std::find(worker_threads.begin(), worker_threads.end(), id),
+                  worker_threads.end());
+      }
+      // 填满之后大多数 Insert 都会淘汰，如果在线调用监听器，中位数至少比
+      // 基线多一次监听器的耗时
+      EXPECT_LT(p50, baseline_p50 +
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             listener_delay)
+                             .count());
+    } else {
+      baseline_p50 = p50;
+    }
+    std::cout << std::endl;
+  }
+}
+
+#ifdef USE_BACKGROUND_EVICTION
+TEST(SegLRUCacheMultiThreadTest, BackgroundEvictionHeadroom) {
+  const int ops_per_thread = 200000;
+  const size_t capacity_per_segment = 4096;
+  for (int enabled = 0; enabled < 2; ++enabled) {
+    SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+    if (enabled) {
+      cache.StartEvictor(80, 90);
+    }
+    std::vector<std::vector<int64_t>> latencies(threadNum);
+    std::vector<std::thread> threads;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < threadNum; ++i) {
+      threads.emplace_back([&, i]() {
+        latencies[i].reserve(ops_per_thread);
+        KeyType base = static_cast<KeyType>(i) * ops_per_thread;
+        for (int j = 0; j < ops_per_thread; ++j) {
+          auto start = std::chrono::steady_clock::now();
+          cache.Insert(base + j, generateValueForKey(base + j));
+          auto end = std::chrono::steady_clock::now();
+          latencies[i].push_back(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count());
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    cache.StopEvictor();
+
+    std::vector<int64_t> all;
+    for (auto& l : latencies) {
+      all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    ShardStats stats = cache.GetStats();
+    double seconds =
+        std::chrono::duration<double>(end_time - start_time).count();
+    std::cout << (enabled ? "Background evictor" : "Inline eviction")
+              << ": Insert p50 " << all[all.size() / 2] << " ns, p99 "
+              << all[all.size() * 99 / 100] << " ns, throughput "
+              << static_cast<double>(all.size()) / seconds
+              << " ops/sec, evictions " << stats.evictions_
+              << " (background " << stats.background_evictions_ << ")"
+              << std::endl;
+    EXPECT_LE(stats.size_, stats.capacity_);
+    if (enabled) {
+      // 后台线程能分担多少取决于核数，这里只检查它确实在工作
+      EXPECT_GT(stats.background_evictions_, 0u);
+    } else {
+      EXPECT_EQ(stats.background_evictions_, 0u);
+    }
+
+    // 留下的条目值都正确，且数量不少于低水位
+    size_t found = 0;
+    const KeyType num_keys = static_cast<KeyType>(ops_per_thread) * threadNum;
+    for (KeyType key = 0; key < num_keys; ++key) {
+      ValueType value;
+      if (cache.Find(key, value)) {
+        found++;
+        EXPECT_EQ(value, generateValueForKey(key));
+      }
+    }
+#ifndef USE_COLD_TIER
+    // 冷池命中会把条目提升回热区，扫描过程中 size_ 会变
+    EXPECT_EQ(found, stats.size_);
+#endif
+    EXPECT_GE(found, stats.capacity_ * 80 / 100);
+  }
+}
+#endif
+
+std::atomic<int> retired_freed{0};
+
+TEST(EpochTest, RetiredObjectOutlivesReader) {
+  RetireList retired;
+  std::atomic<bool> entered{false};
+  std::atomic<bool> leave{false};
+  std::thread reader([&]() {
+    EpochDomain::Guard guard(EpochDomain::Instance());
+    entered = true;
+    while (!leave.load()) {
+      std::this_thread::yield();
+    }
+  });
+  while (!entered.load()) {
+    std::this_thread::yield();
+  }
+  // 读者进入之后摘除的对象，在读者离开之前不能释放
+  retired.Retire(new int(1), [](void* ptr) {
+    delete static_cast<int*>(ptr);
+    retired_freed++;
+  });
+  retired.Reclaim();
+  EXPECT_EQ(retired_freed.load(), 0);
+  EXPECT_EQ(retired.Size(), 1u);
+
+  leave = true;
+  reader.join();
+  retired.Reclaim();
+  EXPECT_EQ(retired_freed.load(), 1);
+  EXPECT_EQ(retired.Size(), 0u);
+}
+
+#if defined(USE_MY_HASH_TABLE) && defined(USE_HASH_RESIZER)
+TEST(HashTableResizerTest, ParallelRehashUnderTraffic) {
+  using Table = MyHashTable<KeyType, KeyType>;
+  const int num_threads = 4;
+  const KeyType per_thread = 1 << 19;
+  // 从 16 个桶开始，插入过程中连续扩容十几次，最大的一次要搬动上百万个元素。
+  // 返回插入期间单次 Insert 的最长耗时，也就是前台看到的最长扩容窗口
+  auto run = [&](bool use_resizer) -> int64_t {
+    Table table(16);
+    if (use_resizer) {
+      table.SetResizer(&HashTableResizer::Instance());
+    }
+    std::atomic<int> errors{0};
+    std::vector<int64_t> max_latency(num_threads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t]() {
+        KeyType base = static_cast<KeyType>(t) * per_thread;
+        for (KeyType j = 0; j < per_thread; ++j) {
+          auto start = std::chrono::steady_clock::now();
+          if (!table.Insert(base + j, base + j)) {
+            errors++;
+          }
+          auto end = std::chrono::steady_clock::now();
+          max_latency[t] = std::max<int64_t>(
+              max_latency[t],
+              std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                    start)
+                  .count());
+          // 每 16 个 key 删掉一个，其余的随时都要能查到
+          if (j % 16 == 15 && !table.Remove(base + j)) {
+            errors++;
+          }
+          KeyType probe = base + j / 2;
+          KeyType value = 0;
+          if (probe % 16 != 15 &&
+              (!table.Get(probe, value) || value != probe)) {
+            errors++;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(errors.load(), 0);
+    const KeyType total = per_thread * num_threads;
+    EXPECT_EQ(table.Size(), total - total / 16);
+    size_t found = 0;
+    for (KeyType key = 0; key < total; ++key) {
+      KeyType value = 0;
+      if (table.Get(key, value)) {
+        found++;
+        EXPECT_EQ(value, key);
+      }
+    }
+    EXPECT_EQ(found, total - total / 16);
+    return *std::max_element(max_latency.begin(), max_latency.end());
+  };
+
+  int64_t inline_window = run(false);
+  int64_t parallel_window = run(true);
+  std::cout << "Resizer threads: " << HashTableResizer::Instance().NumThreads()
+            << std::endl;
+  std::cout << "Longest Insert during growth: inline rehash " << inline_window
+            << " us, incremental rehash " << parallel_window << " us"
+            << std::endl;
+  // 线程池已经启动，不能再改线程数
+  EXPECT_FALSE(HashTableResizer::Instance().SetNumThreads(2));
+}
+
+TEST(HashTableResizerTest, ReserveAndClearDuringMigration) {
+  using Table = MyHashTable<KeyType, KeyType>;
+  const KeyType num_keys = 1 << 18;
+  Table table(16);
+  table.SetResizer(&HashTableResizer::Instance());
+  std::atomic<bool> done{false};
+  std::atomic<int> errors{0};
+  // 只读线程：Clear 和迁移同时进行时 Get 只能命中正确的值
+  std::thread reader([&]() {
+    std::mt19937_64 rng(COMMON_BASE_SEED);
+    while (!done.load()) {
+      KeyType key = static_cast<KeyType>(rng() % num_keys);
+      KeyType value = 0;
+      if (table.Get(key, value) && value != key) {
+        errors++;
+      }
+    }
+  });
+  for (int round = 0; round < 8; ++round) {
+    for (KeyType key = 0; key < num_keys; ++key) {
+      ASSERT_TRUE(table.Insert(key, key));
+    }
+    // Reserve 把迁移交给 resizer 后立即返回，迁移期间所有 key 都能查到
+    table.Reserve(num_keys * 4);
+    for (KeyType key = 0; key < num_keys; key += 97) {
+      KeyType value = 0;
+      ASSERT_TRUE(table.Get(key, value)) << key;
+      EXPECT_EQ(value, key);
+    }
+    // resizer 线程可能还在迁移最后几个区间
+    table.Clear();
+    EXPECT_EQ(table.Size(), 0u);
+    EXPECT_EQ(table.BucketCount(), static_cast<size_t>(num_keys * 4));
+  }
+  done.store(true);
+  reader.join();
+  EXPECT_EQ(errors.load(), 0);
+}
+#endif
+
+#ifdef USE_MY_HASH_TABLE
+TEST(MyHashTableTest, LoadFactorShrinkAndReserve) {
+  // 没有 resizer，扩缩容都在触发它的写操作里完成
+  MyHashTable<KeyType, KeyType> table(16);
+  const KeyType num_keys = 100000;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    ASSERT_TRUE(table.Insert(key, key));
+  }
+  EXPECT_GE(table.BucketCount() * 2, static_cast<size_t>(num_keys));
+
+  // 删到只剩 100 个，负载因子回到 [0.25, 0.5)
+  for (KeyType key = 100; key < num_keys; ++key) {
+    ASSERT_TRUE(table.Remove(key));
+  }
+  EXPECT_EQ(table.BucketCount(), 256u);
+  for (KeyType key = 0; key < 100; ++key) {
+    KeyType value = 0;
+    ASSERT_TRUE(table.Get(key, value));
+    EXPECT_EQ(value, key);
+  }
+
+  // 在扩容阈值附近反复插删，不会来回扩缩
+  KeyType next = num_keys;
+  while (table.BucketCount() == 256u) {
+    ASSERT_TRUE(table.Insert(next, next));
+    next++;
+  }
+  size_t resizes = table.ResizeCount();
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(table.Remove(next - 1));
+    ASSERT_TRUE(table.Insert(next - 1, next - 1));
+  }
+  EXPECT_EQ(table.ResizeCount(), resizes);
+
+  // Clear 回到构造时的桶数，Reserve 一次调整到位，之后填满也不再扩容
+  table.Clear();
+  EXPECT_EQ(table.BucketCount(), 16u);
+  table.Reserve(50000);
+  EXPECT_EQ(table.BucketCount(), 65536u);
+  resizes = table.ResizeCount();
+  for (KeyType key = 0; key < 50000; ++key) {
+    ASSERT_TRUE(table.Insert(key, key));
+  }
+  EXPECT_EQ(table.ResizeCount(), resizes);
+  // 删光之后也不会低于 Reserve 的桶数
+  for (KeyType key = 0; key < 50000; ++key) {
+    ASSERT_TRUE(table.Remove(key));
+  }
+  EXPECT_EQ(table.BucketCount(), 65536u);
+
+  EXPECT_FALSE(table.SetLoadFactors(0.5, 1.0));
+  EXPECT_TRUE(table.SetLoadFactors(0.1, 1.0));
+}
+
+TEST(HashBatchTest, MatchesHashFuncImpl) {
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  // 长度不是 8 的倍数，覆盖向量循环之后的标量尾部
+  std::vector<KeyType> keys(1003);
+  for (auto& key : keys) {
+    key = static_cast<KeyType>(rng());
+  }
+  keys[0] = 0;
+  keys[1] = -1;
+  keys[2] = std::numeric_limits<KeyType>::min();
+  keys[3] = std::numeric_limits<KeyType>::max();
+  std::vector<size_t> expected(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    expected[i] = HashFuncImpl()(keys[i]);
+  }
+
+  // 每次 1M 个 key，报告每纳秒计算的 key 数
+  const size_t bench_keys = 1 << 20;
+  const int rounds = 20;
+  std::vector<KeyType> bench(bench_keys);
+  std::iota(bench.begin(), bench.end(), 0);
+  std::vector<size_t> out(bench_keys);
+  std::cout << "HashBatch dispatches to " << HashKernelName(HashBatchKernel())
+            << std::endl;
+  // 下面按定点格式输出，结束后恢复，不影响之后的测试
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::streamsize precision = std::cout.precision();
+  for (HashKernel kernel :
+       {HashKernel::kScalar, HashKernel::kAvx2, HashKernel::kAvx512}) {
+    if (!HashKernelSupported(kernel)) {
+      std::cout << HashKernelName(kernel) << ": not supported" << std::endl;
+      continue;
+    }
+    std::vector<size_t> hashes(keys.size());
+    HashBatch(kernel, keys.data(), keys.size(), hashes.data());
+    EXPECT_EQ(hashes, expected) << HashKernelName(kernel);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      HashBatch(kernel, bench.data(), bench.size(), out.data());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::cout << HashKernelName(kernel) << ": " << std::fixed
+              << std::setprecision(2) << bench_keys * rounds / ns
+              << " keys/ns" << std::endl;
+  }
+  std::cout.flags(flags);
+  std::cout.precision(precision);
+}
+
+// 统计调用次数的 HashFuncImpl
+struct CountingHash {
+  static std::atomic<size_t> calls;
+  size_t operator()(KeyType key) const {
+    calls.fetch_add(1, std::memory_order_relaxed);
+    return HashFuncImpl()(key);
+  }
+};
+std::atomic<size_t> CountingHash::calls{0};
+
+TEST(MyHashTableTest, ResizeUsesCachedHash) {
+  MyHashTable<KeyType, KeyType, CountingHash> table(16);
+  table.SetLoadFactors(0, 2.0);
+  const KeyType num_keys = 100000;
+  CountingHash::calls = 0;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    ASSERT_TRUE(table.Insert(key, key));
+  }
+  // 每次 Insert 只算一次 hash，其间的十几次翻倍都没有重新计算
+  EXPECT_GT(table.ResizeCount(), 10u);
+  EXPECT_EQ(CountingHash::calls.load(), static_cast<size_t>(num_keys));
+
+  size_t buckets = table.BucketCount();
+  CountingHash::calls = 0;
+  table.Resize();
+  table.SetSize(buckets * 4);
+  EXPECT_EQ(CountingHash::calls.load(), 0u);
+  EXPECT_EQ(table.BucketCount(), buckets * 4);
+  for (KeyType key = 0; key < num_keys; ++key) {
+    KeyType value = 0;
+    ASSERT_TRUE(table.Get(key, value));
+    EXPECT_EQ(value, key);
+  }
+}
+
+static auto printChainStats(const char* name, const ChainStats& stats)
+    -> void {
+  std::cout << name << ": " << stats.UsedBuckets() << "/" << stats.buckets_
+            << " buckets used, max chain " << stats.max_length_
+            << ", histogram";
+  for (size_t i = 0; i <= ChainStats::kMaxLength; ++i) {
+    std::cout << " " << stats.histogram_[i];
+  }
+  std::cout << std::endl;
+}
+
+TEST(MyHashTableTest, ShardBitsIndependentOfBucketBits) {
+  // 同一分片里的 key 插入一张分片内的哈希表。分片取 hash 低位时它们的
+  // 低 kNumSegBits 位全相同，只能落进 1/segNum 的桶；取高位时用满所有桶
+  const size_t buckets = 4096;
+  MyHashTable<KeyType, KeyType> low_bits(buckets);
+  MyHashTable<KeyType, KeyType> high_bits(buckets);
+  size_t low_count = 0;
+  size_t high_count = 0;
+  for (KeyType key = 0; low_count < buckets || high_count < buckets; ++key) {
+    size_t hash = HashFuncImpl()(key);
+    if (low_count < buckets && (hash & (segNum - 1)) == 0) {
+      ASSERT_TRUE(low_bits.Insert(key, hash, key));
+      low_count++;
+    }
+    if (high_count < buckets && ShardOfHash(hash) == 0) {
+      ASSERT_TRUE(high_bits.Insert(key, hash, key));
+      high_count++;
+    }
+  }
+  ChainStats low = low_bits.GetChainStats();
+  ChainStats high = high_bits.GetChainStats();
+  printChainStats("shard from low bits", low);
+  printChainStats("shard from high bits", high);
+  ASSERT_EQ(low.buckets_, buckets);
+  ASSERT_EQ(high.buckets_, buckets);
+  EXPECT_EQ(high.elements_, buckets);
+  EXPECT_LE(low.UsedBuckets(), buckets / segNum);
+  // 负载因子 1 的随机分布约有 1 - 1/e 的桶非空
+  EXPECT_GT(high.UsedBuckets(), buckets / 2);
+  EXPECT_LE(high.max_length_, ChainStats::kMaxLength);
+
+  // 整个缓存里每个分片的哈希表也用满了桶
+  SegLRUCache<KeyType, ValueType> cache(buckets);
+  for (KeyType key = 0; key < static_cast<KeyType>(buckets * segNum); ++key) {
+    cache.Insert(key, generateValueForKey(key));
+  }
+  for (uint32_t i = 0; i < segNum; ++i) {
+    ChainStats stats = cache.GetShardChainStats(i);
+    EXPECT_EQ(stats.elements_, cache.GetShardStats(i).size_);
+    EXPECT_GT(stats.UsedBuckets(),
+              std::min(stats.elements_, stats.buckets_) / 2);
+  }
+  printChainStats("SegLRUCache", cache.GetChainStats());
+}
+#endif
+
+TEST(SegLRUCacheMultiThreadTest, SnapshotRoundTrip) {
+  const size_t capacity_per_segment = 64;
+  const std::string path = testing::TempDir() + "mylru_snapshot.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  // 每个分片先填满 capacity 个 key，剩下一半容量的 key 留到恢复之后插入
+  const size_t half = capacity_per_segment / 2;
+  auto keys =
+      keysByShard(std::vector<size_t>(segNum, capacity_per_segment + half));
+  for (const auto& shard_keys : keys) {
+    for (size_t i = 0; i < capacity_per_segment; ++i) {
+      ASSERT_TRUE(
+          cache.Insert(shard_keys[i], generateValueForKey(shard_keys[i])));
+    }
+  }
+  ASSERT_TRUE(cache.SaveSnapshot(path));
+
+  SegLRUCache<KeyType, ValueType> restored(capacity_per_segment);
+  ASSERT_TRUE(restored.LoadSnapshot(path));
+  EXPECT_EQ(restored.Size(), cache.Size());
+#if !defined(USE_S3FIFO) && !defined(USE_SAMPLED_LRU) && \
+    !defined(USE_LFU) && !defined(USE_MIDPOINT_INSERTION)
+  // 每个分片再插入一半容量的新 key，恢复后的 LRU 顺序决定谁被淘汰
+  for (const auto& shard_keys : keys) {
+    for (size_t i = capacity_per_segment; i < shard_keys.size(); ++i) {
+      ASSERT_TRUE(
+          restored.Insert(shard_keys[i], generateValueForKey(shard_keys[i])));
+    }
+  }
+  ValueType value;
+  for (const auto& shard_keys : keys) {
+    for (size_t i = 0; i < capacity_per_segment; ++i) {
+      EXPECT_EQ(restored.Find(shard_keys[i], value), i >= half)
+          << shard_keys[i];
+    }
+  }
+#endif
+  for (const auto& shard_keys : keys) {
+    for (size_t i = half; i < capacity_per_segment; ++i) {
+      ValueType value;
+      ASSERT_TRUE(restored.Find(shard_keys[i], value)) << shard_keys[i];
+      EXPECT_EQ(value, generateValueForKey(shard_keys[i]));
+    }
+  }
+
+  SegLRUCache<KeyType, ValueType> rejected(capacity_per_segment);
+  EXPECT_FALSE(rejected.LoadSnapshot(path + ".missing"));
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, SnapshotConcurrentWithTraffic) {
+  const size_t capacity_per_segment = 1024;
+  const std::string path = testing::TempDir() + "mylru_snapshot_mt.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      std::mt19937_64 rng(COMMON_BASE_SEED + i);
+      std::uniform_int_distribution<KeyType> key_dist(
+          0, capacity_per_segment * segNum * 2);
+      ValueType value;
+      while (!stop.load()) {
+        KeyType key = key_dist(rng);
+        if (!cache.Find(key, value)) {
+          cache.Insert(key, generateValueForKey(key));
+        }
+      }
+    });
+  }
+  bool saved = true;
+  for (int round = 0; round < 5; ++round) {
+    saved = saved && cache.SaveSnapshot(path);
+  }
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_TRUE(saved);
+
+  SegLRUCache<KeyType, ValueType> restored(capacity_per_segment);
+  auto start = std::chrono::high_resolution_clock::now();
+  ASSERT_TRUE(restored.LoadSnapshot(path));
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << "Snapshot load: " << restored.Size() << " entries in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                      start)
+                   .count()
+            << " us" << std::endl;
+  EXPECT_GT(restored.Size(), 0);
+  EXPECT_LE(restored.Size(), restored.Capacity());
+  std::remove(path.c_str());
+}
+
+TEST(FlashTierTest, WrapAroundDropsOldestRegions) {
+  const std::string path = testing::TempDir() + "mylru_flash_wrap.bin";
+  const size_t capacity_bytes = 2 << 20;
+  const KeyType num_keys = 300000;
+  FlashTier<KeyType, ValueType> flash;
+  ASSERT_FALSE(flash.Open(path, capacity_bytes / 4));
+  ASSERT_TRUE(flash.Open(path, capacity_bytes));
+  for (KeyType key = 0; key < num_keys; ++key) {
+    // 后台线程跟不上时 Admit 丢弃条目，这里等它写完再重试
+    while (!flash.Admit(key, generateValueForKey(key))) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  EXPECT_LE(flash.Size(), capacity_bytes / (sizeof(KeyType) + sizeof(ValueType)));
+  ValueType value;
+  EXPECT_FALSE(flash.Find(0, value));
+  for (KeyType key = num_keys - 10000; key < num_keys; ++key) {
+    ASSERT_TRUE(flash.Find(key, value)) << key;
+    EXPECT_EQ(value, generateValueForKey(key));
+  }
+  EXPECT_TRUE(flash.Remove(num_keys - 1));
+  EXPECT_FALSE(flash.Find(num_keys - 1, value));
+  flash.Close();
+  std::remove(path.c_str());
+}
+
+TEST(FlashTierTest, FindBatchMatchesFind) {
+  const std::string path = testing::TempDir() + "mylru_flash_batch.bin";
+  const KeyType num_keys = 100000;
+  FlashTier<KeyType, ValueType> flash;
+  ASSERT_TRUE(flash.Open(path, 8 << 20));
+  for (KeyType key = 0; key < num_keys; ++key) {
+    while (!flash.Admit(key, generateValueForKey(key))) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  EXPECT_TRUE(flash.Remove(7));
+  // 一批里混合已写盘、仍在 buffer 中、被删除和不存在的 key，数量超过一次提交
+  std::vector<KeyType> keys;
+  for (KeyType key = 0; key < 300; ++key) {
+    keys.push_back(key * 331 % num_keys);
+  }
+  keys.push_back(num_keys - 1);
+  keys.push_back(num_keys + 5);
+  std::vector<ValueType> values(keys.size());
+  std::vector<uint64_t> offsets(keys.size());
+  std::vector<size_t> hashes(keys.size());
+  HashKeys<KeyType, HashFuncImpl>(keys.data(), keys.size(), hashes.data());
+  std::unique_ptr<bool[]> found(new bool[keys.size()]);
+  size_t hits = flash.FindBatch(keys.data(), hashes.data(), keys.size(),
+                                values.data(), offsets.data(), found.get());
+  size_t expected_hits = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ValueType value;
+    uint64_t offset;
+    bool expected = flash.Find(keys[i], value, &offset);
+    ASSERT_EQ(found[i], expected) << keys[i];
+    if (expected) {
+      expected_hits++;
+      EXPECT_EQ(values[i], value);
+      EXPECT_EQ(offsets[i], offset);
+    }
+  }
+  EXPECT_EQ(hits, expected_hits);
+  EXPECT_GT(hits, keys.size() / 2);
+  EXPECT_FALSE(found[keys.size() - 1]);
+  flash.Close();
+  std::remove(path.c_str());
+}
+
+#ifdef USE_FLASH_TIER
+TEST(SegLRUCacheMultiThreadTest, FlashTierSpillAndPromote) {
+  const size_t capacity_per_segment = 64;
+  const std::string path = testing::TempDir() + "mylru_flash.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  ASSERT_TRUE(cache.OpenFlashTier(path, 16 << 20));
+  const KeyType num_keys = capacity_per_segment * segNum * 8;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+  }
+  EXPECT_LE(cache.Size(), cache.Capacity());
+  EXPECT_GT(cache.GetFlashTier().Size(), 0);
+
+  // 最早插入的 key 只在 flash 中：新值覆盖旧值，Remove 同时删除两层
+  ValueType value;
+  ValueType updated = generateValueForKey(num_keys);
+  ASSERT_TRUE(cache.Insert(0, updated));
+  ASSERT_TRUE(cache.Find(0, value));
+  EXPECT_EQ(value, updated);
+  EXPECT_TRUE(cache.Remove(1));
+  EXPECT_FALSE(cache.Find(1, value));
+
+  for (KeyType key = 2; key < num_keys; ++key) {
+    ASSERT_TRUE(cache.Find(key, value)) << key;
+    EXPECT_EQ(value, generateValueForKey(key));
+  }
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, FlashTierConcurrentReadThrough) {
+  const size_t capacity_per_segment = 256;
+  const std::string path = testing::TempDir() + "mylru_flash_mt.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  ASSERT_TRUE(cache.OpenFlashTier(path, 32 << 20));
+  const KeyType key_space = capacity_per_segment * segNum * 4;
+  std::atomic<size_t> wrong_values(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      std::mt19937_64 rng(COMMON_BASE_SEED + i);
+      std::uniform_int_distribution<KeyType> key_dist(0, key_space - 1);
+      ValueType value;
+      for (int op = 0; op < 50000; ++op) {
+        KeyType key = key_dist(rng);
+        if (cache.Find(key, value)) {
+          if (value != generateValueForKey(key)) {
+            wrong_values++;
+          }
+        } else {
+          cache.Insert(key, generateValueForKey(key));
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(wrong_values.load(), 0);
+  // 工作集是 DRAM 的 4 倍但能全部放进 flash，只有被丢弃的淘汰条目会丢失
+  size_t misses = 0;
+  for (KeyType key = 0; key < key_space; ++key) {
+    ValueType value;
+    if (!cache.Find(key, value)) {
+      misses++;
+    } else {
+      EXPECT_EQ(value, generateValueForKey(key));
+    }
+  }
+  EXPECT_LE(misses, cache.GetFlashTier().Dropped());
+  std::cout << "Flash tier: " << misses << " misses, "
+            << cache.GetFlashTier().Dropped() << " dropped" << std::endl;
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, FlashTierBatchReadThrough) {
+  const size_t capacity_per_segment = 64;
+  const std::string path = testing::TempDir() + "mylru_flash_batch_mt.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  ASSERT_TRUE(cache.OpenFlashTier(path, 16 << 20));
+  const KeyType num_keys = capacity_per_segment * segNum * 8;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+  }
+  // 每个线程按批读取自己的一段 key，大部分只在 flash 中，命中后被提升回分片
+  const size_t batch = 48;
+  std::atomic<size_t> wrong_values(0);
+  std::atomic<size_t> misses(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadNum; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<KeyType> keys(batch);
+      std::vector<ValueType> values(batch);
+      std::unique_ptr<bool[]> found(new bool[batch]);
+      for (KeyType begin = t * batch; begin + batch <= num_keys;
+           begin += threadNum * batch) {
+        for (size_t i = 0; i < batch; ++i) {
+          keys[i] = begin + i;
+        }
+        size_t hits =
+            cache.FindBatch(keys.data(), batch, values.data(), found.get());
+        misses += batch - hits;
+        for (size_t i = 0; i < batch; ++i) {
+          if (found[i] && values[i] != generateValueForKey(keys[i])) {
+            wrong_values++;
+          }
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(wrong_values.load(), 0);
+  EXPECT_LE(misses.load(), cache.GetFlashTier().Dropped());
+  EXPECT_LE(cache.Size(), cache.Capacity());
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, FlashTierRemoveRacesPromotion) {
+  const size_t capacity_per_segment = 64;
+  const std::string path = testing::TempDir() + "mylru_flash_remove.bin";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  ASSERT_TRUE(cache.OpenFlashTier(path, 16 << 20));
+  const KeyType num_keys = capacity_per_segment * segNum * 8;
+  for (KeyType key = 0; key < num_keys; ++key) {
+    ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+  }
+  // 前一半 key 大多只在 flash 中，读线程不断把它们提升回分片，同时被删除
+  const KeyType removed_keys = num_keys / 2;
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < threadNum - 1; ++i) {
+    readers.emplace_back([&, i]() {
+      std::mt19937_64 rng(COMMON_BASE_SEED + i);
+      std::uniform_int_distribution<KeyType> key_dist(0, removed_keys - 1);
+      ValueType value;
+      while (!done.load()) {
+        cache.Find(key_dist(rng), value);
+      }
+    });
+  }
+  for (KeyType key = 0; key < removed_keys; ++key) {
+    cache.Remove(key);
+  }
+  done.store(true);
+  for (auto& t : readers) {
+    t.join();
+  }
+  ValueType value;
+  for (KeyType key = 0; key < removed_keys; ++key) {
+    EXPECT_FALSE(cache.Find(key, value)) << key;
+  }
+  std::remove(path.c_str());
+}
+#endif
+
+#ifdef USE_ACCESS_TRACE
+TEST(SegLRUCacheMultiThreadTest, AccessTraceRecordsEveryOp) {
+  const size_t capacity_per_segment = 256;
+  const KeyType key_space = capacity_per_segment * segNum * 2;
+  const int ops_per_thread = 20000;
+  const std::string path = testing::TempDir() + "mylru_access.trace";
+  SegLRUCache<KeyType, ValueType> cache(capacity_per_segment);
+  ASSERT_FALSE(cache.StartAccessTrace(path, 0));
+  ASSERT_TRUE(cache.StartAccessTrace(path, 1, std::chrono::milliseconds(1)));
+  std::atomic<size_t> finds(0);
+  std::atomic<size_t> hits(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      std::mt19937_64 rng(COMMON_BASE_SEED + i);
+      std::uniform_int_distribution<KeyType> key_dist(0, key_space - 1);
+      ValueType value;
+      for (int op = 0; op < ops_per_thread; ++op) {
+        KeyType key = key_dist(rng);
+        finds++;
+        if (cache.Find(key, value)) {
+          hits++;
+        } else {
+          cache.Insert(key, generateValueForKey(key));
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  cache.StopAccessTrace();
+  size_t misses = finds - hits;
+
+  AccessTraceHeader header;
+  std::vector<AccessRecord> records;
+  ASSERT_TRUE(ReadAccessTrace(path, header, records));
+  EXPECT_EQ(header.sample_rate_, 1u);
+  EXPECT_EQ(header.num_shards_, static_cast<uint32_t>(segNum));
+  size_t dropped = cache.GetAccessTracer().Dropped();
+  EXPECT_EQ(records.size(), cache.GetAccessTracer().Written());
+  EXPECT_EQ(records.size() + dropped, finds + misses);
+  size_t find_hits = 0;
+  for (const auto& record : records) {
+    EXPECT_EQ(record.Shard(), ShardOfHash(record.key_hash_));
+    if (record.Op() == AccessOp::kFind && record.Hit()) {
+      find_hits++;
+    }
+  }
+  if (dropped == 0) {
+    EXPECT_EQ(find_hits, hits.load());
+  }
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, AccessTraceSamplesKeysByHash) {
+  // 抽到的记录少于一个线程队列的容量，不会因为队列满被丢弃
+  const KeyType num_keys = 40000;
+  const uint32_t sample_rate = 8;
+  const std::string path = testing::TempDir() + "mylru_access_sampled.trace";
+  SegLRUCache<KeyType, ValueType> cache(1024);
+  // 两遍访问同样的 key，抽到的 key 集合应当完全相同
+  std::vector<size_t> recorded[2];
+  for (int pass = 0; pass < 2; ++pass) {
+    ASSERT_TRUE(cache.StartAccessTrace(path, sample_rate));
+    ValueType value;
+    for (KeyType key = 0; key < num_keys; ++key) {
+      cache.Find(key, value);
+    }
+    cache.StopAccessTrace();
+    AccessTraceHeader header;
+    std::vector<AccessRecord> records;
+    ASSERT_TRUE(ReadAccessTrace(path, header, records));
+    EXPECT_EQ(header.sample_rate_, sample_rate);
+    EXPECT_EQ(cache.GetAccessTracer().Dropped(), 0u);
+    for (const auto& record : records) {
+      recorded[pass].push_back(record.key_hash_);
+    }
+    std::sort(recorded[pass].begin(), recorded[pass].end());
+  }
+  EXPECT_EQ(recorded[0], recorded[1]);
+  EXPECT_GT(recorded[0].size(), num_keys / sample_rate / 2);
+  EXPECT_LT(recorded[0].size(), num_keys / sample_rate * 2);
+  std::remove(path.c_str());
+}
+
+TEST(SegLRUCacheMultiThreadTest, AccessTraceFreesExitedThreadRings) {
+  const int rounds = 8;
+  const int ops_per_thread = 1000;
+  const std::string path = testing::TempDir() + "mylru_access_threads.trace";
+  SegLRUCache<KeyType, ValueType> cache(256);
+  ASSERT_TRUE(cache.StartAccessTrace(path, 1, std::chrono::milliseconds(1)));
+  // 每一轮都换一批新线程，退出的线程的队列不能一直留在记录器里
+  for (int round = 0; round < rounds; ++round) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadNum; ++i) {
+      threads.emplace_back([&, i]() {
+        KeyType base = static_cast<KeyType>(i) * ops_per_thread;
+        for (KeyType key = base; key < base + ops_per_thread; ++key) {
+          cache.Insert(key, generateValueForKey(key));
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+  cache.StopAccessTrace();
+  EXPECT_EQ(cache.GetAccessTracer().Rings(), 0u);
+
+  AccessTraceHeader header;
+  std::vector<AccessRecord> records;
+  ASSERT_TRUE(ReadAccessTrace(path, header, records));
+  // 退役队列里最后的记录也写进了文件
+  EXPECT_EQ(records.size() + cache.GetAccessTracer().Dropped(),
+            static_cast<size_t>(rounds) * threadNum * ops_per_thread);
+  std::remove(path.c_str());
+}
+
+// --- 同一条 Zipf trace 下关闭记录、全量记录和 1/64 抽样的吞吐 ---
+TEST(SegLRUCacheMultiThreadTest, AccessTraceOverhead) {
+  const size_t key_space = testsNum * size_ratio;
+  const int ops_per_thread = 200000;
+  const std::string path = testing::TempDir() + "mylru_access_overhead.trace";
+  std::vector<double> weights(key_space);
+  for (size_t i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+  }
+  std::discrete_distribution<KeyType> zipf(weights.begin(), weights.end());
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  std::vector<KeyType> trace(ops_per_thread * threadNum);
+  for (auto& key : trace) {
+    key = zipf(rng);
+  }
+  auto run = [&](uint32_t sample_rate) {
+    SegLRUCache<KeyType, ValueType> cache(key_space * size_ratio / segNum);
+    if (sample_rate > 0) {
+      EXPECT_TRUE(cache.StartAccessTrace(path, sample_rate));
+    }
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < threadNum; ++i) {
+      threads.emplace_back([&, i]() {
+        const KeyType* keys = trace.data() + i * ops_per_thread;
+        ValueType value;
+        for (int j = 0; j < ops_per_thread; ++j) {
+          if (!cache.Find(keys[j], value)) {
+            cache.Insert(keys[j], generateValueForKey(keys[j]));
+          }
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    cache.StopAccessTrace();
+    return static_cast<double>(ops_per_thread) * threadNum / seconds;
+  };
+  double off = run(0);
+  for (uint32_t sample_rate : {1u, 64u}) {
+    double on = run(sample_rate);
+    std::cout << "Access trace 1/" << sample_rate << ": " << on
+              << " ops/sec vs " << off << " off ("
+              << (1 - on / off) * 100 << "% overhead)" << std::endl;
+  }
+  std::remove(path.c_str());
+}
+#endif
+
+// --- SHARDS 估计的命中率曲线与精确 LRU 模拟对比 ---
+TEST(MrcEstimatorTest, MatchesExactLru) {
+  const size_t key_space = testsNum * size_ratio;
+  const size_t base_capacity = key_space / 10;
+  std::vector<double> weights(key_space);
+  for (size_t i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+  }
+  std::discrete_distribution<KeyType> zipf(weights.begin(), weights.end());
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  std::vector<KeyType> trace(2000000);
+  for (auto& key : trace) {
+    key = zipf(rng);
+  }
+
+  MrcEstimator estimator;
+  estimator.Start(base_capacity);
+  for (KeyType key : trace) {
+    estimator.Record(HashFuncImpl()(key));
+  }
+  MissRatioCurve curve = estimator.Curve(base_capacity);
+  ASSERT_EQ(curve.points_.size(), size_t(MrcEstimator::kCurvePoints));
+  EXPECT_EQ(curve.points_[MrcEstimator::kCurvePoints / 2].capacity_,
+            base_capacity);
+  // 跟踪的 key 数有上限，key 空间大时抽样率必然降下来
+  EXPECT_LT(curve.sample_rate_, 1.0);
+  for (size_t i = 1; i < curve.points_.size(); ++i) {
+    EXPECT_GE(curve.points_[i].hit_ratio_, curve.points_[i - 1].hit_ratio_);
+  }
+
+  for (double factor : {0.1, 0.5, 1.0, 2.0, 5.0}) {
+    size_t capacity = static_cast<size_t>(base_capacity * factor);
+    // 精确 LRU：链表头是最近访问的 key
+    std::list<KeyType> order;
+    std::unordered_map<KeyType, std::list<KeyType>::iterator> where;
+    size_t hits = 0;
+    for (KeyType key : trace) {
+      auto it = where.find(key);
+      if (it != where.end()) {
+        hits++;
+        order.splice(order.begin(), order, it->second);
+        continue;
+      }
+      order.push_front(key);
+      where[key] = order.begin();
+      if (order.size() > capacity) {
+        where.erase(order.back());
+        order.pop_back();
+      }
+    }
+    double exact = static_cast<double>(hits) / trace.size();
+    double estimated = curve.HitRatioAt(capacity);
+    std::cout << "Capacity " << capacity << ": exact " << exact
+              << ", estimated " << estimated << std::endl;
+    EXPECT_NEAR(estimated, exact, 0.03);
+  }
+}
+
+// --- 多线程下打开估计，当前容量处的估计值接近实际命中率 ---
+TEST(SegLRUCacheMultiThreadTest, MissRatioCurve) {
+  const size_t key_space = testsNum * size_ratio;
+  const int ops_per_thread = 200000;
+  std::vector<double> weights(key_space);
+  for (size_t i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+  }
+  std::discrete_distribution<KeyType> zipf(weights.begin(), weights.end());
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  std::vector<KeyType> trace(ops_per_thread * threadNum);
+  for (auto& key : trace) {
+    key = zipf(rng);
+  }
+  SegLRUCache<KeyType, ValueType> cache(key_space / 10 / segNum);
+  cache.SetMrcTracking(true);
+  std::atomic<int> hit_count(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadNum; ++i) {
+    threads.emplace_back([&, i]() {
+      const KeyType* keys = trace.data() + i * ops_per_thread;
+      ValueType value;
+      for (int j = 0; j < ops_per_thread; ++j) {
+        if (cache.Find(keys[j], value)) {
+          hit_count++;
+        } else {
+          cache.Insert(keys[j], generateValueForKey(keys[j]));
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  MissRatioCurve curve = cache.GetMissRatioCurve();
+  double observed = static_cast<double>(hit_count.load()) / trace.size();
+  double estimated = curve.HitRatioAt(cache.Capacity());
+  std::cout << "Observed hit ratio " << observed << ", estimated " << estimated
+            << " (sample rate " << curve.sample_rate_ << ", "
+            << curve.sampled_refs_ << " sampled refs)" << std::endl;
+  EXPECT_EQ(curve.points_.size(), size_t(MrcEstimator::kCurvePoints));
+  EXPECT_GT(curve.sampled_refs_, 0u);
+#if !defined(USE_S3FIFO) && !defined(USE_LFU) && !defined(USE_SAMPLED_LRU) && \
+    !defined(USE_SIEVE) && !defined(USE_MIDPOINT_INSERTION) &&              \
+    !defined(USE_HOT_KEY_CACHE) && !defined(USE_COLD_TIER) &&              \
+    !defined(USE_FLASH_TIER)
+  // 曲线按一个完整的 LRU 估计，分片后每片独立淘汰，只要求大致接近
+  EXPECT_NEAR(estimated, observed, 0.05);
+#endif
+
+  // 关闭后不再计数
+  size_t refs = curve.sampled_refs_;
+  cache.SetMrcTracking(false);
+  ValueType value;
+  for (int j = 0; j < ops_per_thread; ++j) {
+    cache.Find(trace[j], value);
+  }
+  EXPECT_EQ(cache.GetMissRatioCurve().sampled_refs_, refs);
+}
+
+using ShmCache = ShmSegLRUCache<KeyType, ValueType>;
+
+TEST(ShmSegLRUCacheTest, SharedAcrossProcesses) {
+  const size_t capacity_per_segment = 64;
+  const std::string name = "/mylru_test_" + std::to_string(getpid());
+  ShmCache::Unlink(name);
+  ShmCache cache(name, capacity_per_segment);
+  const size_t num_keys = capacity_per_segment * segNum;
+  // 前 capacity 个 key 填满每个分片，后 capacity 个在之后把它们全部挤掉
+  auto keys =
+      keysByShard(std::vector<size_t>(segNum, capacity_per_segment * 2));
+
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // 子进程重新打开同名段，写入后退出
+    ShmCache child(name, capacity_per_segment);
+    bool ok = true;
+    for (const auto& shard_keys : keys) {
+      for (size_t i = 0; i < capacity_per_segment; ++i) {
+        KeyType key = shard_keys[i];
+        ok = child.Insert(key, generateValueForKey(key)) && ok;
+      }
+    }
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  EXPECT_EQ(cache.Size(), num_keys);
+  for (const auto& shard_keys : keys) {
+    for (size_t i = 0; i < capacity_per_segment; ++i) {
+      ValueType value;
+      ASSERT_TRUE(cache.Find(shard_keys[i], value)) << shard_keys[i];
+      EXPECT_EQ(value, generateValueForKey(shard_keys[i]));
+    }
+  }
+  // 超出容量后按 LRU 淘汰，另一个映射立刻可见
+  ShmCache other(name, capacity_per_segment);
+  for (const auto& shard_keys : keys) {
+    for (size_t i = capacity_per_segment; i < shard_keys.size(); ++i) {
+      KeyType key = shard_keys[i];
+      ASSERT_TRUE(other.Insert(key, generateValueForKey(key)));
+    }
+  }
+  EXPECT_EQ(cache.Size(), num_keys);
+  ValueType value;
+  const KeyType fresh = keys[0][capacity_per_segment];
+  EXPECT_FALSE(cache.Find(keys[0][0], value));
+  EXPECT_TRUE(cache.Remove(fresh));
+  EXPECT_FALSE(other.Find(fresh, value));
+
+  EXPECT_THROW(ShmCache(name, capacity_per_segment * 2), std::runtime_error);
+  EXPECT_TRUE(ShmCache::Unlink(name));
+}
+
+TEST(ShmSegLRUCacheTest, SurvivesKilledWriter) {
+  const size_t capacity_per_segment = 256;
+  const std::string name = "/mylru_test_kill_" + std::to_string(getpid());
+  ShmCache::Unlink(name);
+  ShmCache cache(name, capacity_per_segment);
+
+  for (int round = 0; round < 5; ++round) {
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+      std::mt19937_64 rng(COMMON_BASE_SEED + round);
+      std::uniform_int_distribution<KeyType> key_dist(
+          0, capacity_per_segment * segNum * 2);
+      ValueType value;
+      while (true) {
+        KeyType key = key_dist(rng);
+        if (!cache.Find(key, value)) {
+          cache.Insert(key, generateValueForKey(key));
+        }
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    kill(pid, SIGKILL);
+    ASSERT_EQ(waitpid(pid, nullptr, 0), pid);
+
+    // 子进程可能死在任意分片的临界区里，之后的操作不能死锁，数据也要一致
+    for (KeyType key = 0; key < static_cast<KeyType>(segNum) * 4; ++key) {
+      cache.Remove(key);
+      ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+      ValueType value;
+      ASSERT_TRUE(cache.Find(key, value));
+      EXPECT_EQ(value, generateValueForKey(key));
+    }
+    EXPECT_LE(cache.Size(), cache.Capacity());
+  }
+  EXPECT_TRUE(ShmCache::Unlink(name));
+}
+
 TEST(SegLRUCacheMultiThreadTest, DISABLED_RandomizedMixedOperationsHT) {
   const int num_threads = threadNum;
   const int ops_per_thread = testsNum / num_threads;
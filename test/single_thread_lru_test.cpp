@@ -1,12 +1,23 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <numeric>
+#include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "cold_pool.h"
 #include "lru_cache.h"
+#include "s3fifo_cache.h"
+#include "sampled_lru_cache.h"
+#include "lfu_cache.h"
 
 namespace myLru {  // Using your namespace
 ValueType generateValueForKey(KeyType key) {
@@ -95,6 +106,8 @@ TEST(LRUCacheSingleThreadTest, EvictionLRU) {
   }
 }
 
+#ifndef USE_MIDPOINT_INSERTION
+// 以下两个用例检查严格的 LRU 顺序，midpoint 模式下新节点进入 old 子链表
 // --- Test Updating Existing Key ---
 TEST(LRUCacheSingleThreadTest, UpdateValueAndLRUOrder) {
   const size_t capacity = 5;
@@ -166,6 +179,8 @@ TEST(LRUCacheSingleThreadTest, EvictionAfterAccessOrderChange) {
   EXPECT_TRUE(cache.Find(5, retrieved_value));
 }
 
+#endif
+
 // --- Test Clear Operation ---
 TEST(LRUCacheSingleThreadTest, ClearCache) {
   const size_t capacity = 10;
@@ -228,4 +243,563 @@ TEST(LRUCacheSingleThreadTest, CapacityOne) {
   EXPECT_FALSE(cache.Find(2, retrieved_value));
 }
 
+#ifdef USE_SIEVE
+// --- Test SIEVE: a hit only marks the node, the hand keeps its position ---
+TEST(LRUCacheSingleThreadTest, SieveKeepsVisitedNode) {
+  const size_t capacity = 5;
+  LRUCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  // 1. Fill the cache (Keys 0, 1, 2, 3, 4), key 0 is at the tail
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  ASSERT_TRUE(cache.Find(0, retrieved_value));
+
+  // 2. Insert 5..9: the hand skips key 0 once, then sweeps 1..4 and the
+  // unvisited key 5. LRU would have evicted key 0 on the fifth insert.
+  for (KeyType i = 5; i < 10; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_EQ(cache.Size(), capacity);
+
+  EXPECT_TRUE(cache.Find(0, retrieved_value));
+  EXPECT_EQ(retrieved_value, generateValueForKey(0));
+  for (KeyType i = 1; i <= 5; ++i) {
+    EXPECT_FALSE(cache.Find(i, retrieved_value))
+        << "Key " << i << " should be evicted.";
+  }
+  for (KeyType i = 6; i < 10; ++i) {
+    EXPECT_TRUE(cache.Find(i, retrieved_value));
+  }
+}
+
+// --- Test SIEVE: removing the node under the hand ---
+TEST(LRUCacheSingleThreadTest, SieveRemoveHandNode) {
+  const size_t capacity = 3;
+  LRUCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  for (KeyType i = 0; i < 3; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  ASSERT_TRUE(cache.Find(0, retrieved_value));
+  // Evicts key 1 and leaves the hand on key 2.
+  ASSERT_TRUE(cache.Insert(3, generateValueForKey(3)));
+  ASSERT_TRUE(cache.Remove(2));
+  ASSERT_TRUE(cache.Insert(4, generateValueForKey(4)));
+  ASSERT_TRUE(cache.Insert(5, generateValueForKey(5)));
+
+  EXPECT_EQ(cache.Size(), capacity);
+  EXPECT_FALSE(cache.Find(1, retrieved_value));
+  EXPECT_FALSE(cache.Find(2, retrieved_value));
+  EXPECT_FALSE(cache.Find(3, retrieved_value));
+  EXPECT_TRUE(cache.Find(0, retrieved_value));
+  EXPECT_TRUE(cache.Find(4, retrieved_value));
+  EXPECT_TRUE(cache.Find(5, retrieved_value));
+}
+#endif
+
+#ifdef USE_MIDPOINT_INSERTION
+// Fill a cache of 10 and touch every key, leaving 9..4 young and 3..0 old.
+static void fillMidpointCache(LRUCache<KeyType, ValueType>& cache) {
+  ValueType retrieved_value;
+  for (KeyType i = 0; i < 10; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  for (KeyType i = 0; i < 10; ++i) {
+    ASSERT_TRUE(cache.Find(i, retrieved_value));
+  }
+}
+
+// --- Test midpoint insertion: a scan only cycles through the old sublist ---
+TEST(LRUCacheSingleThreadTest, MidpointScanResistance) {
+  LRUCache<KeyType, ValueType> cache(10);
+  cache.SetMidpoint(37, 0);
+  fillMidpointCache(cache);
+  ValueType retrieved_value;
+
+  for (KeyType i = 100; i < 200; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_EQ(cache.Size(), 10);
+  for (KeyType i = 4; i < 10; ++i) {
+    EXPECT_TRUE(cache.Find(i, retrieved_value))
+        << "Hot key " << i << " should survive the scan.";
+    EXPECT_EQ(retrieved_value, generateValueForKey(i));
+  }
+  for (KeyType i = 0; i < 4; ++i) {
+    EXPECT_FALSE(cache.Find(i, retrieved_value));
+  }
+}
+
+// --- Test midpoint insertion: a second hit promotes the node to young ---
+TEST(LRUCacheSingleThreadTest, MidpointPromoteAfterDwell) {
+  LRUCache<KeyType, ValueType> cache(10);
+  cache.SetMidpoint(37, 0);
+  fillMidpointCache(cache);
+  ValueType retrieved_value;
+
+  ASSERT_TRUE(cache.Insert(100, generateValueForKey(100)));
+  ASSERT_TRUE(cache.Find(100, retrieved_value));
+  for (KeyType i = 101; i < 105; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_TRUE(cache.Find(100, retrieved_value));
+  EXPECT_FALSE(cache.Find(4, retrieved_value));
+}
+
+// --- Test midpoint insertion: hits within the dwell time do not promote ---
+TEST(LRUCacheSingleThreadTest, MidpointNoPromoteWithinDwell) {
+  LRUCache<KeyType, ValueType> cache(10);
+  cache.SetMidpoint(37, 0);
+  fillMidpointCache(cache);
+  cache.SetMidpoint(37, 3600 * 1000);
+  ValueType retrieved_value;
+
+  ASSERT_TRUE(cache.Insert(100, generateValueForKey(100)));
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(cache.Find(100, retrieved_value));
+  }
+  for (KeyType i = 101; i < 105; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_FALSE(cache.Find(100, retrieved_value));
+  for (KeyType i = 4; i < 10; ++i) {
+    EXPECT_TRUE(cache.Find(i, retrieved_value));
+  }
+}
+
+// --- Test midpoint insertion: a node pushed across the midpoint starts a new
+// dwell time instead of reusing a stale one ---
+TEST(LRUCacheSingleThreadTest, MidpointCrossingRestartsDwell) {
+  LRUCache<KeyType, ValueType> cache(10);
+  cache.SetMidpoint(37, 0);
+  fillMidpointCache(cache);
+  cache.SetMidpoint(37, 200);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  ValueType retrieved_value;
+
+  // old 子链表变短，分界点前移，4 进入 old
+  ASSERT_TRUE(cache.Remove(0));
+  ASSERT_TRUE(cache.Find(4, retrieved_value));
+  for (KeyType i = 100; i < 106; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_FALSE(cache.Find(4, retrieved_value));
+  for (KeyType i = 5; i < 10; ++i) {
+    EXPECT_TRUE(cache.Find(i, retrieved_value));
+  }
+}
+#endif
+
+// --- LZCodec ---
+TEST(LZCodecTest, RoundTrip) {
+  std::mt19937 rng(COMMON_BASE_SEED);
+  for (int round = 0; round < 200; ++round) {
+    std::vector<char> input(rng() % 4096);
+    for (size_t i = 0; i < input.size(); ++i) {
+      // 交替使用随机字节和重复片段
+      input[i] = round % 2 ? static_cast<char>(rng()) : "abcabcabd"[i % 9];
+    }
+    std::string compressed;
+    LZCodec::Compress(input.data(), input.size(), compressed);
+    std::vector<char> output(input.size());
+    ASSERT_TRUE(LZCodec::Decompress(compressed.data(), compressed.size(),
+                                    output.data(), output.size()));
+    EXPECT_EQ(output, input);
+    if (round % 2 == 0 && input.size() > 64) {
+      EXPECT_LT(compressed.size(), input.size() / 4);
+    }
+  }
+  std::string compressed;
+  const char text[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  LZCodec::Compress(text, sizeof(text), compressed);
+  char output[sizeof(text)];
+  // 截断的输入和错误的输出长度都要报错
+  EXPECT_FALSE(LZCodec::Decompress(compressed.data(), compressed.size() - 1,
+                                   output, sizeof(output)));
+  EXPECT_FALSE(LZCodec::Decompress(compressed.data(), compressed.size(),
+                                   output, sizeof(output) - 1));
+}
+
+// --- ColdPool: 随机操作与参考模型逐步比较，预算很小，arena 会反复回绕 ---
+TEST(ColdPoolTest, MatchesReference) {
+  // 200 字节的 value 超过压缩阈值，一半可压缩一半不可压缩，记录长度不一
+  using BigValue = std::array<char, 200>;
+  using Pool = ColdPool<KeyType, BigValue, HashType, KeyEqualType>;
+  static_assert(Pool::kCompress, "BigValue should be compressed");
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  auto make_value = [&](KeyType key) {
+    BigValue value;
+    if (key % 2 == 0) {
+      for (size_t i = 0; i < value.size(); ++i) {
+        value[i] = static_cast<char>('a' + (key + i / 16) % 26);
+      }
+    } else {
+      for (auto& c : value) {
+        c = static_cast<char>(rng());
+      }
+    }
+    return value;
+  };
+
+  Pool pool;
+  std::deque<std::pair<KeyType, BigValue>> ref;  // 头部最旧
+  auto on_drop = [&](const KeyType& key, const BigValue& value) {
+    ASSERT_FALSE(ref.empty());
+    EXPECT_EQ(key, ref.front().first);
+    EXPECT_EQ(value, ref.front().second);
+    ref.pop_front();
+  };
+  auto find_ref = [&](KeyType key) {
+    return std::find_if(ref.begin(), ref.end(),
+                        [&](const auto& e) { return e.first == key; });
+  };
+  pool.Reset(8 << 10, on_drop);
+
+  KeyType next_key = 0;
+  for (int op = 0; op < 20000; ++op) {
+    int kind = static_cast<int>(rng() % 4);
+    if (kind < 2 || ref.empty()) {
+      KeyType key = next_key++;
+      BigValue value = make_value(key);
+      ref.emplace_back(key, value);
+      pool.Push(key, HashType()(key), value, on_drop);
+    } else {
+      KeyType key = ref[rng() % ref.size()].first;
+      if (rng() % 4 == 0) {
+        key = next_key + 1;  // 不在池中的 key
+      }
+      auto it = find_ref(key);
+      BigValue value;
+      bool found = kind == 2 ? pool.Take(key, HashType()(key), value)
+                             : pool.Erase(key, HashType()(key));
+      ASSERT_EQ(found, it != ref.end());
+      if (found) {
+        if (kind == 2) {
+          EXPECT_EQ(value, it->second);
+        }
+        ref.erase(it);
+      }
+    }
+    ASSERT_EQ(pool.Size(), ref.size());
+    ASSERT_LE(pool.Bytes(), size_t(8 << 10));
+  }
+
+  size_t i = 0;
+  pool.ForEach([&](const KeyType& key, const BigValue& value) {
+    ASSERT_LT(i, ref.size());
+    EXPECT_EQ(key, ref[i].first);
+    EXPECT_EQ(value, ref[i].second);
+    i++;
+  });
+  EXPECT_EQ(i, ref.size());
+
+  // 缩小预算时保留最新的条目
+  pool.Reset(1 << 10, on_drop);
+  EXPECT_EQ(pool.Size(), ref.size());
+  EXPECT_GT(pool.Size(), 0);
+  pool.Reset(0, on_drop);
+  EXPECT_EQ(pool.Size(), 0);
+  EXPECT_TRUE(ref.empty());
+}
+
+#ifdef USE_COLD_TIER
+TEST(LRUCacheSingleThreadTest, ColdTierPromotesEvicted) {
+  const size_t capacity = 10;
+  LRUCache<KeyType, ValueType> cache(capacity);
+  cache.SetColdTier(1 << 20);
+  for (KeyType key = 0; key < 30; ++key) {
+    ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+  }
+  EXPECT_EQ(cache.Size(), capacity);
+  EXPECT_EQ(cache.GetStats().cold_size_, 20);
+
+  ValueType value;
+  ASSERT_TRUE(cache.Find(0, value));
+  EXPECT_EQ(value, generateValueForKey(0));
+  EXPECT_EQ(cache.GetStats().cold_hits_, 1);
+  // 0 回到 hot 后挤出 hot 尾部的 key，总条目数不变
+  EXPECT_EQ(cache.Size(), capacity);
+  EXPECT_EQ(cache.GetStats().cold_size_, 20);
+
+  // 冷池中的 key 可以被覆盖和删除
+  ValueType updated = generateValueForKey(100);
+  ASSERT_TRUE(cache.Insert(1, updated));
+  ASSERT_TRUE(cache.Find(1, value));
+  EXPECT_EQ(value, updated);
+  EXPECT_TRUE(cache.Remove(2));
+  EXPECT_FALSE(cache.Find(2, value));
+
+  // 缩小预算时从冷池最旧的一端丢弃
+  cache.SetColdTier(cache.GetStats().cold_bytes_ / 2);
+  EXPECT_FALSE(cache.Find(3, value));
+  ASSERT_TRUE(cache.Find(19, value));
+  EXPECT_EQ(value, generateValueForKey(19));
+  cache.Clear();
+  EXPECT_EQ(cache.GetStats().cold_size_, 0);
+  EXPECT_FALSE(cache.Find(19, value));
+}
+
+TEST(LRUCacheSingleThreadTest, ColdTierRemovalRecords) {
+  const size_t capacity = 4;
+  LRUCache<KeyType, ValueType> cache(capacity);
+  RemovalQueue<KeyType, ValueType> queue;
+  queue.Reset(64);
+  cache.SetRemovalQueue(&queue);
+  cache.SetColdTier(1 << 20);
+  for (KeyType key = 0; key < 8; ++key) {
+    ASSERT_TRUE(cache.Insert(key, generateValueForKey(key)));
+  }
+  // 进入冷池的条目还在缓存里，不产生记录
+  RemovalRecord<KeyType, ValueType> record;
+  EXPECT_FALSE(queue.Pop(record));
+
+  ASSERT_TRUE(cache.Remove(1));
+  ASSERT_TRUE(queue.Pop(record));
+  EXPECT_EQ(record.key_, 1);
+  EXPECT_EQ(record.value_, generateValueForKey(1));
+  EXPECT_EQ(record.reason_, RemovalReason::kExplicit);
+
+  // 被挤出冷池时才算淘汰，从最旧的开始
+  cache.SetColdTier(0);
+  for (KeyType key : {0, 2, 3}) {
+    ASSERT_TRUE(queue.Pop(record));
+    EXPECT_EQ(record.key_, key);
+    EXPECT_EQ(record.value_, generateValueForKey(key));
+    EXPECT_EQ(record.reason_, RemovalReason::kSize);
+  }
+  EXPECT_FALSE(queue.Pop(record));
+}
+#endif
+
+
+// --- S3FIFOCache: Basic Insert, Find, Remove ---
+TEST(S3FIFOCacheSingleThreadTest, BasicOperations) {
+  const size_t capacity = 100;
+  S3FIFOCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  EXPECT_TRUE(cache.IsEmpty());
+  EXPECT_EQ(cache.Capacity(), capacity);
+
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_EQ(cache.Size(), capacity);
+  EXPECT_TRUE(cache.IsFull());
+
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Find(i, retrieved_value)) << "Failed to find key " << i;
+    EXPECT_EQ(retrieved_value, generateValueForKey(i));
+  }
+
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); i += 2) {
+    ASSERT_TRUE(cache.Remove(i));
+    EXPECT_FALSE(cache.Find(i, retrieved_value));
+  }
+  EXPECT_EQ(cache.Size(), capacity / 2);
+  EXPECT_FALSE(cache.Remove(0));
+
+  // Removed slots are reclaimed lazily, the cache must still accept inserts.
+  for (KeyType i = 1000; i < 1000 + static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_EQ(cache.Size(), capacity);
+
+  cache.Clear();
+  EXPECT_TRUE(cache.IsEmpty());
+  EXPECT_FALSE(cache.Find(1000, retrieved_value));
+}
+
+// --- S3FIFOCache: a one-pass scan must not flush frequently used keys ---
+TEST(S3FIFOCacheSingleThreadTest, ScanResistance) {
+  const size_t capacity = 100;
+  const KeyType hot_keys = 50;
+  S3FIFOCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  for (KeyType i = 0; i < hot_keys; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  for (int round = 0; round < 2; ++round) {
+    for (KeyType i = 0; i < hot_keys; ++i) {
+      ASSERT_TRUE(cache.Find(i, retrieved_value));
+    }
+  }
+
+  // One-hit wonders go through the small queue only.
+  for (KeyType i = 1000; i < 1000 + 10 * static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_EQ(cache.Size(), capacity);
+
+  for (KeyType i = 0; i < hot_keys; ++i) {
+    EXPECT_TRUE(cache.Find(i, retrieved_value))
+        << "Hot key " << i << " was flushed by the scan.";
+  }
+}
+
+// --- S3FIFOCache: Capacity 1 ---
+TEST(S3FIFOCacheSingleThreadTest, CapacityOne) {
+  S3FIFOCache<KeyType, ValueType> cache(1);
+  ValueType retrieved_value;
+
+  ASSERT_TRUE(cache.Insert(1, generateValueForKey(1)));
+  ASSERT_TRUE(cache.Insert(2, generateValueForKey(2)));
+  EXPECT_EQ(cache.Size(), 1);
+  EXPECT_FALSE(cache.Find(1, retrieved_value));
+  ASSERT_TRUE(cache.Find(2, retrieved_value));
+  EXPECT_EQ(retrieved_value, generateValueForKey(2));
+
+  ASSERT_TRUE(cache.Remove(2));
+  EXPECT_TRUE(cache.IsEmpty());
+}
+
+// --- SampledLRUCache: Basic Insert, Find, Remove ---
+TEST(SampledLRUCacheSingleThreadTest, BasicOperations) {
+  const size_t capacity = 100;
+  SampledLRUCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_TRUE(cache.IsFull());
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Find(i, retrieved_value));
+    EXPECT_EQ(retrieved_value, generateValueForKey(i));
+  }
+
+  ASSERT_TRUE(cache.Remove(10));
+  EXPECT_FALSE(cache.Remove(10));
+  EXPECT_FALSE(cache.Find(10, retrieved_value));
+  EXPECT_EQ(cache.Size(), capacity - 1);
+
+  for (KeyType i = 1000; i < 1000 + static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+    EXPECT_LE(cache.Size(), capacity);
+  }
+  EXPECT_TRUE(cache.IsFull());
+
+  cache.Resize(10);
+  EXPECT_EQ(cache.Size(), 10);
+  cache.Clear();
+  EXPECT_TRUE(cache.IsEmpty());
+}
+
+#if !defined(USE_SIEVE) && !defined(USE_MIDPOINT_INSERTION)
+// --- SampledLRUCache: hit ratio against exact LRU on a skewed trace ---
+TEST(SampledLRUCacheSingleThreadTest, HitRatioComparedWithLRU) {
+  const size_t capacity = 1000;
+  const int key_space = 20000;
+  const int accesses = 200000;
+
+  // Zipf(0.9) over key_space keys
+  std::vector<double> weights(key_space);
+  for (int i = 0; i < key_space; ++i) {
+    weights[i] = 1.0 / std::pow(i + 1, 0.9);
+  }
+  std::mt19937_64 rng(COMMON_BASE_SEED);
+  std::discrete_distribution<int> key_dist(weights.begin(), weights.end());
+  std::vector<KeyType> trace(accesses);
+  for (auto& key : trace) {
+    key = key_dist(rng);
+  }
+
+  auto replay = [&trace](auto& cache) {
+    ValueType value;
+    size_t hits = 0;
+    for (KeyType key : trace) {
+      if (cache.Find(key, value)) {
+        hits++;
+      } else {
+        cache.Insert(key, generateValueForKey(key));
+      }
+    }
+    return static_cast<double>(hits) / trace.size();
+  };
+
+  LRUCache<KeyType, ValueType> lru(capacity);
+  SampledLRUCache<KeyType, ValueType> sampled(capacity);
+  double lru_ratio = replay(lru);
+  double sampled_ratio = replay(sampled);
+  std::cout << "Exact LRU Hit Ratio: " << lru_ratio * 100 << "%" << std::endl;
+  std::cout << "Sampled LRU Hit Ratio: " << sampled_ratio * 100 << "%"
+            << std::endl;
+
+  EXPECT_GT(sampled_ratio, lru_ratio - 0.02);
+}
+#endif
+
+// --- LFUCache: Basic Insert, Find, Remove ---
+TEST(LFUCacheSingleThreadTest, BasicOperations) {
+  const size_t capacity = 100;
+  LFUCache<KeyType, ValueType> cache(capacity);
+  ValueType retrieved_value;
+
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  EXPECT_TRUE(cache.IsFull());
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Find(i, retrieved_value));
+    EXPECT_EQ(retrieved_value, generateValueForKey(i));
+  }
+  for (KeyType i = 0; i < static_cast<KeyType>(capacity); ++i) {
+    ASSERT_TRUE(cache.Remove(i));
+    EXPECT_FALSE(cache.Find(i, retrieved_value));
+  }
+  EXPECT_TRUE(cache.IsEmpty());
+  EXPECT_FALSE(cache.Remove(0));
+}
+
+// --- LFUCache: evict the least frequent key, LRU among equal frequencies ---
+TEST(LFUCacheSingleThreadTest, EvictionLFU) {
+  LFUCache<KeyType, ValueType> cache(3);
+  ValueType retrieved_value;
+
+  for (KeyType i = 1; i <= 3; ++i) {
+    ASSERT_TRUE(cache.Insert(i, generateValueForKey(i)));
+  }
+  // Frequencies: 1 -> 3, 2 -> 2, 3 -> 2. Key 1 is the least recently used.
+  ASSERT_TRUE(cache.Find(1, retrieved_value));
+  ASSERT_TRUE(cache.Find(1, retrieved_value));
+  ASSERT_TRUE(cache.Find(2, retrieved_value));
+  ASSERT_TRUE(cache.Find(3, retrieved_value));
+
+  // Key 2 is the older of the two keys with the lowest frequency.
+  ASSERT_TRUE(cache.Insert(4, generateValueForKey(4)));
+  EXPECT_EQ(cache.Size(), 3);
+  EXPECT_FALSE(cache.Find(2, retrieved_value));
+  EXPECT_TRUE(cache.Find(1, retrieved_value));
+  EXPECT_TRUE(cache.Find(3, retrieved_value));
+  EXPECT_TRUE(cache.Find(4, retrieved_value));
+}
+
+// --- LFUCache: halving decay lets old popularity age out ---
+TEST(LFUCacheSingleThreadTest, FrequencyDecay) {
+  LFUCache<KeyType, ValueType> cache(2);
+  ValueType retrieved_value;
+
+  cache.SetDecayInterval(0);
+  ASSERT_TRUE(cache.Insert(1, generateValueForKey(1)));
+  for (int i = 0; i < 30; ++i) {
+    ASSERT_TRUE(cache.Find(1, retrieved_value));
+  }
+
+  // Key 2 gets fewer hits than key 1 ever had, but they are recent.
+  cache.SetDecayInterval(4);
+  ASSERT_TRUE(cache.Insert(2, generateValueForKey(2)));
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_TRUE(cache.Find(2, retrieved_value));
+  }
+
+  ASSERT_TRUE(cache.Insert(3, generateValueForKey(3)));
+  EXPECT_FALSE(cache.Find(1, retrieved_value)) << "Key 1 should have aged out.";
+  EXPECT_TRUE(cache.Find(2, retrieved_value));
+  EXPECT_TRUE(cache.Find(3, retrieved_value));
+}
+
 }  // namespace myLru